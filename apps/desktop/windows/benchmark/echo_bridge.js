@@ -0,0 +1,91 @@
+#!/usr/bin/env node
+
+/**
+ * Scripted stand-in for mcp_bridge.js, used by mcp_bridge_benchmark.
+ * Speaks the same wire protocol, framing negotiation included, but answers
+ * every processMessage at once with its params.payload echoed back, so the
+ * benchmark measures the transport and the plugin side rather than MCP work.
+ * Any shared region named in transport.sharedMemoryPath is left unused.
+ */
+
+// Must match mcp_framing.h.
+const FRAMING_LENGTH_PREFIXED = 'length-prefixed';
+const FRAME_MAGIC = 0xfb;
+const FRAME_HEADER_SIZE = 16;
+const FRAME_TYPE_JSON = 1;
+
+let lengthPrefixed = false;
+let inputBuffer = Buffer.alloc(0);
+
+function sendMessage(message) {
+  const json = JSON.stringify(message);
+  if (!lengthPrefixed) {
+    process.stdout.write(json + '\n');
+    return;
+  }
+  const payload = Buffer.from(json, 'utf8');
+  const header = Buffer.alloc(FRAME_HEADER_SIZE);
+  header.writeUInt8(FRAME_MAGIC, 0);
+  header.writeUInt8(FRAME_TYPE_JSON, 1);
+  header.writeUInt32LE(payload.length, 4);
+  header.writeBigUInt64LE(BigInt(message.id || 0), 8);
+  process.stdout.write(Buffer.concat([header, payload]));
+}
+
+function processMessage(message) {
+  const { method, params = {}, requestId, id } = message;
+  switch (method) {
+    case 'initialize':
+      // Acknowledge on the current framing, then switch, as the bridge does.
+      if (params.transport && params.transport.framing === FRAMING_LENGTH_PREFIXED) {
+        sendMessage({ type: 'transport', framing: FRAMING_LENGTH_PREFIXED });
+        lengthPrefixed = true;
+      }
+      sendMessage({ type: 'response', requestId, id, data: { success: true } });
+      break;
+    case 'ping':
+      sendMessage({ type: 'pong', requestId, id });
+      break;
+    case 'processMessage':
+      sendMessage({ type: 'response', requestId, id, data: { payload: params.payload } });
+      break;
+    default:
+      // Notifications such as $/cancelRequest expect no answer.
+      if (id) {
+        sendMessage({
+          type: 'response',
+          requestId,
+          id,
+          error: { type: 'UNKNOWN_METHOD', message: `Unknown method: ${method}` }
+        });
+      }
+  }
+}
+
+process.stdin.on('data', (chunk) => {
+  inputBuffer = inputBuffer.length ? Buffer.concat([inputBuffer, chunk]) : chunk;
+  let offset = 0;
+  while (offset < inputBuffer.length) {
+    let payload;
+    if (inputBuffer[offset] === FRAME_MAGIC) {
+      if (inputBuffer.length - offset < FRAME_HEADER_SIZE) break;
+      const end = offset + FRAME_HEADER_SIZE + inputBuffer.readUInt32LE(offset + 4);
+      if (inputBuffer.length < end) break;
+      payload = inputBuffer.toString('utf8', offset + FRAME_HEADER_SIZE, end);
+      offset = end;
+    } else {
+      const newline = inputBuffer.indexOf(0x0a, offset);
+      if (newline === -1) break;
+      payload = inputBuffer.toString('utf8', offset, newline).trim();
+      offset = newline + 1;
+    }
+    if (!payload) continue;
+    const message = JSON.parse(payload);
+    for (const entry of Array.isArray(message) ? message : [message]) {
+      processMessage(entry);
+    }
+  }
+  inputBuffer = inputBuffer.subarray(offset);
+});
+
+process.stdin.on('end', () => process.exit(0));
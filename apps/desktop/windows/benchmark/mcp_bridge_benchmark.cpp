@@ -0,0 +1,395 @@
+// Throughput, latency and soak benchmark for the bridge transport.
+//
+// Drives NodeJsProcess against echo_bridge.js and runs every response
+// through the plugin's receive path: envelope scan, McpRequestRegistry
+// lookup and transcoding into a method channel reply. Each payload size is run at
+// each concurrency level, reporting messages/s, MB/s across both pipes and
+// round trip percentiles; --soak-minutes then keeps one configuration going
+// and reports memory growth once a minute.
+//
+//   mcp_bridge_benchmark [--script echo_bridge.js] [--sizes 64,1024,65536]
+//                        [--concurrency 1,8,64] [--messages 20000]
+//                        [--framing length-prefixed|ndjson]
+//                        [--soak-minutes 0] [--soak-size 4096]
+//                        [--soak-concurrency 16]
+//
+// Exits with 1 if the bridge fails to start, stalls or answers with errors.
+
+#include <windows.h>
+#include <psapi.h>
+
+#include <flutter/encodable_value.h>
+#include <flutter/standard_method_codec.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mcp_codec_serializer.h"
+#include "mcp_json.h"
+#include "mcp_latency_histogram.h"
+#include "mcp_metrics.h"
+#include "mcp_request_registry.h"
+#include "node_js_process.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Longer than any run, so a summary covers the whole run.
+constexpr std::chrono::seconds kHistogramWindow{24 * 60 * 60};
+// No response for this long means the bridge stalled or died.
+constexpr std::chrono::seconds kStallTimeout{30};
+// Requests per soak round; memory is sampled between rounds.
+constexpr uint64_t kSoakRoundMessages = 10000;
+
+struct BenchmarkOptions {
+  std::string script_path;
+  std::vector<uint64_t> payload_sizes{64, 1024, 16 * 1024, 256 * 1024};
+  std::vector<uint64_t> concurrency{1, 8, 64};
+  uint64_t messages = 20000;
+  McpFraming framing = McpFraming::kLengthPrefixed;
+  uint64_t soak_minutes = 0;
+  uint64_t soak_size = 4096;
+  uint64_t soak_concurrency = 16;
+};
+
+struct MemorySample {
+  uint64_t private_bytes = 0;
+  uint64_t working_set = 0;
+};
+
+MemorySample SampleMemory() {
+  PROCESS_MEMORY_COUNTERS_EX counters = {};
+  counters.cb = sizeof(counters);
+  MemorySample sample;
+  if (GetProcessMemoryInfo(GetCurrentProcess(),
+                           reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters),
+                           sizeof(counters))) {
+    sample.private_bytes = counters.PrivateUsage;
+    sample.working_set = counters.WorkingSetSize;
+  }
+  return sample;
+}
+
+double Megabytes(uint64_t bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+// Parses a comma-separated list of positive integers. Returns false if any
+// entry is not one.
+bool ParseList(const char* text, std::vector<uint64_t>* values) {
+  values->clear();
+  while (*text) {
+    char* end = nullptr;
+    uint64_t value = std::strtoull(text, &end, 10);
+    if (end == text || value == 0 || (*end && *end != ',')) {
+      return false;
+    }
+    values->push_back(value);
+    text = *end ? end + 1 : end;
+  }
+  return !values->empty();
+}
+
+bool ParseCount(const char* text, uint64_t* value) {
+  char* end = nullptr;
+  *value = std::strtoull(text, &end, 10);
+  return end != text && *end == '\0';
+}
+
+// Path of echo_bridge.js next to the executable.
+std::string DefaultScriptPath() {
+  char module_path[MAX_PATH];
+  DWORD length = GetModuleFileNameA(nullptr, module_path, MAX_PATH);
+  std::string path(module_path, length);
+  size_t separator = path.find_last_of("\\/");
+  path.erase(separator == std::string::npos ? 0 : separator + 1);
+  return path + "echo_bridge.js";
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions* options) {
+  options->script_path = DefaultScriptPath();
+  for (int index = 1; index < argc; ++index) {
+    const char* name = argv[index];
+    const char* value = index + 1 < argc ? argv[index + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    bool valid;
+    if (std::strcmp(name, "--script") == 0) {
+      options->script_path = value;
+      valid = true;
+    } else if (std::strcmp(name, "--sizes") == 0) {
+      valid = ParseList(value, &options->payload_sizes);
+    } else if (std::strcmp(name, "--concurrency") == 0) {
+      valid = ParseList(value, &options->concurrency);
+    } else if (std::strcmp(name, "--messages") == 0) {
+      valid = ParseCount(value, &options->messages) && options->messages > 0;
+    } else if (std::strcmp(name, "--framing") == 0) {
+      valid = std::strcmp(value, "ndjson") == 0 || std::strcmp(value, "length-prefixed") == 0;
+      options->framing = std::strcmp(value, "ndjson") == 0 ? McpFraming::kNewlineDelimited
+                                                           : McpFraming::kLengthPrefixed;
+    } else if (std::strcmp(name, "--soak-minutes") == 0) {
+      valid = ParseCount(value, &options->soak_minutes);
+    } else if (std::strcmp(name, "--soak-size") == 0) {
+      valid = ParseCount(value, &options->soak_size) && options->soak_size > 0;
+    } else if (std::strcmp(name, "--soak-concurrency") == 0) {
+      valid = ParseCount(value, &options->soak_concurrency) && options->soak_concurrency > 0;
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      return false;
+    }
+    ++index;
+  }
+  return true;
+}
+
+// One echo bridge and the plugin's side of the pipe in front of it.
+class BridgeDriver {
+ public:
+  BridgeDriver() : latency_(std::make_unique<McpLatencyHistogram>(kHistogramWindow)) {}
+
+  // Prevent copying.
+  BridgeDriver(BridgeDriver const&) = delete;
+  BridgeDriver& operator=(BridgeDriver const&) = delete;
+
+  // Starts the bridge and runs the initialize exchange, switching to
+  // length-prefixed framing if |framing| asks for it.
+  bool Start(const std::string& script_path, McpFraming framing) {
+    process_.SetMessageCallback([this](const McpFrame& frame) { OnFrame(frame); });
+    if (!process_.Start(script_path)) {
+      return false;
+    }
+    flutter::EncodableMap transport;
+    if (framing == McpFraming::kLengthPrefixed) {
+      transport[flutter::EncodableValue("framing")] = flutter::EncodableValue("length-prefixed");
+    }
+    flutter::EncodableMap params{
+      {flutter::EncodableValue("transport"), flutter::EncodableValue(std::move(transport))}
+    };
+    return Run("initialize", params, 1, 1);
+  }
+
+  void Stop() { process_.Stop(); }
+
+  // Sends |count| requests of |method| with |params|, keeping at most
+  // |concurrency| in flight, and waits for every response. Returns false if
+  // the bridge stalls.
+  bool Run(const char* method, const flutter::EncodableMap& params, uint64_t concurrency,
+           uint64_t count) {
+    for (uint64_t sent = 0; sent < count; ++sent) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!completed_.wait_for(lock, kStallTimeout,
+                                 [&]() { return in_flight_ < concurrency; })) {
+          return false;
+        }
+        ++in_flight_;
+      }
+      if (!SendRequest(method, params)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --in_flight_;
+        ++failures_;
+      }
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    return completed_.wait_for(lock, kStallTimeout, [&]() { return in_flight_ == 0; });
+  }
+
+  // Starts a new latency summary.
+  void ResetLatency() { latency_ = std::make_unique<McpLatencyHistogram>(kHistogramWindow); }
+  McpLatencySummary SummarizeLatency() { return latency_->Summarize(); }
+
+  uint64_t failures() const { return failures_; }
+  size_t pending() const { return pending_requests_.size(); }
+
+ private:
+  bool SendRequest(const char* method, const flutter::EncodableMap& params) {
+    McpPendingRequest pending;
+    uint64_t wire_id = pending_requests_.AllocateId();
+    pending.request_id = "bench_" + std::to_string(wire_id);
+    // Serialized per request, as AppendRequestMessage does in the plugin.
+    outbound_message_.clear();
+    outbound_message_.append("{\"method\":");
+    AppendJsonString(method, &outbound_message_);
+    outbound_message_.append(",\"params\":");
+    AppendJson(params, &outbound_message_);
+    outbound_message_.append(",\"requestId\":");
+    AppendJsonString(pending.request_id, &outbound_message_);
+    outbound_message_.append(",\"id\":");
+    outbound_message_.append(std::to_string(wire_id));
+    outbound_message_.push_back('}');
+
+    pending.sent_at = Clock::now();
+    pending_requests_.Insert(wire_id, std::move(pending));
+    if (!process_.SendMessage(outbound_message_)) {
+      pending_requests_.Take(wire_id, &pending);
+      return false;
+    }
+    return true;
+  }
+
+  // The response path of McpChannelPlugin::HandleNodeMessage, minus the
+  // hop to the platform thread. Runs on a completion port thread.
+  void OnFrame(const McpFrame& frame) {
+    McpMessageEnvelope envelope;
+    if (frame.type != McpFrameType::kJson || !ScanMcpMessageEnvelope(frame.payload, &envelope)) {
+      return;
+    }
+    if (envelope.type == "transport") {
+      process_.SetOutboundFraming(McpFraming::kLengthPrefixed);
+      return;
+    }
+    McpPendingRequest pending;
+    if (envelope.type != "response" || !envelope.has_id ||
+        !pending_requests_.Take(envelope.id, &pending)) {
+      return;
+    }
+
+    std::vector<uint8_t> bytes;
+    bool decoded = !envelope.has_error &&
+                   TranscodeJsonToStandardCodec(frame.payload, McpCodecSerializer::kResultOffset,
+                                                &bytes);
+    if (decoded) {
+      flutter::EncodableValue value = McpCodecSerializer::WrapEncoded(std::move(bytes));
+      flutter::StandardMethodCodec::GetInstance(&McpCodecSerializer::GetInstance())
+          .EncodeSuccessEnvelope(&value);
+    }
+    latency_->Record(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - pending.sent_at));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    --in_flight_;
+    if (!decoded) {
+      ++failures_;
+    }
+    completed_.notify_one();
+  }
+
+  NodeJsProcess process_;
+  McpRequestRegistry pending_requests_;
+  std::unique_ptr<McpLatencyHistogram> latency_;
+  // Only touched by the thread calling Run.
+  std::string outbound_message_;
+
+  std::mutex mutex_;
+  std::condition_variable completed_;
+  uint64_t in_flight_ = 0;
+  uint64_t failures_ = 0;
+};
+
+void PrintLatency(const McpLatencySummary& summary) {
+  std::cout << " p50=" << summary.p50 << "us p95=" << summary.p95 << "us p99=" << summary.p99
+            << "us max=" << summary.max << "us";
+}
+
+// Runs every payload size at every concurrency level. Returns false if the
+// bridge stalled.
+bool RunMatrix(const BenchmarkOptions& options, BridgeDriver* driver) {
+  const McpMetrics& metrics = McpMetrics::Get();
+  for (uint64_t size : options.payload_sizes) {
+    flutter::EncodableMap params{
+      {flutter::EncodableValue("payload"),
+       flutter::EncodableValue(std::string(static_cast<size_t>(size), 'x'))}
+    };
+    for (uint64_t concurrency : options.concurrency) {
+      driver->ResetLatency();
+      uint64_t bytes_before = McpMetrics::Read(metrics.bytes_sent) +
+                              McpMetrics::Read(metrics.bytes_received);
+      Clock::time_point start = Clock::now();
+      if (!driver->Run("processMessage", params, concurrency, options.messages)) {
+        std::cerr << "Bridge stalled at payload " << size << ", concurrency " << concurrency
+                  << std::endl;
+        return false;
+      }
+      double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+      uint64_t bytes = McpMetrics::Read(metrics.bytes_sent) +
+                       McpMetrics::Read(metrics.bytes_received) - bytes_before;
+
+      std::cout << "payload=" << size << " concurrency=" << concurrency << std::fixed
+                << std::setprecision(1) << " msgs/s=" << options.messages / seconds
+                << " MB/s=" << Megabytes(bytes) / seconds;
+      PrintLatency(driver->SummarizeLatency());
+      std::cout << std::endl;
+    }
+  }
+  return true;
+}
+
+// Keeps one configuration running for options.soak_minutes, reporting each
+// minute's latency and the process's memory. Growth is measured from the
+// end of the first minute, once buffers and caches have warmed up.
+bool RunSoak(const BenchmarkOptions& options, BridgeDriver* driver) {
+  flutter::EncodableMap params{
+    {flutter::EncodableValue("payload"),
+     flutter::EncodableValue(std::string(static_cast<size_t>(options.soak_size), 'x'))}
+  };
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::minutes(options.soak_minutes);
+  Clock::time_point next_report = start + std::chrono::minutes(1);
+  MemorySample baseline;
+  uint64_t minute = 0;
+  uint64_t messages = 0;
+  driver->ResetLatency();
+  while (Clock::now() < end) {
+    if (!driver->Run("processMessage", params, options.soak_concurrency, kSoakRoundMessages)) {
+      std::cerr << "Bridge stalled after " << minute << " minutes of soak" << std::endl;
+      return false;
+    }
+    messages += kSoakRoundMessages;
+    if (Clock::now() < next_report) {
+      continue;
+    }
+    next_report += std::chrono::minutes(1);
+    MemorySample sample = SampleMemory();
+    if (++minute == 1) {
+      baseline = sample;
+    }
+    std::cout << "soak minute=" << minute << " msgs=" << messages << std::fixed
+              << std::setprecision(1) << " private=" << Megabytes(sample.private_bytes)
+              << "MB working_set=" << Megabytes(sample.working_set)
+              << "MB growth=" << Megabytes(sample.private_bytes) - Megabytes(baseline.private_bytes)
+              << "MB pending=" << driver->pending();
+    PrintLatency(driver->SummarizeLatency());
+    std::cout << std::endl;
+    driver->ResetLatency();
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: mcp_bridge_benchmark [--script path] [--sizes n,...]"
+                 " [--concurrency n,...] [--messages n] [--framing length-prefixed|ndjson]"
+                 " [--soak-minutes n] [--soak-size n] [--soak-concurrency n]"
+              << std::endl;
+    return 2;
+  }
+
+  BridgeDriver driver;
+  if (!driver.Start(options.script_path, options.framing)) {
+    std::cerr << "Failed to start " << options.script_path << std::endl;
+    return 1;
+  }
+  bool completed = RunMatrix(options, &driver) &&
+                   (options.soak_minutes == 0 || RunSoak(options, &driver));
+  driver.Stop();
+
+  if (driver.failures() > 0) {
+    std::cerr << driver.failures() << " requests failed" << std::endl;
+  }
+  return completed && driver.failures() == 0 ? 0 : 1;
+}
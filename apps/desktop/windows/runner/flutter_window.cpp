@@ -3,7 +3,6 @@
 #include <optional>
 
 #include "flutter/generated_plugin_registrant.h"
-// #include "mcp_channel_plugin.h"  // Temporarily disabled due to API compatibility issues
 
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
     : project_(project) {}
@@ -26,11 +25,13 @@ bool FlutterWindow::OnCreate() {
     return false;
   }
   RegisterPlugins(flutter_controller_->engine());
-  
-  // Register custom MCP channel plugin - Temporarily disabled due to API compatibility issues
-  // McpChannelPlugin::RegisterWithRegistrar(
-  //     flutter_controller_->engine()->GetRegistrarForPlugin("McpChannelPlugin"));
-  
+
+  // Start a bridge process while the engine boots, so the first MCP call
+  // doesn't wait on Node.
+  mcp_plugin_ = std::make_unique<McpChannelPlugin>(
+      flutter_controller_->engine()->messenger());
+  mcp_plugin_->Prewarm();
+
   SetChildContent(flutter_controller_->view()->GetNativeWindow());
 
   flutter_controller_->engine()->SetNextFrameCallback([&]() {
@@ -46,6 +47,7 @@ bool FlutterWindow::OnCreate() {
 }
 
 void FlutterWindow::OnDestroy() {
+  mcp_plugin_ = nullptr;
   if (flutter_controller_) {
     flutter_controller_ = nullptr;
   }
@@ -53,6 +55,13 @@ void FlutterWindow::OnDestroy() {
   Win32Window::OnDestroy();
 }
 
+void FlutterWindow::OnVisibilityChanged(bool visible) {
+  // Let the MCP plugin throttle event delivery and its bridges while hidden.
+  if (mcp_plugin_) {
+    mcp_plugin_->SetWindowVisible(visible);
+  }
+}
+
 LRESULT
 FlutterWindow::MessageHandler(HWND hwnd, UINT const message,
                               WPARAM const wparam,
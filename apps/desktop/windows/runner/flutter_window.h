@@ -6,6 +6,7 @@
 
 #include <memory>
 
+#include "mcp_channel_plugin.h"
 #include "win32_window.h"
 
 // A window that does nothing but host a Flutter view.
@@ -19,6 +20,7 @@ class FlutterWindow : public Win32Window {
   // Win32Window:
   bool OnCreate() override;
   void OnDestroy() override;
+  void OnVisibilityChanged(bool visible) override;
   LRESULT MessageHandler(HWND window, UINT const message, WPARAM const wparam,
                          LPARAM const lparam) noexcept override;
 
@@ -28,6 +30,9 @@ class FlutterWindow : public Win32Window {
 
   // The Flutter instance hosted by this window.
   std::unique_ptr<flutter::FlutterViewController> flutter_controller_;
+
+  // The MCP bridge on the engine's messenger; destroyed before the engine.
+  std::unique_ptr<McpChannelPlugin> mcp_plugin_;
 };
 
 #endif  // RUNNER_FLUTTER_WINDOW_H_
@@ -7,6 +7,134 @@
 
 const fs = require('fs');
 const path = require('path');
+const util = require('util');
+const v8 = require('v8');
+
+// stdout carries the protocol, so every console method writes to stderr
+// instead, each line tagged with its level for the plugin's log buffer (see
+// mcp_log_buffer.h). Without this a console.log here or in mcp-core would
+// land in the middle of the message stream.
+for (const [method, level] of [
+  ['debug', 'debug'],
+  ['log', 'info'],
+  ['info', 'info'],
+  ['warn', 'warn'],
+  ['error', 'error']
+]) {
+  console[method] = (...args) => {
+    const text = util.format(...args).replace(/\n/g, `\n[${level}] `);
+    process.stderr.write(`[${level}] ${text}\n`);
+  };
+}
+
+// Keep V8's compiled code for this script and mcp-core on disk between
+// launches (Node 22.1+; older versions just compile from source).
+const nodeModule = require('module');
+if (typeof nodeModule.enableCompileCache === 'function') {
+  nodeModule.enableCompileCache();
+}
+
+// Length-prefixed framing, negotiated in the initialize request. Must match
+// mcp_framing.h: a 16-byte little-endian header (magic, type, flags, payload
+// length, request id) followed by the payload. The magic byte never starts a
+// JSON line, so both framings can be told apart per message.
+const FRAMING_NEWLINE = 'ndjson';
+const FRAMING_LENGTH_PREFIXED = 'length-prefixed';
+const FRAME_MAGIC = 0xfb;
+const FRAME_HEADER_SIZE = 16;
+const FRAME_TYPE_JSON = 1;
+const FRAME_TYPE_BINARY = 2;
+const FRAME_TYPE_SHARED = 3;
+
+// Payloads at least this large go through the shared region the plugin
+// names in transport.sharedMemoryPath, which it only does along with
+// length-prefixed framing. Only a FRAME_TYPE_SHARED descriptor (inner type,
+// offset, length) crosses stdout.
+const SHARED_DESCRIPTOR_SIZE = 24;
+const SHARED_MIN_BYTES = 256 * 1024;
+
+// Responses to requests sent with chunked: true go out as 'chunk' messages
+// carrying consecutive slices of the response's JSON text, then a 'response'
+// with the chunk count in place of the data.
+const DEFAULT_CHUNK_BYTES = 64 * 1024;
+const MIN_CHUNK_BYTES = 1024;
+
+/**
+ * Ring allocator over the shared region. Regions are handed out in order and
+ * come back through $/releaseShared in the order the plugin read them, so
+ * the live span is always one contiguous run, possibly wrapped at the end.
+ */
+class SharedRing {
+  constructor(fd, size) {
+    this.fd = fd;
+    this.size = size;
+    this.regions = [];
+  }
+
+  // Returns the offset of a free run of |length| bytes, or -1 if none.
+  allocate(length) {
+    let offset = -1;
+    if (this.regions.length === 0) {
+      offset = length <= this.size ? 0 : -1;
+    } else {
+      const first = this.regions[0];
+      const last = this.regions[this.regions.length - 1];
+      const head = last.offset + last.length;
+      if (first.offset <= last.offset) {
+        if (head + length <= this.size) {
+          offset = head;
+        } else if (length <= first.offset) {
+          offset = 0;
+        }
+      } else if (head + length <= first.offset) {
+        offset = head;
+      }
+    }
+    if (offset >= 0) {
+      this.regions.push({ offset, length, released: false });
+    }
+    return offset;
+  }
+
+  release(offset, length) {
+    const region = this.regions.find((candidate) =>
+      !candidate.released && candidate.offset === offset && candidate.length === length);
+    if (region) {
+      region.released = true;
+    }
+    while (this.regions.length > 0 && this.regions[0].released) {
+      this.regions.shift();
+    }
+  }
+
+  // Copies |payload| into the region and returns its offset, or -1 to send
+  // it through the pipe instead.
+  write(payload) {
+    const offset = this.allocate(payload.length);
+    if (offset < 0) {
+      return -1;
+    }
+    try {
+      fs.writeSync(this.fd, payload, 0, payload.length, offset);
+    } catch (error) {
+      this.release(offset, payload.length);
+      return -1;
+    }
+    return offset;
+  }
+}
+
+function openSharedRing(sharedPath, size) {
+  if (!sharedPath || !(size > 0)) {
+    return null;
+  }
+  try {
+    return new SharedRing(fs.openSync(sharedPath, 'r+'), size);
+  } catch (error) {
+    console.error('Shared memory unavailable, using stdout only:', error.message);
+    return null;
+  }
+}
 
 // Import the MCP core functionality  
 const mcpCorePath = path.resolve(__dirname, '../../../../packages/mcp-core/dist');
@@ -46,9 +174,24 @@ class FlutterMCPBridge {
     this.isInitialized = false;
     this.pendingRequests = new Map();
     this.requestIdCounter = 0;
+    this.framing = FRAMING_NEWLINE;
+    this.inputBuffer = Buffer.alloc(0);
+    // Shared region for large payloads, or null to use stdout only.
+    this.sharedRing = null;
+    // Plugin-assigned wire ids by requestId, echoed back in every response.
+    this.wireIds = new Map();
+    // process.hrtime.bigint() at arrival by requestId, for processingUs.
+    this.startTimes = new Map();
+    // One AbortController per request in progress, aborted by $/cancelRequest.
+    this.cancellations = new Map();
+    // Chunk size by requestId, for requests whose response is chunked.
+    this.chunkSizes = new Map();
+    // Context blocks pushed by the plugin with $/context, by contextId:
+    // { version, content: Buffer of UTF-8, injectedVersion }. Edits count
+    // UTF-8 bytes, so they apply exactly as they did on the plugin's copy.
+    this.contextBlocks = new Map();
     
     // Setup stdio communication with C++ plugin
-    process.stdin.setEncoding('utf8');
     process.stdin.on('data', this.handleMessage.bind(this));
     process.stdin.on('error', (error) => {
       this.sendError('STDIN_ERROR', `Failed to read from stdin: ${error.message}`);
@@ -65,7 +208,33 @@ class FlutterMCPBridge {
 
   sendMessage(message) {
     const jsonMessage = JSON.stringify(message);
-    process.stdout.write(jsonMessage + '\n');
+    if (this.framing === FRAMING_LENGTH_PREFIXED) {
+      this.writeFrame(FRAME_TYPE_JSON, message.id || 0, Buffer.from(jsonMessage, 'utf8'));
+    } else {
+      process.stdout.write(jsonMessage + '\n');
+    }
+  }
+
+  writeFrame(type, id, payload) {
+    if (this.sharedRing && payload.length >= SHARED_MIN_BYTES) {
+      const offset = this.sharedRing.write(payload);
+      if (offset >= 0) {
+        const descriptor = Buffer.alloc(SHARED_DESCRIPTOR_SIZE);
+        descriptor.writeUInt8(type, 0);
+        descriptor.writeBigUInt64LE(BigInt(offset), 8);
+        descriptor.writeBigUInt64LE(BigInt(payload.length), 16);
+        type = FRAME_TYPE_SHARED;
+        payload = descriptor;
+      }
+    }
+    const header = Buffer.alloc(FRAME_HEADER_SIZE);
+    header.writeUInt8(FRAME_MAGIC, 0);
+    header.writeUInt8(type, 1);
+    header.writeUInt16LE(0, 2);
+    header.writeUInt32LE(payload.length, 4);
+    header.writeBigUInt64LE(BigInt(id), 8);
+    process.stdout.write(header);
+    process.stdout.write(payload);
   }
 
   sendError(type, message) {
@@ -80,11 +249,73 @@ class FlutterMCPBridge {
   }
 
   sendResponse(requestId, data, error = null) {
+    const id = this.wireIds.get(requestId);
+    this.wireIds.delete(requestId);
+    const startTime = this.startTimes.get(requestId);
+    this.startTimes.delete(requestId);
+    const chunkBytes = this.chunkSizes.get(requestId);
+    this.chunkSizes.delete(requestId);
+
+    // The plugin already failed a cancelled request; nobody wants the result.
+    if (this.isCancelled(requestId)) {
+      return;
+    }
+
+    // Lets the plugin's trace show how long the request spent in here.
+    const processingUs = startTime === undefined
+      ? undefined
+      : Number((process.hrtime.bigint() - startTime) / 1000n);
+
+    if (chunkBytes && !error && !(data instanceof Uint8Array)) {
+      return this.sendChunkedResponse(requestId, id, data, chunkBytes, processingUs);
+    }
+
+    // Binary results skip JSON and base64 entirely once framing allows it.
+    if (!error && id && this.framing === FRAMING_LENGTH_PREFIXED && data instanceof Uint8Array) {
+      this.writeFrame(FRAME_TYPE_BINARY, id, Buffer.from(data.buffer, data.byteOffset, data.byteLength));
+      return;
+    }
+
     this.sendMessage({
       type: 'response',
       requestId,
+      id,
       data,
       error,
+      processingUs,
+      timestamp: new Date().toISOString()
+    });
+  }
+
+  async sendChunkedResponse(requestId, id, data, chunkBytes, processingUs) {
+    const text = JSON.stringify(data === undefined ? null : data);
+    // Still aborted by $/cancelRequest after the handler has returned.
+    const controller = this.cancellations.get(requestId);
+    let seq = 0;
+    for (let offset = 0; offset < text.length || seq === 0;) {
+      if (controller && controller.signal.aborted) {
+        return;
+      }
+      let end = Math.min(offset + chunkBytes, text.length);
+      // Never split a surrogate pair across chunks.
+      const last = text.charCodeAt(end - 1);
+      if (end < text.length && last >= 0xd800 && last <= 0xdbff) {
+        end--;
+      }
+      this.sendMessage({ type: 'chunk', requestId, id, seq, data: text.slice(offset, end) });
+      offset = end;
+      seq++;
+      // Wait for stdout to drain rather than queue the whole response here.
+      if (process.stdout.writableNeedDrain) {
+        await new Promise((resolve) => process.stdout.once('drain', resolve));
+      }
+    }
+    this.sendMessage({
+      type: 'response',
+      requestId,
+      id,
+      chunks: seq,
+      processingUs,
       timestamp: new Date().toISOString()
     });
   }
@@ -98,23 +329,127 @@ class FlutterMCPBridge {
     });
   }
 
-  async handleMessage(rawData) {
-    try {
-      const lines = rawData.toString().trim().split('\n');
-      
-      for (const line of lines) {
-        if (!line.trim()) continue;
-        
-        const message = JSON.parse(line);
-        await this.processMessage(message);
+  handleMessage(chunk) {
+    // Split synchronously so overlapping 'data' events never share a partial
+    // message, then start the complete ones in order.
+    this.inputBuffer = this.inputBuffer.length ? Buffer.concat([this.inputBuffer, chunk]) : chunk;
+    const payloads = [];
+    let offset = 0;
+    while (offset < this.inputBuffer.length) {
+      if (this.inputBuffer[offset] === FRAME_MAGIC) {
+        if (this.inputBuffer.length - offset < FRAME_HEADER_SIZE) break;
+        const length = this.inputBuffer.readUInt32LE(offset + 4);
+        const end = offset + FRAME_HEADER_SIZE + length;
+        if (this.inputBuffer.length < end) break;
+        if (this.inputBuffer[offset + 1] === FRAME_TYPE_JSON) {
+          payloads.push(this.inputBuffer.toString('utf8', offset + FRAME_HEADER_SIZE, end));
+        }
+        offset = end;
+      } else {
+        const newline = this.inputBuffer.indexOf(0x0a, offset);
+        if (newline === -1) break;
+        const line = this.inputBuffer.toString('utf8', offset, newline).trim();
+        if (line) payloads.push(line);
+        offset = newline + 1;
       }
-    } catch (error) {
-      this.sendError('MESSAGE_PARSE_ERROR', `Failed to parse message: ${error.message}`);
     }
+    this.inputBuffer = this.inputBuffer.subarray(offset);
+
+    // Requests are not awaited, so a cancel or a ping packed into the same
+    // write as a long request is handled at once. Each handler's synchronous
+    // part, which covers notifications such as $/context and the context
+    // lookup of processMessage, still runs in arrival order.
+    for (const payload of payloads) {
+      let message;
+      try {
+        message = JSON.parse(payload);
+      } catch (error) {
+        this.sendError('MESSAGE_PARSE_ERROR', `Failed to parse message: ${error.message}`);
+        continue;
+      }
+      const handled = Array.isArray(message)
+        ? this.processBatch(message)
+        : this.processMessage(message);
+      handled.catch((error) => {
+        this.sendError('PROCESSING_ERROR', `Failed to process message: ${error.message}`);
+      });
+    }
+  }
+
+  async processBatch(messages) {
+    // Requests in a batch are independent, so run them concurrently; each one
+    // answers with its own response, which the plugin routes by id.
+    await Promise.all(messages.map((message) => this.processMessage(message)));
+  }
+
+  isCancelled(requestId) {
+    const controller = this.cancellations.get(requestId);
+    return controller ? controller.signal.aborted : false;
+  }
+
+  cancelRequest(params = {}) {
+    const controller = this.cancellations.get(params.requestId);
+    if (controller) {
+      controller.abort();
+    }
+  }
+
+  // Resolves with |promise|, or rejects as soon as |requestId| is cancelled so
+  // the caller stops waiting on work the plugin has abandoned.
+  raceCancellation(requestId, promise) {
+    const controller = this.cancellations.get(requestId);
+    if (!controller) {
+      return promise;
+    }
+    return new Promise((resolve, reject) => {
+      const onAbort = () => reject(new Error('Request cancelled'));
+      if (controller.signal.aborted) {
+        onAbort();
+        return;
+      }
+      controller.signal.addEventListener('abort', onAbort, { once: true });
+      promise.then(resolve, reject).finally(() => {
+        controller.signal.removeEventListener('abort', onAbort);
+      });
+    });
   }
 
   async processMessage(message) {
-    const { method, params, requestId } = message;
+    const { method, params, requestId, id } = message;
+
+    // Notifications: no response, no wire id.
+    if (method === '$/cancelRequest') {
+      this.cancelRequest(params);
+      return;
+    }
+    if (method === '$/context') {
+      this.applyContext(params);
+      return;
+    }
+    if (method === '$/releaseShared') {
+      if (this.sharedRing) {
+        this.sharedRing.release(params.offset, params.length);
+      }
+      return;
+    }
+
+    // Answered straight away, even with requests in flight, so the plugin's
+    // timing covers the pipe and the event loop, not MCP work.
+    if (method === 'ping') {
+      this.sendMessage({ type: 'pong', id, requestId });
+      return;
+    }
+
+    if (id) {
+      this.wireIds.set(requestId, id);
+    }
+    if (params && params.chunked) {
+      this.chunkSizes.set(requestId,
+        Math.max(Number(params.chunkBytes) || DEFAULT_CHUNK_BYTES, MIN_CHUNK_BYTES));
+    }
+    this.startTimes.set(requestId, process.hrtime.bigint());
+    const controller = new AbortController();
+    this.cancellations.set(requestId, controller);
 
     try {
       switch (method) {
@@ -150,12 +485,30 @@ class FlutterMCPBridge {
         type: 'METHOD_ERROR',
         message: `Error in ${method}: ${error.message}`
       });
+    } finally {
+      if (this.cancellations.get(requestId) === controller) {
+        this.cancellations.delete(requestId);
+      }
     }
   }
 
   async initialize(params, requestId) {
     try {
-      const { mcpServers = {}, globalConfig = {} } = params;
+      const { mcpServers = {}, globalConfig = {}, transport = {} } = params;
+
+      // Acknowledge length-prefixed framing on the current framing, then
+      // switch; the plugin switches its own outbound side on the ack.
+      if (transport.framing === FRAMING_LENGTH_PREFIXED) {
+        this.sendMessage({ type: 'transport', framing: FRAMING_LENGTH_PREFIXED });
+        this.framing = FRAMING_LENGTH_PREFIXED;
+      }
+      // The plugin creates the region on its side first and leaves it out
+      // for transport.sharedMemory: false; it stays the same for the life of
+      // this process.
+      if (this.framing === FRAMING_LENGTH_PREFIXED && !this.sharedRing) {
+        this.sharedRing = openSharedRing(transport.sharedMemoryPath,
+          Number(transport.sharedMemoryBytes));
+      }
       
       // Initialize with desktop mode enabled
       this.mcpManager = new MCPManager(true); // true = desktop mode
@@ -199,6 +552,9 @@ class FlutterMCPBridge {
         serverCount: Object.keys(mcpServers).length,
         enabledCount
       });
+
+      // The server set was just rebuilt; no serverId means all of them.
+      this.sendEvent('capabilitiesChanged', {});
       
     } catch (error) {
       this.sendResponse(requestId, null, {
@@ -218,10 +574,15 @@ class FlutterMCPBridge {
     }
 
     try {
-      const { message, enabledServerIds = [], conversationMetadata = {} } = params;
+      const { message, enabledServerIds = [], conversationMetadata = {}, contextRefs = [] } = params;
+
+      await this.injectContextRefs(contextRefs);
       
       // Process through chat bridge
-      const response = await this.chatBridge.processMessage(message, enabledServerIds);
+      const response = await this.raceCancellation(
+        requestId,
+        this.chatBridge.processMessage(message, enabledServerIds)
+      );
       
       this.sendResponse(requestId, {
         response: response.response,
@@ -250,9 +611,12 @@ class FlutterMCPBridge {
       const { message, enabledServerIds = [] } = params;
       
       // Use the ChatMCPBridge streaming method
-      await this.chatBridge.streamResponse(
+      await this.raceCancellation(requestId, this.chatBridge.streamResponse(
         message,
         (chunk) => {
+          if (this.isCancelled(requestId)) {
+            return;
+          }
           if (chunk === '[DONE]') {
             this.sendEvent('stream_complete', {
               requestId,
@@ -267,7 +631,7 @@ class FlutterMCPBridge {
           }
         },
         enabledServerIds
-      );
+      ));
       
       // Send final response
       this.sendResponse(requestId, {
@@ -336,6 +700,12 @@ class FlutterMCPBridge {
         });
         return;
       }
+
+      // The plugin caches the all-servers listing under an empty serverId.
+      if (!serverId) {
+        this.sendResponse(requestId, { servers: await this.getAllCapabilities() });
+        return;
+      }
       
       // Get available servers and find the requested one
       const availableServers = this.mcpManager.getAvailableServers();
@@ -368,6 +738,67 @@ class FlutterMCPBridge {
     }
   }
 
+  applyContext(params) {
+    const { op, contextId, version, baseVersion } = params;
+    const block = this.contextBlocks.get(contextId);
+    if (op === 'remove') {
+      this.contextBlocks.delete(contextId);
+      return;
+    }
+    if (op === 'set') {
+      this.contextBlocks.set(contextId, {
+        version,
+        content: Buffer.from(params.content, 'utf8'),
+        injectedVersion: 0
+      });
+      return;
+    }
+
+    // A delta against a version this bridge does not hold leaves the block
+    // unusable until the plugin resends it whole.
+    const current = block ? block.version : 0;
+    if (current !== baseVersion) {
+      console.error(`Context ${contextId} is at ${current}, not ${baseVersion}; dropping it`);
+      this.contextBlocks.delete(contextId);
+      return;
+    }
+    let content = block ? block.content : Buffer.alloc(0);
+    if (op === 'append') {
+      content = Buffer.concat([content, Buffer.from(params.text, 'utf8')]);
+    } else if (op === 'splice') {
+      for (const edit of params.edits) {
+        content = Buffer.concat([
+          content.subarray(0, edit.offset),
+          Buffer.from(edit.text, 'utf8'),
+          content.subarray(edit.offset + edit.deleteCount)
+        ]);
+      }
+    }
+    this.contextBlocks.set(contextId, { version, content, injectedVersion: 0 });
+  }
+
+  // Hands the blocks named by |contextRefs| ({id, version}, pinned by the
+  // plugin) to the chat bridge, skipping those it already has at that
+  // version. Throws if one is missing here. The lookup must stay ahead of the
+  // first await on the request's path, so it sees exactly the $/context
+  // notifications read before the request.
+  async injectContextRefs(contextRefs) {
+    const documents = [];
+    for (const { id, version } of contextRefs) {
+      const block = this.contextBlocks.get(id);
+      if (!block || block.version !== version) {
+        throw new Error(`Context block ${id} version ${version} is not available`);
+      }
+      if (block.injectedVersion !== version) {
+        documents.push({ filename: id, content: block.content.toString('utf8') });
+        block.injectedVersion = version;
+      }
+    }
+    if (documents.length > 0) {
+      await this.chatBridge.injectContext(documents);
+    }
+  }
+
   async injectContext(params, requestId) {
     try {
       const { context, conversationId } = params;
@@ -447,6 +878,18 @@ class FlutterMCPBridge {
   }
 }
 
-// Start the bridge
-const bridge = new FlutterMCPBridge();
-console.error('MCP Bridge started and ready for communication');
\ No newline at end of file
+// Start the bridge. With node --snapshot-blob mcp_bridge.snapshot.blob
+// --build-snapshot, everything above is captured in the snapshot and the
+// bridge itself starts when the plugin boots node from it, since stdio does
+// not carry over. The snapshot entry can only require built-in modules, so
+// build it from a bundle of this script and mcp-core.
+function startBridge() {
+  new FlutterMCPBridge();
+  console.error('MCP Bridge started and ready for communication');
+}
+
+if (v8.startupSnapshot && v8.startupSnapshot.isBuildingSnapshot()) {
+  v8.startupSnapshot.setDeserializeMainFunction(startBridge);
+} else {
+  startBridge();
+}
\ No newline at end of file
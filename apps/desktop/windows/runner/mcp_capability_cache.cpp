@@ -0,0 +1,133 @@
+#include "mcp_capability_cache.h"
+
+McpCapabilityCache::McpCapabilityCache() = default;
+
+McpCapabilityCache::~McpCapabilityCache() = default;
+
+bool McpCapabilityCache::GetOrQueue(const std::string& server_id, bool refresh,
+                                    McpCapabilityWaiter waiter, uint64_t* generation) {
+  int64_t version;
+  flutter::EncodableValue capabilities;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = entries_.try_emplace(server_id);
+    Entry& entry = it->second;
+    if (inserted) {
+      entry.generation = next_generation_++;
+    }
+    if (!entry.fresh || refresh) {
+      entry.waiters.push_back(std::move(waiter));
+      if (entry.fetching) {
+        return false;
+      }
+      entry.fetching = true;
+      *generation = entry.generation;
+      return true;
+    }
+    version = entry.version;
+    // Callers that are up to date get no payload, so skip the copy.
+    if (waiter.known_version != version) {
+      capabilities = entry.capabilities;
+    }
+  }
+  Answer(&waiter, server_id, version, capabilities);
+  return false;
+}
+
+bool McpCapabilityCache::Complete(const std::string& server_id, uint64_t* generation,
+                                  flutter::EncodableValue capabilities) {
+  int64_t version;
+  std::vector<McpCapabilityWaiter> waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(server_id);
+    if (it == entries_.end()) {
+      // Cleared while the fetch was in flight; nobody is waiting.
+      return true;
+    }
+    Entry& entry = it->second;
+    if (entry.generation != *generation) {
+      *generation = entry.generation;
+      return false;
+    }
+    if (entry.version == 0 || !(entry.capabilities == capabilities)) {
+      entry.version = next_version_++;
+      entry.capabilities = capabilities;
+    }
+    entry.fresh = true;
+    entry.fetching = false;
+    version = entry.version;
+    waiters.swap(entry.waiters);
+  }
+  for (auto& waiter : waiters) {
+    Answer(&waiter, server_id, version, capabilities);
+  }
+  return true;
+}
+
+void McpCapabilityCache::Fail(const std::string& server_id, const std::string& code,
+                              const std::string& message) {
+  std::vector<McpCapabilityWaiter> waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(server_id);
+    if (it == entries_.end()) {
+      return;
+    }
+    it->second.fetching = false;
+    waiters.swap(it->second.waiters);
+  }
+  for (auto& waiter : waiters) {
+    waiter.result->Error(code, message);
+  }
+}
+
+void McpCapabilityCache::Invalidate(const std::string& server_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (server_id.empty()) {
+    for (auto& [id, entry] : entries_) {
+      entry.fresh = false;
+      entry.generation = next_generation_++;
+    }
+    return;
+  }
+  auto it = entries_.find(server_id);
+  if (it != entries_.end()) {
+    it->second.fresh = false;
+    it->second.generation = next_generation_++;
+  }
+  // The empty id caches the all-servers listing, which includes this one.
+  auto all = entries_.find(std::string());
+  if (all != entries_.end()) {
+    all->second.fresh = false;
+    all->second.generation = next_generation_++;
+  }
+}
+
+void McpCapabilityCache::Clear(const std::string& code, const std::string& message) {
+  std::unordered_map<std::string, Entry> entries;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries.swap(entries_);
+  }
+  for (auto& [id, entry] : entries) {
+    for (auto& waiter : entry.waiters) {
+      waiter.result->Error(code, message);
+    }
+  }
+}
+
+// static
+void McpCapabilityCache::Answer(McpCapabilityWaiter* waiter, const std::string& server_id,
+                                int64_t version, const flutter::EncodableValue& capabilities) {
+  bool unchanged = waiter->known_version == version;
+  flutter::EncodableMap response{
+    {flutter::EncodableValue("serverId"), flutter::EncodableValue(server_id)},
+    {flutter::EncodableValue("version"), flutter::EncodableValue(version)},
+    {flutter::EncodableValue("unchanged"), flutter::EncodableValue(unchanged)}
+  };
+  if (!unchanged) {
+    response[flutter::EncodableValue("capabilities")] = capabilities;
+  }
+  waiter->result->Success(flutter::EncodableValue(std::move(response)));
+}
@@ -0,0 +1,82 @@
+#ifndef RUNNER_MCP_CAPABILITY_CACHE_H_
+#define RUNNER_MCP_CAPABILITY_CACHE_H_
+
+#include <flutter/encodable_value.h>
+#include <flutter/method_result.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A getCapabilities call waiting for its server's capabilities.
+struct McpCapabilityWaiter {
+  // Version the caller already holds; 0 when it holds none.
+  int64_t known_version = 0;
+  std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result;
+};
+
+// Capabilities reported by the bridge, cached per serverId.
+//
+// Each distinct capabilities value of a server gets a new version, so a
+// caller that passes its cached version is told "unchanged" without the
+// payload. Concurrent misses for one server share a single bridge request.
+// Entries go stale on a capabilitiesChanged event; a stale entry refetched to
+// an equal value keeps its version. Thread-safe; results are answered with
+// no lock held.
+class McpCapabilityCache {
+ public:
+  McpCapabilityCache();
+  ~McpCapabilityCache();
+
+  // Prevent copying.
+  McpCapabilityCache(McpCapabilityCache const&) = delete;
+  McpCapabilityCache& operator=(McpCapabilityCache const&) = delete;
+
+  // Answers |waiter| from the cache if |server_id| is fresh and |refresh| is
+  // false. Otherwise queues it and, when no fetch is in flight, returns true
+  // with |*generation| set: the caller fetches and reports back with
+  // Complete or Fail.
+  bool GetOrQueue(const std::string& server_id, bool refresh, McpCapabilityWaiter waiter,
+                  uint64_t* generation);
+
+  // Stores fetched |capabilities| and answers the queued waiters. Returns
+  // false if |server_id| was invalidated after the fetch began; the waiters
+  // stay queued and the caller fetches again with the updated |*generation|.
+  // A fetch that outlived Clear is dropped.
+  bool Complete(const std::string& server_id, uint64_t* generation,
+                flutter::EncodableValue capabilities);
+
+  // Fails the queued waiters of |server_id|. The entry stays stale.
+  void Fail(const std::string& server_id, const std::string& code, const std::string& message);
+
+  // Marks |server_id|, or every server when it is empty, as stale.
+  void Invalidate(const std::string& server_id);
+
+  // Drops every entry and fails the queued waiters with |code|.
+  void Clear(const std::string& code, const std::string& message);
+
+ private:
+  struct Entry {
+    bool fresh = false;
+    bool fetching = false;
+    // Renewed by Invalidate, so a fetch that straddles it is not trusted.
+    // Drawn from next_generation_, so they stay unique across Clear.
+    uint64_t generation = 0;
+    int64_t version = 0;
+    flutter::EncodableValue capabilities;
+    std::vector<McpCapabilityWaiter> waiters;
+  };
+
+  static void Answer(McpCapabilityWaiter* waiter, const std::string& server_id, int64_t version,
+                     const flutter::EncodableValue& capabilities);
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  int64_t next_version_ = 1;
+  uint64_t next_generation_ = 1;
+};
+
+#endif  // RUNNER_MCP_CAPABILITY_CACHE_H_
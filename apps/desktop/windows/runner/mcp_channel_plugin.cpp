@@ -1,63 +1,369 @@
 #include "mcp_channel_plugin.h"
 
-#include <flutter/plugin_registrar_windows.h>
+#include "mcp_codec_serializer.h"
+#include "mcp_framing.h"
+#include "mcp_json.h"
+#include "mcp_log_buffer.h"
+#include "mcp_metrics.h"
+#include "mcp_trace.h"
+#include "utils.h"
+
+#include <flutter/method_result_functions.h>
 #include <flutter/standard_method_codec.h>
 #include <windows.h>
+#include <algorithm>
 #include <iostream>
-#include <sstream>
 #include <chrono>
+#include <thread>
 // Simple JSON handling - in production use nlohmann/json or similar
 // #include <nlohmann/json.hpp>
 
-// Static registration method
-void McpChannelPlugin::RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar) {
-  // Create and register the MCP channel plugin with proper channels
-  auto channel = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
-      flutter::FlutterDesktopRegistrarGetMessenger(registrar),
-      "agentengine.mcp",
-      &flutter::StandardMethodCodec::GetInstance());
-
-  auto event_channel = std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
-      flutter::FlutterDesktopRegistrarGetMessenger(registrar),
-      "agentengine.mcp.events",
-      &flutter::StandardMethodCodec::GetInstance());
-
-  // Create plugin instance with channels
-  auto plugin = std::make_unique<McpChannelPlugin>();
-  
-  // Set up stream handler for events
-  plugin->stream_handler_ = std::make_unique<McpEventStreamHandler>(plugin.get());
-  event_channel->SetStreamHandler(std::move(plugin->stream_handler_));
+namespace {
 
-  // Set method call handler
-  channel->SetMethodCallHandler([plugin = plugin.get()](const auto& call, auto result) {
-    plugin->HandleMethodCall(call, std::move(result));
-  });
+// Upper bound for transport.flushLatencyUs; longer waits would be noticeable.
+constexpr int64_t kMaxFlushLatencyUs = 10000;
+constexpr int64_t kDefaultMaxBatchBytes = 256 * 1024;
 
-  // Keep instances alive - they'll be destroyed when the registrar is destroyed
-  flutter::FlutterDesktopRegistrarSetDestructionHandler(
-      registrar, [](FlutterDesktopPluginRegistrarRef) {
-        // Plugin cleanup will happen automatically when unique_ptrs go out of scope
-      });
+// How long testConnection waits for a process to answer its ping.
+constexpr int64_t kDefaultPingTimeoutMs = 2000;
 
-  // Keep static references to prevent deallocation
-  static auto channel_ref = std::move(channel);
-  static auto event_channel_ref = std::move(event_channel);
-  static auto plugin_ref = std::move(plugin);
-  
-  std::cout << "✓ MCP Channel Plugin registered successfully" << std::endl;
+// Resolution of request deadlines.
+constexpr std::chrono::milliseconds kDeadlineTick(10);
+
+// An idempotent request is replayed at most this many times, so a request
+// that crashes the bridge cannot do so forever.
+constexpr uint32_t kMaxReplays = 2;
+
+// A restarted bridge that has not answered its initialize by then fails the
+// requests waiting to be replayed on it.
+constexpr int64_t kRestartInitTimeoutMs = 60000;
+
+// Most entries one getLogs call returns.
+constexpr int64_t kMaxLogQueryEntries = 1000;
+
+// Bounds for events.frameIntervalMs.
+constexpr int64_t kDefaultFrameIntervalMs = 16;
+constexpr int64_t kMaxFrameIntervalMs = 250;
+
+// Bounds for background.frameIntervalMs, used while the window is hidden.
+constexpr int64_t kDefaultBackgroundFrameIntervalMs = 1000;
+constexpr int64_t kMaxBackgroundFrameIntervalMs = 10000;
+
+
+// Returns the integer option |key| of |options|, or |default_value| if it is
+// absent or not an integer.
+int64_t GetIntOption(const flutter::EncodableMap& options, const char* key,
+                     int64_t default_value) {
+  auto it = options.find(flutter::EncodableValue(key));
+  if (it == options.end()) {
+    return default_value;
+  }
+  if (const auto* value = std::get_if<int32_t>(&it->second)) {
+    return *value;
+  }
+  if (const auto* value = std::get_if<int64_t>(&it->second)) {
+    return *value;
+  }
+  return default_value;
+}
+
+// Returns the numeric option |key| of |options|, or |default_value| if it is
+// absent or not a number.
+double GetDoubleOption(const flutter::EncodableMap& options, const char* key,
+                       double default_value) {
+  auto it = options.find(flutter::EncodableValue(key));
+  if (it == options.end()) {
+    return default_value;
+  }
+  if (const auto* value = std::get_if<double>(&it->second)) {
+    return *value;
+  }
+  return static_cast<double>(GetIntOption(options, key, static_cast<int64_t>(default_value)));
+}
+
+// Returns the string option |key| of |options|, or nullptr.
+const std::string* GetStringOption(const flutter::EncodableMap& options, const char* key) {
+  auto it = options.find(flutter::EncodableValue(key));
+  return it != options.end() ? std::get_if<std::string>(&it->second) : nullptr;
+}
+
+// Returns the map option |key| of |options|, or nullptr.
+const flutter::EncodableMap* GetMapOption(const flutter::EncodableMap& options, const char* key) {
+  auto it = options.find(flutter::EncodableValue(key));
+  return it != options.end() ? std::get_if<flutter::EncodableMap>(&it->second) : nullptr;
+}
+
+// True if the option |key| of |options| is the boolean true.
+bool GetBoolOption(const flutter::EncodableMap& options, const char* key) {
+  auto it = options.find(flutter::EncodableValue(key));
+  return it != options.end() && it->second == flutter::EncodableValue(true);
+}
+
+// True if the caller marked |request| safe to send twice.
+bool IsIdempotent(const flutter::EncodableMap& request) {
+  return GetBoolOption(request, "idempotent");
+}
+
+// Moves the member |key| out of |map|, or returns null if there is none.
+flutter::EncodableValue TakeMember(flutter::EncodableMap* map, const char* key) {
+  auto it = map->find(flutter::EncodableValue(key));
+  return it != map->end() ? std::move(it->second) : flutter::EncodableValue();
+}
+
+// DecodeJsonToEncodableValue, accounted in McpMetrics.
+bool DecodeMessage(std::string_view message, flutter::EncodableValue* value) {
+  McpMetrics& metrics = McpMetrics::Get();
+  McpScopedTimer timer(metrics.parse_ns);
+  if (!DecodeJsonToEncodableValue(message, value)) {
+    McpMetrics::Add(metrics.parse_errors);
+    return false;
+  }
+  return true;
+}
+
+// Like DecodeMessage, but transcodes |message| into the encoding of a
+// method call result and wraps it for McpCodecSerializer.
+bool TranscodeMessage(std::string_view message, flutter::EncodableValue* value) {
+  McpMetrics& metrics = McpMetrics::Get();
+  McpScopedTimer timer(metrics.parse_ns);
+  std::vector<uint8_t> bytes;
+  if (!TranscodeJsonToStandardCodec(message, McpCodecSerializer::kResultOffset, &bytes)) {
+    McpMetrics::Add(metrics.parse_errors);
+    return false;
+  }
+  *value = McpCodecSerializer::WrapEncoded(std::move(bytes));
+  return true;
+}
+
+// Arguments of a processMessage call that do not change its response, left
+// out of its result cache key.
+constexpr const char* kPerCallKeys[] = {"requestId", "timeoutMs", "idempotent", "chunked",
+                                        "cache", "priority"};
+
+// Reads request.priority into |priority|, normal when absent. Returns false
+// if it names no lane.
+bool GetPriorityOption(const flutter::EncodableMap& request, McpPriority* priority) {
+  *priority = McpPriority::kNormal;
+  auto it = request.find(flutter::EncodableValue("priority"));
+  if (it == request.end() || it->second.IsNull()) {
+    return true;
+  }
+  const auto* name = std::get_if<std::string>(&it->second);
+  return name && ParseMcpPriority(*name, priority);
+}
+
+// Reads the request.cache option of a processMessage call into |tool| and
+// |ttl_ms|, where a missing ttlMs is left unchanged. Returns false if the
+// call did not opt in.
+bool GetCacheOption(const flutter::EncodableMap& request, std::string* tool, int64_t* ttl_ms) {
+  auto it = request.find(flutter::EncodableValue("cache"));
+  if (it == request.end() || it->second == flutter::EncodableValue(false) ||
+      it->second.IsNull()) {
+    return false;
+  }
+  const std::string* name = GetStringOption(request, "tool");
+  if (const auto* options = std::get_if<flutter::EncodableMap>(&it->second)) {
+    if (const std::string* cache_tool = GetStringOption(*options, "tool")) {
+      name = cache_tool;
+    }
+    *ttl_ms = GetIntOption(*options, "ttlMs", *ttl_ms);
+  }
+  tool->assign(name ? *name : std::string());
+  return true;
+}
+
+// |request| without its kPerCallKeys.
+flutter::EncodableMap CacheKeyParams(const flutter::EncodableMap& request) {
+  flutter::EncodableMap params = request;
+  for (const char* key : kPerCallKeys) {
+    params.erase(flutter::EncodableValue(key));
+  }
+  return params;
+}
+
+// Appends a {"method": "$/context"} notification with |fields| as its params
+// to |out|; |fields| is a comma-separated list of JSON members.
+void AppendContextNotification(std::string_view fields, std::string* out) {
+  out->append("{\"method\":\"$/context\",\"params\":{");
+  out->append(fields);
+  out->append("}}");
+}
+
+// Appends the "op", "contextId" and "version" members of a $/context
+// notification to |out|.
+void AppendContextHeader(const char* op, const std::string& context_id, int64_t version,
+                         std::string* out) {
+  out->append("\"op\":");
+  AppendJsonString(op, out);
+  out->append(",\"contextId\":");
+  AppendJsonString(context_id, out);
+  out->append(",\"version\":");
+  out->append(std::to_string(version));
+}
+
+// Checks request.contextRefs of a processMessage call against |contexts|
+// and writes them to |refs| as {id, version} maps. Returns false with
+// |code| and |message| set if a block is missing or at another version.
+bool ResolveContextRefs(const flutter::EncodableList& refs_in, const McpContextStore& contexts,
+                        flutter::EncodableList* refs, std::string* code, std::string* message) {
+  for (const auto& ref : refs_in) {
+    const std::string* id = std::get_if<std::string>(&ref);
+    int64_t version = 0;
+    if (const auto* fields = std::get_if<flutter::EncodableMap>(&ref)) {
+      id = GetStringOption(*fields, "id");
+      version = GetIntOption(*fields, "version", 0);
+    }
+    const McpContextStore::Block* block = id ? contexts.Find(*id) : nullptr;
+    if (!block) {
+      *code = "CONTEXT_NOT_FOUND";
+      *message = id ? "No context block " + *id : "contextRefs entries need an id";
+      return false;
+    }
+    if (version != 0 && version != block->version) {
+      *code = "CONTEXT_VERSION_MISMATCH";
+      *message = "Context block " + *id + " is at version " + std::to_string(block->version);
+      return false;
+    }
+    refs->push_back(flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("id"), flutter::EncodableValue(*id)},
+      {flutter::EncodableValue("version"), flutter::EncodableValue(block->version)}
+    }));
+  }
+  return true;
 }
 
-McpChannelPlugin::McpChannelPlugin() 
-    : is_initialized_(false), node_process_(std::make_unique<NodeJsProcess>()) {
+// Points |call| at |request|, or at a copy of it in |pinned| with its
+// contextRefs resolved by ResolveContextRefs. Returns false with |code| and
+// |message| set if they do not resolve.
+bool PinContextRefs(const flutter::EncodableMap& request, const McpContextStore& contexts,
+                    flutter::EncodableMap* pinned, const flutter::EncodableMap** call,
+                    std::string* code, std::string* message) {
+  *call = &request;
+  auto refs_it = request.find(flutter::EncodableValue("contextRefs"));
+  if (refs_it == request.end()) {
+    return true;
+  }
+  const auto* refs = std::get_if<flutter::EncodableList>(&refs_it->second);
+  flutter::EncodableList pinned_refs;
+  if (!refs) {
+    *code = "INVALID_ARGUMENTS";
+    *message = "contextRefs must be a list";
+    return false;
+  }
+  if (!ResolveContextRefs(*refs, contexts, &pinned_refs, code, message)) {
+    return false;
+  }
+  *pinned = request;
+  (*pinned)[flutter::EncodableValue("contextRefs")] =
+      flutter::EncodableValue(std::move(pinned_refs));
+  *call = pinned;
+  return true;
+}
+
+// True if |event| is a cacheInvalidated event. |server_id| and |tool| are
+// its data.serverId and data.tool, each empty when absent.
+bool IsCacheInvalidated(const flutter::EncodableValue& event, std::string* server_id,
+                        std::string* tool) {
+  const auto* fields = std::get_if<flutter::EncodableMap>(&event);
+  const std::string* name = fields ? GetStringOption(*fields, "event") : nullptr;
+  if (!name || *name != "cacheInvalidated") {
+    return false;
+  }
+  const flutter::EncodableMap* data = GetMapOption(*fields, "data");
+  const std::string* id = data ? GetStringOption(*data, "serverId") : nullptr;
+  const std::string* tool_name = data ? GetStringOption(*data, "tool") : nullptr;
+  server_id->assign(id ? *id : std::string());
+  tool->assign(tool_name ? *tool_name : std::string());
+  return true;
+}
+
+// True if |event| is a capabilitiesChanged event. |server_id| is its
+// data.serverId, or empty when every server changed.
+bool IsCapabilitiesChanged(const flutter::EncodableValue& event, std::string* server_id) {
+  const auto* fields = std::get_if<flutter::EncodableMap>(&event);
+  const std::string* name = fields ? GetStringOption(*fields, "event") : nullptr;
+  if (!name || *name != "capabilitiesChanged") {
+    return false;
+  }
+  const flutter::EncodableMap* data = GetMapOption(*fields, "data");
+  const std::string* id = data ? GetStringOption(*data, "serverId") : nullptr;
+  server_id->assign(id ? *id : std::string());
+  return true;
+}
+
+flutter::EncodableValue Int64Value(uint64_t value) {
+  return flutter::EncodableValue(static_cast<int64_t>(value));
+}
+
+// Converts a summary in microseconds to the map reported to Dart.
+flutter::EncodableMap LatencySummaryToMap(const McpLatencySummary& summary) {
+  return flutter::EncodableMap{
+    {flutter::EncodableValue("samples"), flutter::EncodableValue(static_cast<int64_t>(summary.count))},
+    {flutter::EncodableValue("p50Us"), flutter::EncodableValue(static_cast<int64_t>(summary.p50))},
+    {flutter::EncodableValue("p95Us"), flutter::EncodableValue(static_cast<int64_t>(summary.p95))},
+    {flutter::EncodableValue("p99Us"), flutter::EncodableValue(static_cast<int64_t>(summary.p99))},
+    {flutter::EncodableValue("maxUs"), flutter::EncodableValue(static_cast<int64_t>(summary.max))}
+  };
+}
+
+// What a request failed with |code| tells the server's concurrency limit: a
+// timeout is taken as overload, and a request cancelled or lost with its
+// bridge says nothing. Errors the server answered with still took a round
+// trip.
+McpConcurrencyLimiter::Outcome OutcomeForError(const std::string& code) {
+  if (code == "TIMEOUT") {
+    return McpConcurrencyLimiter::Outcome::kTimedOut;
+  }
+  if (code == "CANCELLED" || code == "DISPOSED" || code == "BRIDGE_CRASHED" ||
+      code == "SEND_FAILED") {
+    return McpConcurrencyLimiter::Outcome::kDropped;
+  }
+  return McpConcurrencyLimiter::Outcome::kCompleted;
+}
+
+}  // namespace
+
+void McpChannelPlugin::SetWindowVisible(bool visible) {
+  if (window_visible_ == visible) {
+    return;
+  }
+  window_visible_ = visible;
+  ApplyWindowVisibility();
+}
+
+McpChannelPlugin::McpChannelPlugin(flutter::BinaryMessenger* messenger)
+    : method_channel_(std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+          messenger, "agentengine.mcp",
+          &flutter::StandardMethodCodec::GetInstance(&McpCodecSerializer::GetInstance()))),
+      event_channel_(std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+          messenger, "agentengine.mcp.events", &flutter::StandardMethodCodec::GetInstance())),
+      process_pool_(std::make_unique<NodeJsProcessPool>()),
+      request_deadlines_(kDeadlineTick),
+      dispatcher_(std::make_unique<McpPlatformDispatcher>()),
+      frame_interval_(kDefaultFrameIntervalMs),
+      background_frame_interval_(kDefaultBackgroundFrameIntervalMs),
+      is_initialized_(false) {
   // Get the MCP script path relative to the executable
   mcp_script_path_ = GetMcpScriptPath();
+  dispatcher_->SetFrameCallback([this]() { DeliverEvents(); });
+  // A push that waits stalls its bridge's pipe until the next drain, and a
+  // frame can be a background interval away; drain as soon as the queue fills.
+  event_queue_.SetFullCallback([this]() { dispatcher_->Post([this]() { DeliverEvents(); }); });
+
+  auto stream_handler = std::make_unique<McpEventStreamHandler>(this);
+  stream_handler_ = stream_handler.get();
+  event_channel_->SetStreamHandler(std::move(stream_handler));
+  method_channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+    HandleMethodCall(call, std::move(result));
+  });
 }
 
 McpChannelPlugin::~McpChannelPlugin() {
-  if (node_process_) {
-    node_process_->Stop();
-  }
+  // Nothing may call into the plugin once it is gone.
+  method_channel_->SetMethodCallHandler(nullptr);
+  event_channel_->SetStreamHandler(nullptr);
+  stream_handler_ = nullptr;
+  StopProcessPool();
 }
 
 void McpChannelPlugin::HandleMethodCall(
@@ -65,8 +371,24 @@ void McpChannelPlugin::HandleMethodCall(
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
   
   const std::string& method = method_call.method_name();
-  const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  McpTraceSpan span("HandleMethodCall");
+  span.set_detail(method);
+
+  // These take no arguments, so Dart may send none.
+  if (method == "getMetrics") {
+    GetMetrics(std::move(result));
+    return;
+  }
+  if (method == "flushTrace") {
+    FlushTrace(std::move(result));
+    return;
+  }
+  if (method == "dispose") {
+    DisposeMcp(std::move(result));
+    return;
+  }
 
+  const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
   if (!arguments) {
     result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
     return;
@@ -76,6 +398,10 @@ void McpChannelPlugin::HandleMethodCall(
     InitializeMcp(*arguments, std::move(result));
   } else if (method == "processMessage") {
     ProcessMessage(*arguments, std::move(result));
+  } else if (method == "processBatch") {
+    ProcessBatch(*arguments, std::move(result));
+  } else if (method == "cancel") {
+    CancelRequest(*arguments, std::move(result));
   } else if (method == "streamMessage") {
     StreamMessage(*arguments, std::move(result));
   } else if (method == "testConnection") {
@@ -84,8 +410,12 @@ void McpChannelPlugin::HandleMethodCall(
     GetCapabilities(*arguments, std::move(result));
   } else if (method == "injectContext") {
     InjectContext(*arguments, std::move(result));
-  } else if (method == "dispose") {
-    DisposeMcp(std::move(result));
+  } else if (method == "invalidateCache") {
+    InvalidateCache(*arguments, std::move(result));
+  } else if (method == "getLogs") {
+    GetLogs(*arguments, std::move(result));
+  } else if (method == "setTracing") {
+    SetTracing(*arguments, std::move(result));
   } else {
     result->NotImplemented();
   }
@@ -112,257 +442,652 @@ McpChannelPlugin::McpEventStreamHandler::OnCancelInternal(
   return nullptr;
 }
 
-// Node.js Process Implementation
-McpChannelPlugin::NodeJsProcess::NodeJsProcess() 
-    : is_running_(false), child_stdin_write_(INVALID_HANDLE_VALUE),
-      child_stdout_read_(INVALID_HANDLE_VALUE), child_stderr_read_(INVALID_HANDLE_VALUE) {
-  ZeroMemory(&process_info_, sizeof(process_info_));
-}
+// MCP Operations Implementation
+void McpChannelPlugin::Prewarm() {
+  if (!dispatcher_->IsValid()) {
+    return;
+  }
+  char value[8];
+  DWORD length = GetEnvironmentVariableA("ASMBLI_MCP_PREWARM", value, sizeof(value));
+  if (length > 0 && length < sizeof(value) && std::string_view(value, length) == "0") {
+    return;
+  }
 
-McpChannelPlugin::NodeJsProcess::~NodeJsProcess() {
-  Stop();
+  // Most configs use the default pool size of one; a different poolSize
+  // restarts the pool at initialize.
+  if (!StartProcessPool(1)) {
+    std::cerr << "Failed to prewarm Node.js MCP process" << std::endl;
+  }
 }
 
-bool McpChannelPlugin::NodeJsProcess::Start(const std::string& script_path) {
-  if (is_running_) {
-    return true;
+bool McpChannelPlugin::StartProcessPool(size_t size) {
+  if (process_pool_->IsRunning()) {
+    if (process_pool_->size() == size) {
+      return true;
+    }
+    StopProcessPool();
   }
-
-  // Create pipes for communication
-  SECURITY_ATTRIBUTES security_attributes;
-  security_attributes.nLength = sizeof(SECURITY_ATTRIBUTES);
-  security_attributes.bInheritHandle = TRUE;
-  security_attributes.lpSecurityDescriptor = NULL;
-
-  HANDLE child_stdout_write, child_stdin_read, child_stderr_write;
-
-  // Create pipes
-  if (!CreatePipe(&child_stdout_read_, &child_stdout_write, &security_attributes, 0) ||
-      !CreatePipe(&child_stdin_read, &child_stdin_write_, &security_attributes, 0) ||
-      !CreatePipe(&child_stderr_read_, &child_stderr_write, &security_attributes, 0)) {
+  process_pool_->SetSupervisorCallbacks(
+      [this](size_t process_index) {
+        dispatcher_->Post([this, process_index]() { HandleBridgeExit(process_index); });
+      },
+      [this](size_t process_index, uint32_t attempt) {
+        dispatcher_->Post(
+            [this, process_index, attempt]() { HandleBridgeRestart(process_index, attempt); });
+      });
+  if (!process_pool_->Start(mcp_script_path_, size,
+                            [this](size_t process_index, const McpFrame& frame) {
+                              HandleNodeMessage(process_index, frame);
+                            })) {
     return false;
   }
+  // The pool's processes are new, so they start in normal mode.
+  ApplyWindowVisibility();
+  return true;
+}
 
-  // Ensure handles are not inherited
-  SetHandleInformation(child_stdout_read_, HANDLE_FLAG_INHERIT, 0);
-  SetHandleInformation(child_stdin_write_, HANDLE_FLAG_INHERIT, 0);
-  SetHandleInformation(child_stderr_read_, HANDLE_FLAG_INHERIT, 0);
-
-  // Create the Node.js process
-  STARTUPINFOA startup_info;
-  ZeroMemory(&startup_info, sizeof(startup_info));
-  startup_info.cb = sizeof(startup_info);
-  startup_info.hStdOutput = child_stdout_write;
-  startup_info.hStdError = child_stderr_write;
-  startup_info.hStdInput = child_stdin_read;
-  startup_info.dwFlags |= STARTF_USESTDHANDLES;
-
-  std::string command = "node \"" + script_path + "\"";
+void McpChannelPlugin::StopProcessPool() {
+  event_queue_.Close();
+  process_pool_->Stop();
+  event_queue_.Reopen();
+}
 
-  if (!CreateProcessA(NULL, const_cast<char*>(command.c_str()), NULL, NULL, 
-                     TRUE, CREATE_NO_WINDOW, NULL, NULL, &startup_info, &process_info_)) {
-    CloseHandle(child_stdout_write);
-    CloseHandle(child_stdin_read);
-    CloseHandle(child_stderr_write);
-    return false;
+void McpChannelPlugin::InitializeMcp(
+    const flutter::EncodableMap& config,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  
+  if (is_initialized_) {
+    result->Success(flutter::EncodableValue(flutter::EncodableMap{
+      {"success", flutter::EncodableValue(true)},
+      {"message", flutter::EncodableValue("Already initialized")}
+    }));
+    return;
   }
 
-  // Close handles not needed by parent
-  CloseHandle(child_stdout_write);
-  CloseHandle(child_stdin_read);
-  CloseHandle(child_stderr_write);
-
-  is_running_ = true;
-
-  // Start reading threads
-  output_thread_ = std::thread(&NodeJsProcess::ReadOutputThread, this);
-  error_thread_ = std::thread(&NodeJsProcess::ReadErrorThread, this);
+  // Every completion reaches the platform thread through the dispatcher.
+  if (!dispatcher_->IsValid()) {
+    result->Error("INITIALIZATION_FAILED", "Failed to create the MCP dispatcher window");
+    return;
+  }
 
-  return true;
-}
+  // config.poolSize bridge processes share the load; one by default, and
+  // never more than there are cores to run them.
+  int64_t max_pool_size = std::max(1u, std::thread::hardware_concurrency());
+  size_t pool_size =
+      static_cast<size_t>(std::clamp<int64_t>(GetIntOption(config, "poolSize", 1), 1, max_pool_size));
 
-void McpChannelPlugin::NodeJsProcess::Stop() {
-  if (!is_running_) {
+  // Start Node.js processes, or adopt the prewarmed one
+  if (!StartProcessPool(pool_size)) {
+    result->Error("INITIALIZATION_FAILED", "Failed to start Node.js MCP process");
     return;
   }
 
-  is_running_ = false;
+  // transport.flushLatencyUs lets closely spaced requests share one pipe
+  // write; transport.maxBatchBytes caps how much waits for the flush.
+  if (const auto* transport = GetMapOption(config, "transport")) {
+    int64_t flush_latency_us = std::clamp<int64_t>(
+        GetIntOption(*transport, "flushLatencyUs", 0), 0, kMaxFlushLatencyUs);
+    int64_t max_batch_bytes = std::max<int64_t>(
+        GetIntOption(*transport, "maxBatchBytes", kDefaultMaxBatchBytes), 1);
+    process_pool_->SetWriteCoalescing(std::chrono::microseconds(flush_latency_us),
+                                      static_cast<size_t>(max_batch_bytes));
+  }
 
-  // Terminate the process
-  if (process_info_.hProcess != INVALID_HANDLE_VALUE) {
-    TerminateProcess(process_info_.hProcess, 0);
-    CloseHandle(process_info_.hProcess);
-    CloseHandle(process_info_.hThread);
+  // config.resultCache sizes the response cache: maxBytes, the default
+  // ttlMs, and per-tool TTLs in tools, e.g. {"read_file": 5000}. A TTL of 0
+  // keeps that tool out of the cache.
+  if (const auto* result_cache = GetMapOption(config, "resultCache")) {
+    std::unordered_map<std::string, int64_t> tool_ttls_ms;
+    if (const auto* tools = GetMapOption(*result_cache, "tools")) {
+      for (const auto& entry : *tools) {
+        const auto* tool = std::get_if<std::string>(&entry.first);
+        if (tool) {
+          tool_ttls_ms[*tool] = GetIntOption(*tools, tool->c_str(), 0);
+        }
+      }
+    }
+    int64_t max_bytes = std::max<int64_t>(
+        GetIntOption(*result_cache, "maxBytes", McpResultCache::kDefaultMaxBytes), 0);
+    results_.Configure(static_cast<size_t>(max_bytes),
+                       GetIntOption(*result_cache, "ttlMs", McpResultCache::kDefaultTtlMs),
+                       std::move(tool_ttls_ms));
   }
 
-  // Close pipes
-  if (child_stdin_write_ != INVALID_HANDLE_VALUE) {
-    CloseHandle(child_stdin_write_);
-    child_stdin_write_ = INVALID_HANDLE_VALUE;
+  // config.priorities sets the overall maxInFlight and, per lane
+  // ("interactive", "normal", "bulk"), its round robin weight and maxInFlight.
+  if (const auto* priorities = GetMapOption(config, "priorities")) {
+    lanes_.SetMaxInFlight(static_cast<size_t>(std::max<int64_t>(
+        GetIntOption(*priorities, "maxInFlight", McpLaneScheduler::kDefaultMaxInFlight), 1)));
+    for (McpPriority priority :
+         {McpPriority::kInteractive, McpPriority::kNormal, McpPriority::kBulk}) {
+      const auto* lane = GetMapOption(*priorities, McpPriorityName(priority));
+      if (!lane) {
+        continue;
+      }
+      int64_t weight = std::clamp<int64_t>(GetIntOption(*lane, "weight", 1), 1, 1000);
+      int64_t max_in_flight = std::max<int64_t>(
+          GetIntOption(*lane, "maxInFlight", McpLaneScheduler::kDefaultMaxInFlight), 1);
+      lanes_.ConfigureLane(priority, static_cast<uint32_t>(weight),
+                           static_cast<size_t>(max_in_flight));
+    }
   }
-  if (child_stdout_read_ != INVALID_HANDLE_VALUE) {
-    CloseHandle(child_stdout_read_);
-    child_stdout_read_ = INVALID_HANDLE_VALUE;
+
+  // config.concurrency bounds each server's adaptive limit: initialLimit,
+  // minLimit, maxLimit, and latencyTolerance, how many times its fastest
+  // round trip a response may take before the limit backs off. Requests over
+  // the limit wait, up to maxQueue per server, unless overflow is "fail".
+  if (const auto* concurrency = GetMapOption(config, "concurrency")) {
+    McpConcurrencyLimiter::Options options;
+    options.initial_limit = GetDoubleOption(*concurrency, "initialLimit", options.initial_limit);
+    options.min_limit = GetDoubleOption(*concurrency, "minLimit", options.min_limit);
+    options.max_limit = GetDoubleOption(*concurrency, "maxLimit", options.max_limit);
+    options.latency_tolerance = std::max(
+        GetDoubleOption(*concurrency, "latencyTolerance", options.latency_tolerance), 1.0);
+    const std::string* overflow = GetStringOption(*concurrency, "overflow");
+    options.queue_limit =
+        overflow && *overflow == "fail"
+            ? 0
+            : static_cast<size_t>(std::max<int64_t>(
+                  GetIntOption(*concurrency, "maxQueue",
+                               static_cast<int64_t>(options.queue_limit)), 0));
+    server_limits_.Configure(options);
   }
-  if (child_stderr_read_ != INVALID_HANDLE_VALUE) {
-    CloseHandle(child_stderr_read_);
-    child_stderr_read_ = INVALID_HANDLE_VALUE;
+
+  // config.logs bounds the bridge stderr log: maxEntries and maxBytes kept
+  // for getLogs, linesPerSecond per bridge (0 for no limit), and the file it
+  // is written to, rotated at maxFileBytes with maxFiles old ones kept. An
+  // empty file keeps the log in memory only.
+  if (const auto* logs = GetMapOption(config, "logs")) {
+    McpLogBuffer::Options options;
+    options.max_entries = static_cast<size_t>(std::max<int64_t>(
+        GetIntOption(*logs, "maxEntries", static_cast<int64_t>(options.max_entries)), 1));
+    options.max_bytes = static_cast<size_t>(std::max<int64_t>(
+        GetIntOption(*logs, "maxBytes", static_cast<int64_t>(options.max_bytes)), 0));
+    options.lines_per_second = static_cast<uint32_t>(std::clamp<int64_t>(
+        GetIntOption(*logs, "linesPerSecond", options.lines_per_second), 0, 1000000));
+    const std::string* file = GetStringOption(*logs, "file");
+    options.file_path = file ? Utf16FromUtf8(*file) : McpLogBuffer::DefaultFilePath();
+    options.max_file_bytes = static_cast<uint64_t>(std::max<int64_t>(
+        GetIntOption(*logs, "maxFileBytes", static_cast<int64_t>(options.max_file_bytes)), 0));
+    options.max_files = static_cast<uint32_t>(
+        std::clamp<int64_t>(GetIntOption(*logs, "maxFiles", options.max_files), 0, 100));
+    McpLogBuffer::Get().Configure(options);
   }
 
-  // Wait for threads to finish
-  if (output_thread_.joinable()) {
-    output_thread_.join();
+  // Requests without their own timeoutMs get config.defaultTimeoutMs; none
+  // by default.
+  default_timeout_ms_ = GetIntOption(config, "defaultTimeoutMs", 0);
+
+  // config.events tunes event delivery: policy ("merge", "drop" or "block")
+  // picks what happens to a bridge event when capacity events are already
+  // waiting, and frameIntervalMs how often the platform thread collects them.
+  // The plugin's own completion and restart events are always queued, and
+  // response chunks wait for room rather than be dropped.
+  if (const auto* events = GetMapOption(config, "events")) {
+    const std::string* policy_name = GetStringOption(*events, "policy");
+    McpEventOverflowPolicy policy = McpEventOverflowPolicy::kMerge;
+    if (policy_name && *policy_name == "drop") {
+      policy = McpEventOverflowPolicy::kDrop;
+    } else if (policy_name && *policy_name == "block") {
+      policy = McpEventOverflowPolicy::kBlock;
+    }
+    int64_t capacity = std::max<int64_t>(
+        GetIntOption(*events, "capacity", McpEventQueue::kDefaultCapacity), 1);
+    event_queue_.Configure(static_cast<size_t>(capacity), policy);
+    frame_interval_ = std::chrono::milliseconds(std::clamp<int64_t>(
+        GetIntOption(*events, "frameIntervalMs", kDefaultFrameIntervalMs), 1,
+        kMaxFrameIntervalMs));
   }
-  if (error_thread_.joinable()) {
-    error_thread_.join();
+
+  // config.background governs the app while its window is minimized, hidden
+  // or covered: events are delivered every frameIntervalMs, merged in the
+  // meantime, and unless throttleProcesses is false the bridges drop to
+  // below-normal priority with EcoQoS.
+  if (const auto* background = GetMapOption(config, "background")) {
+    background_frame_interval_ = std::chrono::milliseconds(std::clamp<int64_t>(
+        GetIntOption(*background, "frameIntervalMs", kDefaultBackgroundFrameIntervalMs),
+        1, kMaxBackgroundFrameIntervalMs));
+    auto throttle = background->find(flutter::EncodableValue("throttleProcesses"));
+    throttle_background_processes_ =
+        throttle == background->end() || !(throttle->second == flutter::EncodableValue(false));
   }
-}
+  ApplyWindowVisibility();
 
-bool McpChannelPlugin::NodeJsProcess::IsRunning() const {
-  return is_running_;
-}
+  // Send initialization config to every Node.js process. A config with
+  // transport.framing == "length-prefixed" opts in to binary frames; each
+  // bridge acknowledges with a "transport" message (see mcp_framing.h).
+  // Framed bridges then pass large payloads through shared memory unless
+  // transport.sharedMemory is false; only they get a region.
+  std::string request_id = "init_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+  uint64_t init_wire_id = pending_requests_.AllocateId();
+  bool init_sent = false;
+  for (size_t process_index = 0; process_index < process_pool_->size(); ++process_index) {
+    if (process_pool_->IsConnected(process_index)) {
+      const std::string& init_message =
+          BuildInitializeMessage(process_index, config, request_id, init_wire_id);
+      init_sent = process_pool_->SendMessage(process_index, init_message) || init_sent;
+    }
+  }
 
-bool McpChannelPlugin::NodeJsProcess::SendMessage(const std::string& message) {
-  if (!is_running_ || child_stdin_write_ == INVALID_HANDLE_VALUE) {
-    return false;
+  if (!init_sent) {
+    result->Error("INITIALIZATION_FAILED", "Failed to send initialization config");
+    return;
   }
 
-  std::string full_message = message + "\n";
-  DWORD bytes_written;
+  is_initialized_ = true;
+  init_config_ = config;
+  // Blocks injected before a re-initialize outlive it.
+  for (size_t process_index = 0; process_index < process_pool_->size(); ++process_index) {
+    SendContextBlocks(process_index);
+  }
   
-  return WriteFile(child_stdin_write_, full_message.c_str(), 
-                  static_cast<DWORD>(full_message.length()), &bytes_written, NULL);
+  result->Success(flutter::EncodableValue(flutter::EncodableMap{
+    {"success", flutter::EncodableValue(true)},
+    {"message", flutter::EncodableValue("MCP initialized successfully")}
+  }));
 }
 
-void McpChannelPlugin::NodeJsProcess::SetMessageCallback(
-    std::function<void(const std::string&)> callback) {
-  std::lock_guard<std::mutex> lock(callback_mutex_);
-  message_callback_ = callback;
-}
+void McpChannelPlugin::ProcessMessage(
+    const flutter::EncodableMap& request,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  
+  if (!is_initialized_) {
+    result->Error("NOT_INITIALIZED", "MCP not initialized");
+    return;
+  }
+
+  auto request_id_it = request.find(flutter::EncodableValue("requestId"));
+  if (request_id_it == request.end()) {
+    result->Error("MISSING_REQUEST_ID", "Request ID is required");
+    return;
+  }
 
-void McpChannelPlugin::NodeJsProcess::ReadOutputThread() {
-  char buffer[4096];
-  DWORD bytes_read;
-  std::string accumulated_data;
+  std::string request_id = std::get<std::string>(request_id_it->second);
 
-  while (is_running_ && child_stdout_read_ != INVALID_HANDLE_VALUE) {
-    if (ReadFile(child_stdout_read_, buffer, sizeof(buffer) - 1, &bytes_read, NULL) && bytes_read > 0) {
-      buffer[bytes_read] = '\0';
-      accumulated_data += buffer;
+  McpPriority priority;
+  if (!GetPriorityOption(request, &priority)) {
+    result->Error("INVALID_ARGUMENTS", "priority must be interactive, normal or bulk");
+    return;
+  }
 
-      // Process complete JSON messages (one per line)
-      size_t pos = 0;
-      while ((pos = accumulated_data.find('\n')) != std::string::npos) {
-        std::string message = accumulated_data.substr(0, pos);
-        accumulated_data.erase(0, pos + 1);
+  // Context refs are pinned to the versions they name now, which also keeps
+  // cached results of an older version of a block from matching.
+  flutter::EncodableMap pinned_request;
+  const flutter::EncodableMap* call = nullptr;
+  std::string code;
+  std::string error_message;
+  if (!PinContextRefs(request, contexts_, &pinned_request, &call, &code, &error_message)) {
+    result->Error(code, error_message);
+    return;
+  }
 
-        if (!message.empty()) {
-          std::lock_guard<std::mutex> lock(callback_mutex_);
-          if (message_callback_) {
-            message_callback_(message);
-          }
+  // A cache hit completes here; a miss remembers where its response goes.
+  std::string server_id(GetAffinityKey(request));
+  bool chunked = GetBoolOption(request, "chunked");
+  std::string cache_tool;
+  int64_t cache_ttl_ms = 0;
+  std::string cache_key;
+  if (!chunked && GetCacheOption(request, &cache_tool, &cache_ttl_ms)) {
+    if (cache_ttl_ms <= 0) {
+      cache_ttl_ms = results_.TtlFor(cache_tool);
+    }
+    if (cache_ttl_ms > 0) {
+      cache_key = McpResultCache::MakeKey(server_id, cache_tool, CacheKeyParams(*call));
+      flutter::EncodableValue cached;
+      if (results_.Lookup(cache_key, &cached)) {
+        if (auto* fields = std::get_if<flutter::EncodableMap>(&cached)) {
+          (*fields)[flutter::EncodableValue("requestId")] = flutter::EncodableValue(request_id);
+          (*fields)[flutter::EncodableValue("cached")] = flutter::EncodableValue(true);
         }
+        result->Success(cached);
+        return;
       }
-    } else {
-      break;
     }
   }
-}
 
-void McpChannelPlugin::NodeJsProcess::ReadErrorThread() {
-  char buffer[4096];
-  DWORD bytes_read;
+  // Past the cache, the call needs a slot of its server.
+  McpConcurrencyLimiter::Admission admission = server_limits_.Admit(server_id);
+  if (admission == McpConcurrencyLimiter::Admission::kRejected) {
+    McpMetrics::Add(McpMetrics::Get().requests_overloaded);
+    result->Error("OVERLOADED", "MCP server is at its concurrency limit",
+                  flutter::EncodableValue(flutter::EncodableMap{
+                    {flutter::EncodableValue("retriable"), flutter::EncodableValue(true)},
+                    {flutter::EncodableValue("serverId"), flutter::EncodableValue(server_id)},
+                    {flutter::EncodableValue("limit"),
+                     flutter::EncodableValue(server_limits_.limit(server_id))}
+                  }));
+    return;
+  }
 
-  while (is_running_ && child_stderr_read_ != INVALID_HANDLE_VALUE) {
-    if (ReadFile(child_stderr_read_, buffer, sizeof(buffer) - 1, &bytes_read, NULL) && bytes_read > 0) {
-      buffer[bytes_read] = '\0';
-      std::cerr << "MCP Node.js Error: " << buffer << std::endl;
-    } else {
-      break;
-    }
+  // Store the result for async response. A chunked request answers the
+  // call right away and delivers the response through events, so the
+  // plugin never holds more than one chunk of it. A replay would repeat
+  // chunks Dart already has, so chunked requests are never replayed.
+  McpPendingRequest pending;
+  pending.request_id = request_id;
+  pending.chunked = chunked;
+  pending.server_id = server_id;
+  pending.holds_server_slot = admission == McpConcurrencyLimiter::Admission::kAdmitted;
+  if (!cache_key.empty()) {
+    pending.cache_key = std::move(cache_key);
+    pending.cache_tool = std::move(cache_tool);
+    pending.cache_ttl_ms = cache_ttl_ms;
+    pending.cache_generation = results_.generation();
+  }
+  if (pending.chunked) {
+    result->Success(flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("requestId"), flutter::EncodableValue(request_id)},
+      {flutter::EncodableValue("chunked"), flutter::EncodableValue(true)}
+    }));
+  } else {
+    pending.result = std::move(result);
+    // Only a response cached on the way needs to be decoded.
+    pending.transcode = pending.cache_key.empty();
+  }
+  uint64_t wire_id = pending_requests_.AllocateId();
+  pending.wire_id = wire_id;
+  const std::string& message = BuildRequestMessage("processMessage", *call, request_id, wire_id);
+  if (IsIdempotent(request) && !pending.chunked) {
+    pending.replay_message = message;
+  }
+  McpMetrics::Add(McpMetrics::Get().requests_started);
+  // The deadline covers time spent waiting for a server slot and a lane.
+  ScheduleDeadline(wire_id, GetIntOption(request, "timeoutMs", default_timeout_ms_));
+  if (admission == McpConcurrencyLimiter::Admission::kQueue) {
+    McpQueuedRequest queued;
+    queued.wire_id = wire_id;
+    queued.priority = priority;
+    queued.affinity_key = server_id;
+    queued.message = message;
+    queued.pending = std::move(pending);
+    server_limits_.Enqueue(server_id, std::move(queued));
+    return;
   }
+  SubmitRequest(priority, server_id, wire_id, message, false, std::move(pending));
 }
 
-// MCP Operations Implementation
-void McpChannelPlugin::InitializeMcp(
-    const flutter::EncodableMap& config,
-    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-  
-  if (is_initialized_) {
-    result->Success(flutter::EncodableValue(flutter::EncodableMap{
+void McpChannelPlugin::SubmitRequest(McpPriority priority, std::string_view affinity_key,
+                                     uint64_t wire_id, std::string_view message, bool stream,
+                                     McpPendingRequest pending) {
+  if (lanes_.Admit(priority)) {
+    DispatchRequest(priority, affinity_key, wire_id, message, stream, std::move(pending));
+    return;
+  }
+  McpQueuedRequest queued;
+  queued.wire_id = wire_id;
+  queued.priority = priority;
+  queued.affinity_key = std::string(affinity_key);
+  queued.message = std::string(message);
+  queued.stream = stream;
+  queued.pending = std::move(pending);
+  lanes_.Enqueue(std::move(queued));
+}
+
+void McpChannelPlugin::DispatchRequest(McpPriority priority, std::string_view affinity_key,
+                                       uint64_t wire_id, std::string_view message, bool stream,
+                                       McpPendingRequest pending) {
+  pending.lane = static_cast<int>(priority);
+  size_t process_index = process_pool_->Acquire(affinity_key);
+  if (stream) {
+    // Streams answer through events only, so the process and the lane are
+    // released as soon as the request is handed over.
+    bool sent = process_index != NodeJsProcessPool::kNoProcess &&
+                process_pool_->SendMessage(process_index, message);
+    if (process_index != NodeJsProcessPool::kNoProcess) {
+      process_pool_->Release(process_index);
+    }
+    ReleaseLane(&pending);
+    if (!sent) {
+      pending.result->Error("SEND_FAILED", "Failed to send stream request to MCP process");
+      return;
+    }
+    pending.result->Success(flutter::EncodableValue(flutter::EncodableMap{
       {"success", flutter::EncodableValue(true)},
-      {"message", flutter::EncodableValue("Already initialized")}
+      {"message", flutter::EncodableValue("Stream started")}
     }));
     return;
   }
 
-  // Set up Node.js message callback
-  node_process_->SetMessageCallback(
-      [this](const std::string& message) {
-        HandleNodeMessage(message);
-      });
+  if (process_index == NodeJsProcessPool::kNoProcess) {
+    RejectPendingRequest(&pending, "SEND_FAILED", "No MCP process is available");
+    return;
+  }
+  pending.process_index = process_index;
+  pending.sent_at = std::chrono::steady_clock::now();
+  pending_requests_.Insert(wire_id, std::move(pending));
 
-  // Start Node.js process
-  if (!node_process_->Start(mcp_script_path_)) {
-    result->Error("INITIALIZATION_FAILED", "Failed to start Node.js MCP process");
+  // Send message to Node.js
+  if (!process_pool_->SendMessage(process_index, message)) {
+    if (pending_requests_.Take(wire_id, &pending)) {
+      process_pool_->Release(process_index);
+      RejectPendingRequest(&pending, "SEND_FAILED", "Failed to send message to MCP process");
+    }
+  }
+}
+
+void McpChannelPlugin::ReleaseLane(McpPendingRequest* pending) {
+  if (pending->lane < 0) {
     return;
   }
+  lanes_.Finish(static_cast<McpPriority>(pending->lane));
+  pending->lane = -1;
+  DispatchQueuedRequests();
+}
 
-  // Send initialization config to Node.js
-  std::string request_id = "init_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
-  std::string config_json = EncodableValueToJsonString(flutter::EncodableValue(config));
-  std::string init_message = "{\"method\":\"initialize\",\"params\":" + config_json + ",\"requestId\":\"" + request_id + "\"}";
+void McpChannelPlugin::DispatchQueuedRequests() {
+  // A dispatch that fails releases its slot again; the loop below picks up
+  // whatever that admits.
+  if (dispatching_queued_) {
+    return;
+  }
+  dispatching_queued_ = true;
+  McpQueuedRequest next;
+  while (lanes_.Next(&next)) {
+    DispatchRequest(next.priority, next.affinity_key, next.wire_id, next.message, next.stream,
+                    std::move(next.pending));
+  }
+  dispatching_queued_ = false;
+}
 
-  if (!node_process_->SendMessage(init_message)) {
-    result->Error("INITIALIZATION_FAILED", "Failed to send initialization config");
+void McpChannelPlugin::ReleaseServerSlot(McpPendingRequest* pending,
+                                         McpConcurrencyLimiter::Outcome outcome) {
+  if (!pending->holds_server_slot) {
     return;
   }
+  pending->holds_server_slot = false;
+  // Only a request that reached a bridge has a round trip to report.
+  auto latency = std::chrono::microseconds(0);
+  if (pending->sent_at == std::chrono::steady_clock::time_point()) {
+    outcome = McpConcurrencyLimiter::Outcome::kDropped;
+  } else {
+    latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - pending->sent_at);
+  }
+  server_limits_.Finish(pending->server_id, latency, outcome);
 
-  is_initialized_ = true;
-  
-  result->Success(flutter::EncodableValue(flutter::EncodableMap{
-    {"success", flutter::EncodableValue(true)},
-    {"message", flutter::EncodableValue("MCP initialized successfully")}
-  }));
+  // A submit that fails releases its slot again, possibly of another
+  // server; the outer loop drains every server released meanwhile.
+  servers_to_drain_.push_back(pending->server_id);
+  if (draining_servers_) {
+    return;
+  }
+  draining_servers_ = true;
+  while (!servers_to_drain_.empty()) {
+    std::string server_id = std::move(servers_to_drain_.back());
+    servers_to_drain_.pop_back();
+    McpQueuedRequest next;
+    while (server_limits_.Next(server_id, &next)) {
+      next.pending.holds_server_slot = true;
+      SubmitRequest(next.priority, next.affinity_key, next.wire_id, next.message, false,
+                    std::move(next.pending));
+    }
+  }
+  draining_servers_ = false;
 }
 
-void McpChannelPlugin::ProcessMessage(
+void McpChannelPlugin::ProcessBatch(
     const flutter::EncodableMap& request,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-  
+
   if (!is_initialized_) {
     result->Error("NOT_INITIALIZED", "MCP not initialized");
     return;
   }
 
-  auto request_id_it = request.find(flutter::EncodableValue("requestId"));
-  if (request_id_it == request.end()) {
-    result->Error("MISSING_REQUEST_ID", "Request ID is required");
+  auto requests_it = request.find(flutter::EncodableValue("requests"));
+  const auto* requests = requests_it != request.end()
+                             ? std::get_if<flutter::EncodableList>(&requests_it->second)
+                             : nullptr;
+  if (!requests) {
+    result->Error("INVALID_ARGUMENTS", "requests must be a list");
     return;
   }
 
-  std::string request_id = std::get<std::string>(request_id_it->second);
+  auto batch = std::make_shared<McpPendingBatch>();
+  const std::string* batch_id = GetStringOption(request, "batchId");
+  batch->batch_id = batch_id ? *batch_id
+                             : "batch_" + std::to_string(std::chrono::steady_clock::now()
+                                                             .time_since_epoch().count());
+  const std::string* mode = GetStringOption(request, "mode");
+  batch->stream = mode && *mode == "stream";
+  batch->results.resize(requests->size());
+  batch->remaining = requests->size();
+
+  if (requests->empty()) {
+    result->Success(flutter::EncodableValue(flutter::EncodableList{}));
+    return;
+  }
 
-  // Store the result for async response
-  {
-    std::lock_guard<std::mutex> lock(pending_requests_mutex_);
-    pending_requests_[request_id] = std::move(result);
+  // The whole batch goes to one process, so it costs one pipe write and one
+  // parse on the bridge side. The first request's server picks the process.
+  const auto* first = std::get_if<flutter::EncodableMap>(&requests->front());
+  size_t process_index =
+      process_pool_->Acquire(first ? GetAffinityKey(*first) : std::string_view(), requests->size());
+  if (process_index == NodeJsProcessPool::kNoProcess) {
+    result->Error("SEND_FAILED", "No MCP process is available");
+    return;
+  }
+  if (batch->stream) {
+    result->Success(flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("batchId"), flutter::EncodableValue(batch->batch_id)},
+      {flutter::EncodableValue("count"),
+       flutter::EncodableValue(static_cast<int64_t>(requests->size()))}
+    }));
+  } else {
+    batch->result = std::move(result);
   }
 
-  // Send message to Node.js
-  std::string params_json = EncodableValueToJsonString(flutter::EncodableValue(request));
-  std::string message = "{\"method\":\"processMessage\",\"params\":" + params_json + ",\"requestId\":\"" + request_id + "\"}";
+  // Entries without their own timeoutMs inherit the batch's.
+  int64_t batch_timeout_ms = GetIntOption(request, "timeoutMs", default_timeout_ms_);
+
+  // Register every entry before sending so no response can arrive early.
+  struct RejectedEntry {
+    McpPendingRequest pending;
+    std::string code;
+    std::string message;
+  };
+  std::vector<uint64_t> wire_ids;
+  std::vector<RejectedEntry> rejected;
+  wire_ids.reserve(requests->size());
+  outbound_message_.clear();
+  outbound_message_.push_back('[');
+  for (size_t index = 0; index < requests->size(); ++index) {
+    McpPendingRequest pending;
+    pending.process_index = process_index;
+    pending.batch = batch;
+    pending.batch_index = index;
+
+    const auto* entry = std::get_if<flutter::EncodableMap>(&(*requests)[index]);
+    const std::string* request_id = entry ? GetStringOption(*entry, "requestId") : nullptr;
+    if (!request_id) {
+      rejected.push_back(RejectedEntry{std::move(pending), "MISSING_REQUEST_ID",
+                                       "Batch entries must be maps with a request ID"});
+      continue;
+    }
+    pending.request_id = *request_id;
+    // Chunks would arrive as events beside the batch's own results, so a
+    // chunked response has no slot to land in.
+    if (GetBoolOption(*entry, "chunked")) {
+      rejected.push_back(RejectedEntry{std::move(pending), "INVALID_ARGUMENTS",
+                                       "Batch entries cannot be chunked"});
+      continue;
+    }
+    // Context refs are pinned as ProcessMessage pins them.
+    flutter::EncodableMap pinned_entry;
+    const flutter::EncodableMap* call = nullptr;
+    std::string code;
+    std::string error_message;
+    if (!PinContextRefs(*entry, contexts_, &pinned_entry, &call, &code, &error_message)) {
+      rejected.push_back(RejectedEntry{std::move(pending), code, error_message});
+      continue;
+    }
+    uint64_t wire_id = pending_requests_.AllocateId();
+    pending.wire_id = wire_id;
+    if (outbound_message_.size() > 1) {
+      outbound_message_.push_back(',');
+    }
+    size_t entry_start = outbound_message_.size();
+    AppendRequestMessage("processMessage", *call, *request_id, wire_id, &outbound_message_);
+    // A replayed entry goes on its own; its response still finds the batch.
+    if (IsIdempotent(*entry)) {
+      pending.replay_message = outbound_message_.substr(entry_start);
+    }
+    pending_requests_.Insert(wire_id, std::move(pending));
+    McpMetrics::Add(McpMetrics::Get().requests_started);
+    ScheduleDeadline(wire_id, GetIntOption(*entry, "timeoutMs", batch_timeout_ms));
+    wire_ids.push_back(wire_id);
+  }
+  outbound_message_.push_back(']');
+
+  for (auto& entry : rejected) {
+    process_pool_->Release(process_index);
+    RejectPendingRequest(&entry.pending, entry.code, entry.message);
+  }
 
-  if (!node_process_->SendMessage(message)) {
-    std::lock_guard<std::mutex> lock(pending_requests_mutex_);
-    auto it = pending_requests_.find(request_id);
-    if (it != pending_requests_.end()) {
-      it->second->Error("SEND_FAILED", "Failed to send message to MCP process");
-      pending_requests_.erase(it);
+  if (!wire_ids.empty() && !process_pool_->SendMessage(process_index, outbound_message_)) {
+    for (uint64_t wire_id : wire_ids) {
+      McpPendingRequest pending;
+      if (pending_requests_.Take(wire_id, &pending)) {
+        process_pool_->Release(process_index);
+        RejectPendingRequest(&pending, "SEND_FAILED", "Failed to send batch to MCP process");
+      }
     }
   }
 }
 
+void McpChannelPlugin::CancelRequest(
+    const flutter::EncodableMap& request,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  const std::string* request_id = GetStringOption(request, "requestId");
+  if (!request_id) {
+    result->Error("MISSING_REQUEST_ID", "Request ID is required");
+    return;
+  }
+
+  // Whoever takes the entry first completes it, so a response racing the
+  // cancel is delivered at most once.
+  uint64_t wire_id;
+  McpPendingRequest pending;
+  McpQueuedRequest queued;
+  bool cancelled = false;
+  if (lanes_.TakeByRequestId(*request_id, &queued) ||
+      server_limits_.TakeByRequestId(*request_id, &queued)) {
+    // Still waiting for its lane or its server; the bridge never saw it.
+    cancelled = true;
+    RejectPendingRequest(&queued.pending, "CANCELLED", "Request was cancelled");
+  } else if (pending_requests_.TakeByRequestId(*request_id, &wire_id, &pending)) {
+    cancelled = true;
+    process_pool_->Release(pending.process_index);
+    RejectPendingRequest(&pending, "CANCELLED", "Request was cancelled");
+    SendCancelNotification(pending.process_index, wire_id, *request_id);
+  }
+
+  result->Success(flutter::EncodableValue(flutter::EncodableMap{
+    {flutter::EncodableValue("cancelled"), flutter::EncodableValue(cancelled)}
+  }));
+}
+
 void McpChannelPlugin::StreamMessage(
     const flutter::EncodableMap& request,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
@@ -377,19 +1102,20 @@ void McpChannelPlugin::StreamMessage(
     std::get<std::string>(request_id_it->second) : 
     "stream_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
 
-  // Send stream request to Node.js
-  std::string params_json = EncodableValueToJsonString(flutter::EncodableValue(request));
-  std::string message = "{\"method\":\"streamMessage\",\"params\":" + params_json + ",\"requestId\":\"" + request_id + "\"}";
-
-  if (!node_process_->SendMessage(message)) {
-    result->Error("SEND_FAILED", "Failed to send stream request to MCP process");
+  McpPriority priority;
+  if (!GetPriorityOption(request, &priority)) {
+    result->Error("INVALID_ARGUMENTS", "priority must be interactive, normal or bulk");
     return;
   }
 
-  result->Success(flutter::EncodableValue(flutter::EncodableMap{
-    {"success", flutter::EncodableValue(true)},
-    {"message", flutter::EncodableValue("Stream started")}
-  }));
+  // Send stream request to Node.js once its lane has room.
+  McpPendingRequest pending;
+  pending.request_id = request_id;
+  pending.result = std::move(result);
+  uint64_t wire_id = pending_requests_.AllocateId();
+  pending.wire_id = wire_id;
+  const std::string& message = BuildRequestMessage("streamMessage", request, request_id, wire_id);
+  SubmitRequest(priority, GetAffinityKey(request), wire_id, message, true, std::move(pending));
 }
 
 void McpChannelPlugin::TestConnection(
@@ -401,11 +1127,122 @@ void McpChannelPlugin::TestConnection(
     return;
   }
 
-  // For now, return mock success - will be replaced with actual test
-  result->Success(flutter::EncodableValue(flutter::EncodableMap{
-    {"connected", flutter::EncodableValue(true)},
-    {"latency", flutter::EncodableValue(150)},
-    {"metadata", flutter::EncodableValue(flutter::EncodableMap{})}
+  // Ping every connected process through its regular pipe; the bridge
+  // answers pings ahead of any other work, so the round trip measures the
+  // transport and the bridge's event loop.
+  auto round = std::make_shared<PingRound>();
+  size_t pool_size = process_pool_->size();
+  round->round_trip_us.assign(pool_size, -1);
+  round->result = std::move(result);
+  // Held until every ping is out, so early answers cannot finish the round.
+  round->remaining = 1;
+  int64_t timeout_ms = GetIntOption(request, "timeoutMs", kDefaultPingTimeoutMs);
+
+  for (size_t process_index = 0; process_index < pool_size; ++process_index) {
+    uint64_t wire_id = pending_requests_.AllocateId();
+    {
+      std::lock_guard<std::mutex> lock(pings_mutex_);
+      std::lock_guard<std::mutex> round_lock(round->mutex);
+      ++round->remaining;
+      pings_[wire_id] = PendingPing{process_index, McpLatencyHistogram::Clock::now(), round};
+    }
+    const std::string& ping = BuildRequestMessage("ping", flutter::EncodableMap{},
+                                                  "ping_" + std::to_string(wire_id), wire_id);
+    if (process_pool_->SendMessage(process_index, ping)) {
+      ScheduleDeadline(wire_id, std::max<int64_t>(timeout_ms, 1));
+    } else {
+      CompletePing(wire_id, true);
+    }
+  }
+  ReleasePingRound(round);
+}
+
+void McpChannelPlugin::CompletePing(uint64_t wire_id, bool timed_out) {
+  PendingPing ping;
+  {
+    std::lock_guard<std::mutex> lock(pings_mutex_);
+    auto it = pings_.find(wire_id);
+    if (it == pings_.end()) {
+      return;
+    }
+    ping = std::move(it->second);
+    pings_.erase(it);
+  }
+
+  if (!timed_out) {
+    // Pongs arrive on the I/O threads; the wheel lives on the platform thread.
+    dispatcher_->Post([this, wire_id]() { CancelDeadline(wire_id); });
+    auto round_trip = std::chrono::duration_cast<std::chrono::microseconds>(
+        McpLatencyHistogram::Clock::now() - ping.sent_at);
+    process_pool_->RecordRoundTrip(ping.process_index, round_trip);
+    ping_latency_.Record(round_trip);
+    std::lock_guard<std::mutex> lock(ping.round->mutex);
+    ping.round->round_trip_us[ping.process_index] = round_trip.count();
+  }
+
+  ReleasePingRound(ping.round);
+}
+
+void McpChannelPlugin::ReleasePingRound(const std::shared_ptr<PingRound>& round) {
+  bool done;
+  {
+    std::lock_guard<std::mutex> lock(round->mutex);
+    done = --round->remaining == 0;
+  }
+  if (done) {
+    dispatcher_->Post([this, round]() { FinishPingRound(round.get()); });
+  }
+}
+
+void McpChannelPlugin::FinishPingRound(PingRound* round) {
+  std::vector<NodeJsProcessPool::ProcessStats> pool_stats = process_pool_->GetStats();
+  flutter::EncodableList processes;
+  std::vector<int64_t> answered;
+  for (size_t index = 0; index < pool_stats.size(); ++index) {
+    const auto& stats = pool_stats[index];
+    int64_t round_trip_us =
+        index < round->round_trip_us.size() ? round->round_trip_us[index] : -1;
+    if (round_trip_us >= 0) {
+      answered.push_back(round_trip_us);
+    }
+    processes.push_back(flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("healthy"), flutter::EncodableValue(stats.healthy)},
+      {flutter::EncodableValue("roundTripUs"), flutter::EncodableValue(round_trip_us)},
+      {flutter::EncodableValue("latency"),
+       flutter::EncodableValue(LatencySummaryToMap(stats.round_trip))},
+      {flutter::EncodableValue("inFlight"),
+       flutter::EncodableValue(static_cast<int64_t>(stats.in_flight))},
+      {flutter::EncodableValue("dispatched"),
+       flutter::EncodableValue(static_cast<int64_t>(stats.dispatched))},
+      {flutter::EncodableValue("sendFailures"),
+       flutter::EncodableValue(static_cast<int64_t>(stats.send_failures))},
+      {flutter::EncodableValue("queuedMessages"),
+       flutter::EncodableValue(static_cast<int64_t>(stats.queued_messages))},
+      {flutter::EncodableValue("queuedBytes"),
+       flutter::EncodableValue(static_cast<int64_t>(stats.queued_bytes))}
+    }));
+  }
+
+  // latency stays in whole milliseconds: the median of this round.
+  int64_t latency_ms = -1;
+  if (!answered.empty()) {
+    std::nth_element(answered.begin(), answered.begin() + answered.size() / 2, answered.end());
+    latency_ms = (answered[answered.size() / 2] + 500) / 1000;
+  }
+  McpLatencySummary summary = ping_latency_.Summarize();
+
+  round->result->Success(flutter::EncodableValue(flutter::EncodableMap{
+    {"connected", flutter::EncodableValue(!answered.empty())},
+    {"latency", flutter::EncodableValue(latency_ms)},
+    {"p50Ms", flutter::EncodableValue(summary.p50 / 1000.0)},
+    {"p95Ms", flutter::EncodableValue(summary.p95 / 1000.0)},
+    {"p99Ms", flutter::EncodableValue(summary.p99 / 1000.0)},
+    {"maxMs", flutter::EncodableValue(summary.max / 1000.0)},
+    {"metadata", flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("samples"),
+       flutter::EncodableValue(static_cast<int64_t>(summary.count))},
+      {flutter::EncodableValue("processes"), flutter::EncodableValue(std::move(processes))}
+    })}
   }));
 }
 
@@ -418,15 +1255,70 @@ void McpChannelPlugin::GetCapabilities(
     return;
   }
 
-  // Mock capabilities - will be replaced with actual query
-  result->Success(flutter::EncodableValue(flutter::EncodableMap{
-    {"filesystem", flutter::EncodableValue(flutter::EncodableMap{
-      {"tools", flutter::EncodableValue(flutter::EncodableList{"read_file", "write_file", "list_directory"})},
-      {"resources", flutter::EncodableValue(flutter::EncodableList{"files"})},
-      {"supportsProgress", flutter::EncodableValue(true)},
-      {"supportsCancel", flutter::EncodableValue(false)}
-    })}
-  }));
+  const std::string* server_id_option = GetStringOption(request, "serverId");
+  std::string server_id = server_id_option ? *server_id_option : std::string();
+  auto refresh = request.find(flutter::EncodableValue("refresh"));
+
+  McpCapabilityWaiter waiter;
+  waiter.known_version = GetIntOption(request, "knownVersion", 0);
+  waiter.result = std::move(result);
+  uint64_t generation;
+  if (capabilities_.GetOrQueue(server_id,
+                               refresh != request.end() &&
+                                   refresh->second == flutter::EncodableValue(true),
+                               std::move(waiter), &generation)) {
+    FetchCapabilities(server_id, generation);
+  }
+}
+
+void McpChannelPlugin::FetchCapabilities(const std::string& server_id, uint64_t generation) {
+  size_t process_index = process_pool_->Acquire(server_id);
+  if (process_index == NodeJsProcessPool::kNoProcess) {
+    capabilities_.Fail(server_id, "SEND_FAILED", "No MCP process is available");
+    return;
+  }
+
+  // The fetch is an ordinary pending request, so deadlines, dispose and
+  // metrics cover it; its result feeds the cache instead of a Dart caller.
+  McpPendingRequest pending;
+  pending.request_id = "capabilities:" + server_id;
+  pending.process_index = process_index;
+  pending.result = std::make_unique<flutter::MethodResultFunctions<flutter::EncodableValue>>(
+      [this, server_id, generation](const flutter::EncodableValue* response) mutable {
+        flutter::EncodableValue capabilities;
+        const auto* fields = response ? std::get_if<flutter::EncodableMap>(response) : nullptr;
+        const flutter::EncodableMap* data = fields ? GetMapOption(*fields, "data") : nullptr;
+        if (data) {
+          capabilities = flutter::EncodableValue(*data);
+        }
+        if (!capabilities_.Complete(server_id, &generation, std::move(capabilities))) {
+          FetchCapabilities(server_id, generation);
+        }
+      },
+      [this, server_id](const std::string& code, const std::string& message,
+                        const flutter::EncodableValue*) {
+        capabilities_.Fail(server_id, code, message);
+      },
+      nullptr);
+  flutter::EncodableMap params;
+  if (!server_id.empty()) {
+    params[flutter::EncodableValue("serverId")] = flutter::EncodableValue(server_id);
+  }
+  uint64_t wire_id = pending_requests_.AllocateId();
+  pending.wire_id = wire_id;
+  const std::string& message =
+      BuildRequestMessage("getCapabilities", params, pending.request_id, wire_id);
+  pending.replay_message = message;
+  pending_requests_.Insert(wire_id, std::move(pending));
+  McpMetrics::Add(McpMetrics::Get().requests_started);
+  ScheduleDeadline(wire_id, default_timeout_ms_);
+
+  if (!process_pool_->SendMessage(process_index, message)) {
+    if (pending_requests_.Take(wire_id, &pending)) {
+      process_pool_->Release(process_index);
+      RejectPendingRequest(&pending, "SEND_FAILED", "Failed to send message to MCP process");
+    }
+  }
 }
 
 void McpChannelPlugin::InjectContext(
@@ -438,18 +1330,322 @@ void McpChannelPlugin::InjectContext(
     return;
   }
 
+  const std::string* context_id = GetStringOption(request, "contextId");
+  if (!context_id) {
+    result->Error("INVALID_ARGUMENTS", "contextId is required");
+    return;
+  }
+
+  // Build the delta for the bridges while applying the change here.
+  std::string fields;
+  int64_t version = 0;
+  auto edits_it = request.find(flutter::EncodableValue("edits"));
+  if (const std::string* content = GetStringOption(request, "content")) {
+    version = contexts_.Set(*context_id, *content);
+    AppendContextHeader("set", *context_id, version, &fields);
+    fields.append(",\"content\":");
+    AppendJsonString(*content, &fields);
+  } else if (const std::string* text = GetStringOption(request, "append")) {
+    int64_t base_version = 0;
+    version = contexts_.Append(*context_id, *text, &base_version);
+    AppendContextHeader("append", *context_id, version, &fields);
+    fields.append(",\"baseVersion\":");
+    fields.append(std::to_string(base_version));
+    fields.append(",\"text\":");
+    AppendJsonString(*text, &fields);
+  } else if (edits_it != request.end()) {
+    const auto* edit_list = std::get_if<flutter::EncodableList>(&edits_it->second);
+    if (!edit_list) {
+      result->Error("INVALID_ARGUMENTS", "edits must be a list");
+      return;
+    }
+    std::vector<McpContextEdit> edits;
+    edits.reserve(edit_list->size());
+    for (const auto& item : *edit_list) {
+      const auto* edit_fields = std::get_if<flutter::EncodableMap>(&item);
+      int64_t offset = edit_fields ? GetIntOption(*edit_fields, "offset", -1) : -1;
+      int64_t delete_count = edit_fields ? GetIntOption(*edit_fields, "deleteCount", 0) : -1;
+      const std::string* insert = edit_fields ? GetStringOption(*edit_fields, "text") : nullptr;
+      if (offset < 0 || delete_count < 0) {
+        result->Error("INVALID_ARGUMENTS",
+                      "Each edit needs an offset and a non-negative deleteCount");
+        return;
+      }
+      edits.push_back(McpContextEdit{static_cast<uint64_t>(offset),
+                                     static_cast<uint64_t>(delete_count),
+                                     insert ? *insert : std::string()});
+    }
+    int64_t base_version = GetIntOption(request, "baseVersion", 0);
+    std::string error;
+    if (!contexts_.Splice(*context_id, base_version, edits, &version, &error)) {
+      result->Error("CONTEXT_CONFLICT", error);
+      return;
+    }
+    AppendContextHeader("splice", *context_id, version, &fields);
+    fields.append(",\"baseVersion\":");
+    fields.append(std::to_string(base_version));
+    fields.append(",\"edits\":[");
+    for (size_t index = 0; index < edits.size(); ++index) {
+      fields.append(index == 0 ? "{\"offset\":" : ",{\"offset\":");
+      fields.append(std::to_string(edits[index].offset));
+      fields.append(",\"deleteCount\":");
+      fields.append(std::to_string(edits[index].remove));
+      fields.append(",\"text\":");
+      AppendJsonString(edits[index].insert, &fields);
+      fields.push_back('}');
+    }
+    fields.push_back(']');
+  } else if (GetBoolOption(request, "remove")) {
+    bool removed = contexts_.Remove(*context_id);
+    if (removed) {
+      AppendContextHeader("remove", *context_id, 0, &fields);
+    }
+  } else {
+    result->Error("INVALID_ARGUMENTS", "Expected content, append, edits or remove");
+    return;
+  }
+
+  // Each bridge applies $/context as soon as it reads it, ahead of any
+  // request written after it on the same pipe, so a contextRefs entry pinned
+  // from here on always finds this version. A bridge that misses the delta
+  // gets every block whole when it restarts.
+  if (!fields.empty()) {
+    outbound_message_.clear();
+    AppendContextNotification(fields, &outbound_message_);
+    process_pool_->Broadcast(outbound_message_);
+  }
+
+  const McpContextStore::Block* block = contexts_.Find(*context_id);
   result->Success(flutter::EncodableValue(flutter::EncodableMap{
-    {"success", flutter::EncodableValue(true)},
-    {"message", flutter::EncodableValue("Context injected")}
+    {flutter::EncodableValue("contextId"), flutter::EncodableValue(*context_id)},
+    {flutter::EncodableValue("version"), flutter::EncodableValue(block ? block->version : 0)},
+    {flutter::EncodableValue("bytes"),
+     Int64Value(block ? block->content.size() : 0)}
+  }));
+}
+
+void McpChannelPlugin::SendContextBlocks(size_t process_index) {
+  std::string fields;
+  for (const auto& [context_id, block] : contexts_.blocks()) {
+    fields.clear();
+    AppendContextHeader("set", context_id, block.version, &fields);
+    fields.append(",\"content\":");
+    AppendJsonString(block.content, &fields);
+    outbound_message_.clear();
+    AppendContextNotification(fields, &outbound_message_);
+    process_pool_->SendMessage(process_index, outbound_message_);
+  }
+}
+
+void McpChannelPlugin::InvalidateCache(
+    const flutter::EncodableMap& request,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  const std::string* server_id = GetStringOption(request, "serverId");
+  const std::string* tool = GetStringOption(request, "tool");
+  results_.Invalidate(server_id ? *server_id : std::string(), tool ? *tool : std::string());
+  result->Success(flutter::EncodableValue(flutter::EncodableMap{
+    {flutter::EncodableValue("entries"), Int64Value(results_.entries())}
+  }));
+}
+
+void McpChannelPlugin::GetMetrics(
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  const McpMetrics& metrics = McpMetrics::Get();
+  flutter::EncodableMap counters{
+    {flutter::EncodableValue("bytesSent"), Int64Value(McpMetrics::Read(metrics.bytes_sent))},
+    {flutter::EncodableValue("messagesSent"), Int64Value(McpMetrics::Read(metrics.messages_sent))},
+    {flutter::EncodableValue("sendFailures"), Int64Value(McpMetrics::Read(metrics.send_failures))},
+    {flutter::EncodableValue("bytesReceived"),
+     Int64Value(McpMetrics::Read(metrics.bytes_received))},
+    {flutter::EncodableValue("messagesReceived"),
+     Int64Value(McpMetrics::Read(metrics.messages_received))},
+    {flutter::EncodableValue("framingNs"), Int64Value(McpMetrics::Read(metrics.framing_ns))},
+    {flutter::EncodableValue("parseNs"), Int64Value(McpMetrics::Read(metrics.parse_ns))},
+    {flutter::EncodableValue("parseErrors"), Int64Value(McpMetrics::Read(metrics.parse_errors))},
+    {flutter::EncodableValue("requestsStarted"),
+     Int64Value(McpMetrics::Read(metrics.requests_started))},
+    {flutter::EncodableValue("requestsSucceeded"),
+     Int64Value(McpMetrics::Read(metrics.requests_succeeded))},
+    {flutter::EncodableValue("requestsFailed"),
+     Int64Value(McpMetrics::Read(metrics.requests_failed))},
+    {flutter::EncodableValue("requestsCancelled"),
+     Int64Value(McpMetrics::Read(metrics.requests_cancelled))},
+    {flutter::EncodableValue("requestsTimedOut"),
+     Int64Value(McpMetrics::Read(metrics.requests_timed_out))},
+    {flutter::EncodableValue("requestsOverloaded"),
+     Int64Value(McpMetrics::Read(metrics.requests_overloaded))},
+    {flutter::EncodableValue("eventsDelivered"),
+     Int64Value(McpMetrics::Read(metrics.events_delivered))},
+    {flutter::EncodableValue("eventsUnheard"),
+     Int64Value(McpMetrics::Read(metrics.events_unheard))},
+    {flutter::EncodableValue("eventsDropped"), Int64Value(event_queue_.dropped())},
+    {flutter::EncodableValue("processRestarts"),
+     Int64Value(McpMetrics::Read(metrics.process_restarts))},
+    {flutter::EncodableValue("resultCacheHits"),
+     Int64Value(McpMetrics::Read(metrics.result_cache_hits))},
+    {flutter::EncodableValue("resultCacheMisses"),
+     Int64Value(McpMetrics::Read(metrics.result_cache_misses))},
+    {flutter::EncodableValue("resultCacheEvictions"),
+     Int64Value(McpMetrics::Read(metrics.result_cache_evictions))}
+  };
+
+  size_t write_queue_messages = 0;
+  size_t write_queue_bytes = 0;
+  size_t in_flight = 0;
+  size_t healthy_processes = 0;
+  std::vector<NodeJsProcessPool::ProcessStats> pool_stats = process_pool_->GetStats();
+  for (const auto& stats : pool_stats) {
+    write_queue_messages += stats.queued_messages;
+    write_queue_bytes += stats.queued_bytes;
+    in_flight += stats.in_flight;
+    healthy_processes += stats.healthy ? 1 : 0;
+  }
+  flutter::EncodableMap gauges{
+    {flutter::EncodableValue("pendingRequests"), Int64Value(pending_requests_.size())},
+    {flutter::EncodableValue("inFlight"), Int64Value(in_flight)},
+    {flutter::EncodableValue("writeQueueMessages"), Int64Value(write_queue_messages)},
+    {flutter::EncodableValue("writeQueueBytes"), Int64Value(write_queue_bytes)},
+    {flutter::EncodableValue("eventQueueDepth"), Int64Value(event_queue_.size())},
+    {flutter::EncodableValue("processes"), Int64Value(pool_stats.size())},
+    {flutter::EncodableValue("healthyProcesses"), Int64Value(healthy_processes)},
+    {flutter::EncodableValue("windowVisible"), flutter::EncodableValue(window_visible_)},
+    {flutter::EncodableValue("resultCacheEntries"), Int64Value(results_.entries())},
+    {flutter::EncodableValue("resultCacheBytes"), Int64Value(results_.bytes())}
+  };
+  flutter::EncodableMap lanes;
+  for (McpPriority priority :
+       {McpPriority::kInteractive, McpPriority::kNormal, McpPriority::kBulk}) {
+    lanes[flutter::EncodableValue(McpPriorityName(priority))] =
+        flutter::EncodableValue(flutter::EncodableMap{
+          {flutter::EncodableValue("queued"), Int64Value(lanes_.queued(priority))},
+          {flutter::EncodableValue("inFlight"), Int64Value(lanes_.in_flight(priority))}
+        });
+  }
+  flutter::EncodableList servers;
+  for (const auto& stats : server_limits_.GetStats()) {
+    servers.push_back(flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("serverId"), flutter::EncodableValue(stats.server_id)},
+      {flutter::EncodableValue("limit"), flutter::EncodableValue(stats.limit)},
+      {flutter::EncodableValue("inFlight"), Int64Value(stats.in_flight)},
+      {flutter::EncodableValue("queued"), Int64Value(stats.queued)},
+      {flutter::EncodableValue("minLatencyUs"), Int64Value(stats.no_load_latency_us)}
+    }));
+  }
+
+  result->Success(flutter::EncodableValue(flutter::EncodableMap{
+    {flutter::EncodableValue("counters"), flutter::EncodableValue(std::move(counters))},
+    {flutter::EncodableValue("gauges"), flutter::EncodableValue(std::move(gauges))},
+    {flutter::EncodableValue("lanes"), flutter::EncodableValue(std::move(lanes))},
+    {flutter::EncodableValue("servers"), flutter::EncodableValue(std::move(servers))},
+    {flutter::EncodableValue("pingLatency"),
+     flutter::EncodableValue(LatencySummaryToMap(ping_latency_.Summarize()))}
+  }));
+}
+
+void McpChannelPlugin::GetLogs(
+    const flutter::EncodableMap& arguments,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  McpLogLevel min_level = McpLogLevel::kDebug;
+  const std::string* level_name = GetStringOption(arguments, "level");
+  if (level_name && !ParseMcpLogLevel(*level_name, &min_level)) {
+    result->Error("INVALID_ARGUMENTS", "level must be debug, info, warn or error");
+    return;
+  }
+  int64_t since = std::max<int64_t>(GetIntOption(arguments, "since", 0), 0);
+  int64_t limit =
+      std::clamp<int64_t>(GetIntOption(arguments, "limit", kMaxLogQueryEntries), 0,
+                          kMaxLogQueryEntries);
+
+  McpLogBuffer& logs = McpLogBuffer::Get();
+  std::vector<McpLogEntry> entries;
+  uint64_t next = logs.Query(static_cast<uint64_t>(since), min_level,
+                             static_cast<size_t>(limit), &entries);
+  flutter::EncodableList list;
+  list.reserve(entries.size());
+  for (auto& entry : entries) {
+    list.push_back(flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("seq"), Int64Value(entry.sequence)},
+      {flutter::EncodableValue("timeMs"), flutter::EncodableValue(entry.time_ms)},
+      {flutter::EncodableValue("level"), flutter::EncodableValue(McpLogLevelName(entry.level))},
+      {flutter::EncodableValue("pid"), Int64Value(entry.pid)},
+      {flutter::EncodableValue("text"), flutter::EncodableValue(std::move(entry.text))}
+    }));
+  }
+  result->Success(flutter::EncodableValue(flutter::EncodableMap{
+    {flutter::EncodableValue("entries"), flutter::EncodableValue(std::move(list))},
+    {flutter::EncodableValue("nextSeq"), Int64Value(next)},
+    {flutter::EncodableValue("evicted"), Int64Value(logs.evicted())},
+    {flutter::EncodableValue("suppressed"), Int64Value(logs.suppressed())}
+  }));
+}
+
+void McpChannelPlugin::SetTracing(
+    const flutter::EncodableMap& arguments,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  const std::string* mode_name = GetStringOption(arguments, "mode");
+  McpTraceMode mode;
+  if (!mode_name || *mode_name == "off") {
+    mode = McpTraceMode::kOff;
+  } else if (*mode_name == "chrome") {
+    mode = McpTraceMode::kChromeTrace;
+  } else if (*mode_name == "etw") {
+    mode = McpTraceMode::kEtw;
+  } else {
+    result->Error("INVALID_ARGUMENTS", "mode must be off, chrome or etw");
+    return;
+  }
+  int64_t capacity = GetIntOption(arguments, "capacity",
+                                  static_cast<int64_t>(McpTrace::kDefaultCapacity));
+  McpTrace& trace = McpTrace::Get();
+  trace.SetMode(mode, static_cast<size_t>(std::max<int64_t>(capacity, 1)));
+
+  // ETW falls back to off when the provider cannot register.
+  result->Success(flutter::EncodableValue(flutter::EncodableMap{
+    {flutter::EncodableValue("enabled"),
+     flutter::EncodableValue(trace.mode() != McpTraceMode::kOff)}
+  }));
+}
+
+void McpChannelPlugin::FlushTrace(
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  std::string trace;
+  uint64_t overwritten = McpTrace::Get().Flush(&trace);
+  result->Success(flutter::EncodableValue(flutter::EncodableMap{
+    {flutter::EncodableValue("trace"), flutter::EncodableValue(std::move(trace))},
+    {flutter::EncodableValue("overwritten"), Int64Value(overwritten)}
   }));
 }
 
 void McpChannelPlugin::DisposeMcp(
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
   
-  if (node_process_) {
-    node_process_->Stop();
+  if (process_pool_) {
+    StopProcessPool();
+  }
+
+  // Nothing will answer requests still in flight once the processes are gone.
+  // Queued requests go first, so freed slots and lanes have nothing left to
+  // send.
+  for (auto& queued : server_limits_.TakeAll()) {
+    RejectPendingRequest(&queued.pending, "DISPOSED",
+                         "MCP was disposed before the request completed");
+  }
+  for (auto& queued : lanes_.TakeAll()) {
+    RejectPendingRequest(&queued.pending, "DISPOSED",
+                         "MCP was disposed before the request completed");
   }
+  for (auto& pending : pending_requests_.TakeAll()) {
+    RejectPendingRequest(&pending, "DISPOSED", "MCP was disposed before the request completed");
+  }
+  capabilities_.Clear("DISPOSED", "MCP was disposed before the request completed");
+  results_.Clear();
+  contexts_.Clear();
+  McpLogBuffer::Get().Flush();
 
   is_initialized_ = false;
   
@@ -459,39 +1655,144 @@ void McpChannelPlugin::DisposeMcp(
   }));
 }
 
+void McpChannelPlugin::ApplyWindowVisibility() {
+  // A frame already waiting is rescheduled, so events merged while hidden are
+  // delivered promptly on restore.
+  dispatcher_->SetFrameInterval(window_visible_ ? frame_interval_ : background_frame_interval_);
+  process_pool_->SetEfficiencyMode(!window_visible_ && throttle_background_processes_);
+}
+
 // Node.js message handling
-void McpChannelPlugin::HandleNodeMessage(const std::string& message) {
+void McpChannelPlugin::HandleNodeMessage(size_t process_index, const McpFrame& frame) {
+  McpTraceSpan span("HandleNodeMessage", frame.request_id);
   try {
-    // Simple JSON parsing for type and requestId
-    // In production, use a proper JSON parser
-    
-    if (message.find("\"type\":\"response\"") != std::string::npos) {
-      // Extract requestId using simple string operations
-      size_t req_id_start = message.find("\"requestId\":\"");
-      if (req_id_start != std::string::npos) {
-        req_id_start += 13; // Length of "requestId":"
-        size_t req_id_end = message.find("\"", req_id_start);
-        if (req_id_end != std::string::npos) {
-          std::string request_id = message.substr(req_id_start, req_id_end - req_id_start);
-          
-          std::lock_guard<std::mutex> lock(pending_requests_mutex_);
-          auto it = pending_requests_.find(request_id);
-          if (it != pending_requests_.end()) {
-            if (message.find("\"error\":") != std::string::npos && message.find("\"error\":null") == std::string::npos) {
-              it->second->Error("MCP_ERROR", "Error processing request");
-            } else {
-              auto response_data = JsonStringToEncodableValue(message);
-              it->second->Success(response_data);
+    if (frame.type == McpFrameType::kBinary) {
+      // Raw result bytes from a length-prefixed frame go to Dart as a
+      // Uint8List, without a base64 round trip.
+      McpPendingRequest pending;
+      if (pending_requests_.Take(frame.request_id, &pending)) {
+        process_pool_->Release(pending.process_index);
+        const auto* bytes = reinterpret_cast<const uint8_t*>(frame.payload.data());
+        ResolvePendingRequest(&pending, flutter::EncodableValue(flutter::EncodableMap{
+          {flutter::EncodableValue("type"), flutter::EncodableValue("response")},
+          {flutter::EncodableValue("requestId"), flutter::EncodableValue(pending.request_id)},
+          {flutter::EncodableValue("data"),
+           flutter::EncodableValue(std::vector<uint8_t>(bytes, bytes + frame.payload.size()))}
+        }));
+      }
+      return;
+    }
+    if (frame.type != McpFrameType::kJson) {
+      return;
+    }
+
+    // Route on the top-level fields only; payload contents are skipped, so
+    // look-alike keys inside tool results cannot misroute a message.
+    std::string_view message = frame.payload;
+    McpMessageEnvelope envelope;
+    bool scanned;
+    {
+      McpScopedTimer timer(McpMetrics::Get().parse_ns);
+      scanned = ScanMcpMessageEnvelope(message, &envelope);
+    }
+    if (!scanned) {
+      McpMetrics::Add(McpMetrics::Get().parse_errors);
+      std::cerr << "Error parsing Node.js message: malformed JSON" << std::endl;
+      return;
+    }
+
+    if (envelope.type == "response") {
+      uint64_t wire_id = frame.request_id != 0 ? frame.request_id : envelope.id;
+      if (wire_id == 0) {
+        return;
+      }
+      span.set_id(wire_id);
+      if (envelope.processing_us > 0 && McpTrace::enabled()) {
+        // The bridge only reports a duration; it ended as the response left,
+        // which is as close to now as this side can tell.
+        auto now = McpTrace::Clock::now();
+        McpTrace::Get().RecordBridge("BridgeProcess", process_index,
+                                     now - std::chrono::microseconds(envelope.processing_us), now,
+                                     wire_id);
+      }
+
+      // Only the removal is locked; decoding and delivery run unlocked.
+      McpPendingRequest pending;
+      if (pending_requests_.Take(wire_id, &pending)) {
+        process_pool_->Release(pending.process_index);
+        flutter::EncodableValue response_data;
+        if (envelope.has_error) {
+          // The bridge reports {type, message}. Its message is the one Dart
+          // sees, and the whole error goes along as the details.
+          flutter::EncodableValue error;
+          std::string error_message = "Error processing request";
+          if (DecodeJsonToEncodableValue(envelope.error, &error)) {
+            const auto* fields = std::get_if<flutter::EncodableMap>(&error);
+            const std::string* text = fields ? GetStringOption(*fields, "message")
+                                             : std::get_if<std::string>(&error);
+            if (text) {
+              error_message = *text;
             }
-            pending_requests_.erase(it);
           }
+          RejectPendingRequest(&pending, "MCP_ERROR", error_message, std::move(error));
+        } else if (!(pending.transcode ? TranscodeMessage(message, &response_data)
+                                       : DecodeMessage(message, &response_data))) {
+          RejectPendingRequest(&pending, "INVALID_RESPONSE", "Malformed response from MCP process");
+        } else {
+          ResolvePendingRequest(&pending, std::move(response_data));
         }
       }
-    } else if (message.find("\"type\":\"event\"") != std::string::npos) {
-      // Send event to Flutter via event channel
-      if (stream_handler_ && stream_handler_->event_sink_) {
-        auto event_data = JsonStringToEncodableValue(message);
-        stream_handler_->event_sink_->Success(event_data);
+    } else if (envelope.type == "chunk") {
+      // One slice of a chunked response's JSON text. Chunks of a request
+      // that already timed out or was cancelled are dropped.
+      uint64_t wire_id = frame.request_id != 0 ? frame.request_id : envelope.id;
+      flutter::EncodableValue chunk;
+      if (!pending_requests_.Contains(wire_id) || !DecodeMessage(message, &chunk)) {
+        return;
+      }
+      auto* fields = std::get_if<flutter::EncodableMap>(&chunk);
+      if (!fields) {
+        return;
+      }
+      // Waits for room under every policy, which stops this pipe until the
+      // platform thread catches up; the bridge waits for stdout to drain
+      // between chunks, so a long response is paced rather than dropped.
+      SendEvent("response_chunk", flutter::EncodableMap{
+        {flutter::EncodableValue("requestId"), TakeMember(fields, "requestId")},
+        {flutter::EncodableValue("seq"), TakeMember(fields, "seq")},
+        {flutter::EncodableValue("data"), TakeMember(fields, "data")}
+      }, McpEventPriority::kLossless);
+    } else if (envelope.type == "event") {
+      // Queue the event for the platform thread, which owns the event sink.
+      flutter::EncodableValue event_data;
+      if (!DecodeMessage(message, &event_data)) {
+        return;
+      }
+      std::string changed_server_id;
+      std::string changed_tool;
+      if (IsCapabilitiesChanged(event_data, &changed_server_id)) {
+        capabilities_.Invalidate(changed_server_id);
+        results_.Invalidate(changed_server_id, std::string());
+      } else if (IsCacheInvalidated(event_data, &changed_server_id, &changed_tool)) {
+        results_.Invalidate(changed_server_id, changed_tool);
+      }
+      if (event_queue_.Push(std::move(event_data))) {
+        dispatcher_->RequestFrame();
+      }
+    } else if (envelope.type == "pong") {
+      CompletePing(envelope.id, false);
+    } else if (envelope.type == "transport") {
+      // The bridge accepted the framing requested in the initialize config and
+      // reads it from now on; switch our outbound side to match.
+      flutter::EncodableValue ack;
+      const auto* fields =
+          DecodeMessage(message, &ack) ? std::get_if<flutter::EncodableMap>(&ack) : nullptr;
+      if (fields) {
+        auto framing = fields->find(flutter::EncodableValue("framing"));
+        if (framing != fields->end() &&
+            framing->second == flutter::EncodableValue("length-prefixed")) {
+          process_pool_->SetOutboundFraming(process_index, McpFraming::kLengthPrefixed);
+        }
       }
     }
   } catch (const std::exception& e) {
@@ -499,6 +1800,174 @@ void McpChannelPlugin::HandleNodeMessage(const std::string& message) {
   }
 }
 
+void McpChannelPlugin::ResolvePendingRequest(McpPendingRequest* pending,
+                                             flutter::EncodableValue value) {
+  // Completions from the I/O threads are replayed on the platform thread.
+  // Decoding has already happened, so the platform thread only delivers.
+  if (!dispatcher_->RunsTasksOnCurrentThread()) {
+    auto posted = std::make_shared<McpPendingRequest>(std::move(*pending));
+    dispatcher_->Post([this, posted, value = std::move(value)]() mutable {
+      ResolvePendingRequest(posted.get(), std::move(value));
+    });
+    return;
+  }
+
+  McpTraceSpan span("DeliverResult");
+  span.set_detail(pending->request_id);
+  McpMetrics::Add(McpMetrics::Get().requests_succeeded);
+  CancelDeadline(pending->wire_id);
+  ReleaseLane(pending);
+  ReleaseServerSlot(pending, McpConcurrencyLimiter::Outcome::kCompleted);
+  if (pending->chunked) {
+    CompleteChunkedResponse(pending, std::move(value));
+  } else if (pending->batch) {
+    CompleteBatchEntry(pending, std::move(value));
+  } else if (pending->result) {
+    pending->result->Success(value);
+    if (!pending->cache_key.empty()) {
+      // The wire id and timing belong to this round trip, not to the calls
+      // the entry will answer; a hit stamps its own requestId instead.
+      if (auto* fields = std::get_if<flutter::EncodableMap>(&value)) {
+        fields->erase(flutter::EncodableValue("id"));
+        fields->erase(flutter::EncodableValue("processingUs"));
+      }
+      results_.Store(pending->cache_key, pending->server_id, pending->cache_tool,
+                     std::move(value), pending->cache_ttl_ms, pending->cache_generation);
+    }
+  }
+}
+
+void McpChannelPlugin::RejectPendingRequest(McpPendingRequest* pending, const std::string& code,
+                                            const std::string& message,
+                                            flutter::EncodableValue details) {
+  if (!dispatcher_->RunsTasksOnCurrentThread()) {
+    auto posted = std::make_shared<McpPendingRequest>(std::move(*pending));
+    dispatcher_->Post([this, posted, code, message, details = std::move(details)]() {
+      RejectPendingRequest(posted.get(), code, message, details);
+    });
+    return;
+  }
+
+  McpTraceSpan span("DeliverResult");
+  span.set_detail(pending->request_id);
+  CancelDeadline(pending->wire_id);
+  ReleaseLane(pending);
+  ReleaseServerSlot(pending, OutcomeForError(code));
+  McpMetrics& metrics = McpMetrics::Get();
+  if (code == "CANCELLED") {
+    McpMetrics::Add(metrics.requests_cancelled);
+  } else if (code == "TIMEOUT") {
+    McpMetrics::Add(metrics.requests_timed_out);
+  } else {
+    McpMetrics::Add(metrics.requests_failed);
+  }
+  if (pending->chunked || pending->batch) {
+    flutter::EncodableMap error{
+      {flutter::EncodableValue("code"), flutter::EncodableValue(code)},
+      {flutter::EncodableValue("message"), flutter::EncodableValue(message)}
+    };
+    if (!details.IsNull()) {
+      error[flutter::EncodableValue("details")] = std::move(details);
+    }
+    flutter::EncodableMap outcome{
+      {flutter::EncodableValue("requestId"), flutter::EncodableValue(pending->request_id)},
+      {flutter::EncodableValue("error"), flutter::EncodableValue(std::move(error))}
+    };
+    if (pending->chunked) {
+      SendEvent("response_complete", std::move(outcome));
+    } else {
+      // A failed entry fails only its own slot of the batch.
+      CompleteBatchEntry(pending, flutter::EncodableValue(std::move(outcome)));
+    }
+  } else if (pending->result) {
+    if (details.IsNull()) {
+      pending->result->Error(code, message);
+    } else {
+      pending->result->Error(code, message, details);
+    }
+  }
+}
+
+void McpChannelPlugin::CompleteBatchEntry(McpPendingRequest* pending,
+                                          flutter::EncodableValue item) {
+  McpPendingBatch& batch = *pending->batch;
+  if (batch.stream) {
+    SendEvent("batch_result", flutter::EncodableMap{
+      {flutter::EncodableValue("batchId"), flutter::EncodableValue(batch.batch_id)},
+      {flutter::EncodableValue("index"),
+       flutter::EncodableValue(static_cast<int64_t>(pending->batch_index))},
+      {flutter::EncodableValue("requestId"), flutter::EncodableValue(pending->request_id)},
+      {flutter::EncodableValue("result"), std::move(item)}
+    });
+  }
+
+  bool done;
+  {
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    if (!batch.stream) {
+      batch.results[pending->batch_index] = std::move(item);
+    }
+    done = --batch.remaining == 0;
+  }
+  if (!done) {
+    return;
+  }
+  if (batch.stream) {
+    SendEvent("batch_complete", flutter::EncodableMap{
+      {flutter::EncodableValue("batchId"), flutter::EncodableValue(batch.batch_id)}
+    });
+  } else if (batch.result) {
+    batch.result->Success(flutter::EncodableValue(std::move(batch.results)));
+  }
+}
+
+void McpChannelPlugin::CompleteChunkedResponse(McpPendingRequest* pending,
+                                               flutter::EncodableValue response) {
+  // A bridge that split the response ends it with {"chunks": n}. Anything
+  // else, such as a binary frame, is the whole response as one chunk.
+  auto* fields = std::get_if<flutter::EncodableMap>(&response);
+  flutter::EncodableValue chunks = fields ? TakeMember(fields, "chunks") : flutter::EncodableValue();
+  if (chunks.IsNull()) {
+    SendEvent("response_chunk", flutter::EncodableMap{
+      {flutter::EncodableValue("requestId"), flutter::EncodableValue(pending->request_id)},
+      {flutter::EncodableValue("seq"), flutter::EncodableValue(0)},
+      {flutter::EncodableValue("data"),
+       fields ? TakeMember(fields, "data") : std::move(response)}
+    });
+    chunks = flutter::EncodableValue(1);
+  }
+  SendEvent("response_complete", flutter::EncodableMap{
+    {flutter::EncodableValue("requestId"), flutter::EncodableValue(pending->request_id)},
+    {flutter::EncodableValue("chunks"), std::move(chunks)}
+  });
+}
+
+void McpChannelPlugin::SendEvent(const char* event, flutter::EncodableMap data,
+                                 McpEventPriority priority) {
+  if (event_queue_.Push(flutter::EncodableValue(flutter::EncodableMap{
+        {flutter::EncodableValue("type"), flutter::EncodableValue("event")},
+        {flutter::EncodableValue("event"), flutter::EncodableValue(event)},
+        {flutter::EncodableValue("data"), flutter::EncodableValue(std::move(data))}
+      }), priority)) {
+    dispatcher_->RequestFrame();
+  }
+}
+
+void McpChannelPlugin::DeliverEvents() {
+  // Events queued while nobody listens are dropped here rather than kept.
+  event_queue_.Drain(&delivered_events_);
+  McpMetrics& metrics = McpMetrics::Get();
+  if (stream_handler_ && stream_handler_->event_sink_) {
+    for (const auto& event : delivered_events_) {
+      stream_handler_->event_sink_->Success(event);
+    }
+    McpMetrics::Add(metrics.events_delivered, delivered_events_.size());
+  } else {
+    McpMetrics::Add(metrics.events_unheard, delivered_events_.size());
+  }
+  delivered_events_.clear();
+}
+
 // Utility methods
 std::string McpChannelPlugin::GetMcpScriptPath() {
   // Get executable directory and construct path to MCP script
@@ -515,48 +1984,209 @@ std::string McpChannelPlugin::GetMcpScriptPath() {
   return exe_dir + "\\mcp_bridge.js";
 }
 
-flutter::EncodableValue McpChannelPlugin::JsonStringToEncodableValue(const std::string& json_str) {
-  // Simple JSON to EncodableValue conversion (placeholder implementation)
-  // TODO: Replace with proper JSON parsing using nlohmann::json or similar
-  
-  // For now, just return the JSON string as data
-  return flutter::EncodableValue(flutter::EncodableMap{
-    {"data", flutter::EncodableValue(json_str)}
-  });
+void McpChannelPlugin::CancelDeadline(uint64_t wire_id) {
+  if (request_deadlines_.Cancel(wire_id) && request_deadlines_.empty() && deadlines_ticking_) {
+    deadlines_ticking_ = false;
+    dispatcher_->StopTicking();
+  }
 }
 
-std::string McpChannelPlugin::EncodableValueToJsonString(const flutter::EncodableValue& value) {
-  // Simple JSON conversion - in production use proper JSON library
-  std::ostringstream json_stream;
-  
-  if (auto map = std::get_if<flutter::EncodableMap>(&value)) {
-    json_stream << "{";
-    bool first = true;
-    for (const auto& [key, val] : *map) {
-      if (!first) json_stream << ",";
-      first = false;
-      
-      std::string key_str = std::get<std::string>(key);
-      json_stream << "\"" << key_str << "\":";
-      
-      if (auto str_val = std::get_if<std::string>(&val)) {
-        json_stream << "\"" << *str_val << "\"";
-      } else if (auto int_val = std::get_if<int32_t>(&val)) {
-        json_stream << *int_val;
-      } else if (auto bool_val = std::get_if<bool>(&val)) {
-        json_stream << (*bool_val ? "true" : "false");
-      } else if (auto double_val = std::get_if<double>(&val)) {
-        json_stream << *double_val;
-      } else {
-        json_stream << "null";
+void McpChannelPlugin::ScheduleDeadline(uint64_t wire_id, int64_t timeout_ms) {
+  if (timeout_ms <= 0) {
+    return;
+  }
+  request_deadlines_.Schedule(wire_id, std::chrono::milliseconds(timeout_ms));
+  if (!deadlines_ticking_) {
+    deadlines_ticking_ = true;
+    dispatcher_->StartTicking(kDeadlineTick, [this]() { ExpireRequests(); });
+  }
+}
+
+void McpChannelPlugin::HandleBridgeExit(size_t process_index) {
+  for (auto& pending : pending_requests_.TakeUnreplayable(process_index, kMaxReplays)) {
+    process_pool_->Release(process_index);
+    RejectPendingRequest(&pending, "BRIDGE_CRASHED",
+                         "The MCP process exited before the request completed");
+  }
+
+  std::vector<uint64_t> lost_pings;
+  {
+    std::lock_guard<std::mutex> lock(pings_mutex_);
+    for (const auto& [wire_id, ping] : pings_) {
+      if (ping.process_index == process_index) {
+        lost_pings.push_back(wire_id);
       }
     }
-    json_stream << "}";
-  } else if (auto str = std::get_if<std::string>(&value)) {
-    json_stream << "\"" << *str << "\"";
-  } else {
-    json_stream << "{}";
   }
-  
-  return json_stream.str();
-}
\ No newline at end of file
+  for (uint64_t wire_id : lost_pings) {
+    CompletePing(wire_id, true);
+  }
+
+  SendEvent("bridge_exited", flutter::EncodableMap{
+    {flutter::EncodableValue("processIndex"),
+     flutter::EncodableValue(static_cast<int64_t>(process_index))}
+  });
+}
+
+void McpChannelPlugin::HandleBridgeRestart(size_t process_index, uint32_t attempt) {
+  SendEvent("bridge_restarted", flutter::EncodableMap{
+    {flutter::EncodableValue("processIndex"),
+     flutter::EncodableValue(static_cast<int64_t>(process_index))},
+    {flutter::EncodableValue("attempt"), flutter::EncodableValue(static_cast<int64_t>(attempt))}
+  });
+  if (!is_initialized_) {
+    process_pool_->FinishRestart(process_index);
+    return;
+  }
+
+  // The bridge runs requests concurrently, so replays wait for the
+  // initialize response instead of racing it.
+  McpPendingRequest pending;
+  pending.request_id = "init_restart_" + std::to_string(process_index) + "_" +
+                       std::to_string(attempt);
+  pending.process_index = process_index;
+  pending.result = std::make_unique<flutter::MethodResultFunctions<flutter::EncodableValue>>(
+      [this, process_index](const flutter::EncodableValue*) {
+        process_pool_->FinishRestart(process_index);
+        ReplayRequests(process_index);
+      },
+      [this, process_index](const std::string& code, const std::string& message,
+                            const flutter::EncodableValue*) {
+        // Crashed again: the next restart takes over the waiting requests.
+        if (code == "BRIDGE_CRASHED") {
+          return;
+        }
+        process_pool_->FinishRestart(process_index);
+        for (auto& waiting : pending_requests_.TakeUnreplayable(process_index, 0)) {
+          process_pool_->Release(process_index);
+          RejectPendingRequest(&waiting, "BRIDGE_CRASHED",
+                               "The restarted MCP process failed to initialize: " + message);
+        }
+      },
+      nullptr);
+  process_pool_->Retain(process_index);
+  uint64_t wire_id = pending_requests_.AllocateId();
+  pending.wire_id = wire_id;
+  const std::string& init_message =
+      BuildInitializeMessage(process_index, init_config_, pending.request_id, wire_id);
+  pending_requests_.Insert(wire_id, std::move(pending));
+  McpMetrics::Add(McpMetrics::Get().requests_started);
+  ScheduleDeadline(wire_id, kRestartInitTimeoutMs);
+
+  if (!process_pool_->SendMessage(process_index, init_message)) {
+    if (pending_requests_.Take(wire_id, &pending)) {
+      process_pool_->Release(process_index);
+      RejectPendingRequest(&pending, "SEND_FAILED",
+                           "Failed to send initialization config to restarted MCP process");
+    }
+    return;
+  }
+  // Context notifications apply as they arrive, so the blocks are in place
+  // before the replays that reference them.
+  SendContextBlocks(process_index);
+}
+
+void McpChannelPlugin::ReplayRequests(size_t process_index) {
+  std::vector<std::string> messages;
+  pending_requests_.GetReplayMessages(process_index, &messages);
+  for (const auto& message : messages) {
+    process_pool_->SendMessage(process_index, message);
+  }
+}
+
+void McpChannelPlugin::ExpireRequests() {
+  request_deadlines_.Advance(McpTimerWheel::Clock::now(), &expired_requests_);
+  for (uint64_t wire_id : expired_requests_) {
+    McpPendingRequest pending;
+    McpQueuedRequest queued;
+    if (pending_requests_.Take(wire_id, &pending)) {
+      process_pool_->Release(pending.process_index);
+      SendCancelNotification(pending.process_index, wire_id, pending.request_id);
+      RejectPendingRequest(&pending, "TIMEOUT", "Request timed out");
+    } else if (lanes_.TakeByWireId(wire_id, &queued)) {
+      RejectPendingRequest(&queued.pending, "TIMEOUT", "Request timed out waiting for its lane");
+    } else if (server_limits_.TakeByWireId(wire_id, &queued)) {
+      RejectPendingRequest(&queued.pending, "TIMEOUT", "Request timed out waiting for its server");
+    } else {
+      CompletePing(wire_id, true);
+    }
+  }
+  expired_requests_.clear();
+  if (request_deadlines_.empty()) {
+    deadlines_ticking_ = false;
+    dispatcher_->StopTicking();
+  }
+}
+
+void McpChannelPlugin::SendCancelNotification(size_t process_index, uint64_t wire_id,
+                                              const std::string& request_id) {
+  outbound_message_.clear();
+  outbound_message_.append("{\"method\":\"$/cancelRequest\",\"params\":{\"id\":");
+  outbound_message_.append(std::to_string(wire_id));
+  outbound_message_.append(",\"requestId\":");
+  AppendJsonString(request_id, &outbound_message_);
+  outbound_message_.append("}}");
+  process_pool_->SendMessage(process_index, outbound_message_);
+}
+
+std::string_view McpChannelPlugin::GetAffinityKey(const flutter::EncodableMap& request) {
+  // Requests for the same MCP server stay on one process, so a server's
+  // session state lives in a single bridge.
+  auto server_id_it = request.find(flutter::EncodableValue("serverId"));
+  if (server_id_it != request.end()) {
+    if (const auto* server_id = std::get_if<std::string>(&server_id_it->second)) {
+      return *server_id;
+    }
+  }
+  return {};
+}
+
+const std::string& McpChannelPlugin::BuildRequestMessage(
+    const char* method, const flutter::EncodableMap& params, const std::string& request_id,
+    uint64_t wire_id) {
+  // The buffer keeps its capacity between calls, so steady-state requests
+  // serialize without allocating.
+  outbound_message_.clear();
+  AppendRequestMessage(method, params, request_id, wire_id, &outbound_message_);
+  return outbound_message_;
+}
+
+const std::string& McpChannelPlugin::BuildInitializeMessage(
+    size_t process_index, const flutter::EncodableMap& config, const std::string& request_id,
+    uint64_t wire_id) {
+  const flutter::EncodableMap* transport = GetMapOption(config, "transport");
+  const std::string* framing = transport ? GetStringOption(*transport, "framing") : nullptr;
+  if (!framing || *framing != "length-prefixed") {
+    return BuildRequestMessage("initialize", config, request_id, wire_id);
+  }
+  auto shared_it = transport->find(flutter::EncodableValue("sharedMemory"));
+  std::string path;
+  size_t capacity = 0;
+  if ((shared_it != transport->end() && shared_it->second == flutter::EncodableValue(false)) ||
+      !process_pool_->OpenSharedMemory(process_index, &path, &capacity)) {
+    return BuildRequestMessage("initialize", config, request_id, wire_id);
+  }
+  flutter::EncodableMap shared_transport = *transport;
+  shared_transport[flutter::EncodableValue("sharedMemoryPath")] = flutter::EncodableValue(path);
+  shared_transport[flutter::EncodableValue("sharedMemoryBytes")] = Int64Value(capacity);
+  flutter::EncodableMap shared_config = config;
+  shared_config[flutter::EncodableValue("transport")] =
+      flutter::EncodableValue(std::move(shared_transport));
+  return BuildRequestMessage("initialize", shared_config, request_id, wire_id);
+}
+
+void McpChannelPlugin::AppendRequestMessage(const char* method,
+                                            const flutter::EncodableMap& params,
+                                            const std::string& request_id, uint64_t wire_id,
+                                            std::string* out) {
+  McpTraceSpan span("EncodeRequest", wire_id);
+  out->append("{\"method\":");
+  AppendJsonString(method, out);
+  out->append(",\"params\":");
+  AppendJson(params, out);
+  out->append(",\"requestId\":");
+  AppendJsonString(request_id, out);
+  out->append(",\"id\":");
+  out->append(std::to_string(wire_id));
+  out->push_back('}');
+}
@@ -2,29 +2,60 @@
 #define RUNNER_MCP_CHANNEL_PLUGIN_H_
 
 #include <flutter/method_channel.h>
-#include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
 #include <flutter/event_channel.h>
 #include <flutter/event_stream_handler.h>
 #include <flutter/binary_messenger.h>
-#include <flutter_windows.h>
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <map>
+#include <unordered_map>
 #include <functional>
 #include <thread>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 
+#include "mcp_capability_cache.h"
+#include "mcp_concurrency_limiter.h"
+#include "mcp_context_store.h"
+#include "mcp_event_queue.h"
+#include "mcp_framing.h"
+#include "mcp_lane_scheduler.h"
+#include "mcp_latency_histogram.h"
+#include "mcp_platform_dispatcher.h"
+#include "mcp_request_registry.h"
+#include "mcp_result_cache.h"
+#include "mcp_timer_wheel.h"
+#include "node_js_process_pool.h"
+
 class McpChannelPlugin {
  public:
-  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
-
-  McpChannelPlugin();
+  // Handles the agentengine.mcp method channel and the agentengine.mcp.events
+  // event channel of |messenger|, which must outlive the plugin. Create on
+  // the platform thread.
+  explicit McpChannelPlugin(flutter::BinaryMessenger* messenger);
 
   virtual ~McpChannelPlugin();
 
+  // Prevent copying.
+  McpChannelPlugin(McpChannelPlugin const&) = delete;
+  McpChannelPlugin& operator=(McpChannelPlugin const&) = delete;
+
+  // Starts one bridge process ahead of the first initialize call, so Node
+  // startup and module loading overlap with app launch. Skipped when the
+  // ASMBLI_MCP_PREWARM environment variable is 0.
+  void Prewarm();
+
+  // Tells the plugin whether the app window can be seen. While it cannot,
+  // events are delivered once per background frame interval, merged in the
+  // meantime, and the bridges run in efficiency mode. Platform thread only.
+  void SetWindowVisible(bool visible);
+
  private:
   // Method channel handler
   void HandleMethodCall(
@@ -54,79 +85,296 @@ class McpChannelPlugin {
     McpChannelPlugin* plugin_;
   };
 
-  // Node.js process management
-  class NodeJsProcess {
-   public:
-    NodeJsProcess();
-    ~NodeJsProcess();
+  // Starts the pool with |size| processes, or keeps it if it already runs
+  // that many.
+  bool StartProcessPool(size_t size);
 
-    bool Start(const std::string& script_path);
-    void Stop();
-    bool IsRunning() const;
-    
-    // Send JSON message to Node.js process
-    bool SendMessage(const std::string& message);
-    
-    // Set callback for receiving messages from Node.js
-    void SetMessageCallback(std::function<void(const std::string&)> callback);
-
-   private:
-    void ReadOutputThread();
-    void ReadErrorThread();
-    
-    HANDLE child_stdin_write_;
-    HANDLE child_stdout_read_;
-    HANDLE child_stderr_read_;
-    PROCESS_INFORMATION process_info_;
-    bool is_running_;
-    std::thread output_thread_;
-    std::thread error_thread_;
-    std::function<void(const std::string&)> message_callback_;
-    std::mutex callback_mutex_;
-  };
+  // Stops the pool. A bridge I/O thread blocked on a full event queue
+  // keeps its read outstanding, which NodeJsProcess::Stop waits for, and only
+  // this thread drains the queue; so the queue is closed around the stop.
+  void StopProcessPool();
 
   // MCP operations
   void InitializeMcp(const flutter::EncodableMap& config,
                      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   
+  // Sends request.message to a bridge. The call completes with the response,
+  // or, with request.chunked, at once; the response then arrives as
+  // response_chunk events {requestId, seq, data}, each data a consecutive
+  // slice of the response's JSON text of at most request.chunkBytes, and a
+  // response_complete event {requestId, chunks} or {requestId, error}.
+  //
+  // request.priority, "interactive", "normal" (the default) or "bulk", picks
+  // the lanes_ lane the call waits in; streamMessage takes it too.
+  //
+  // Calls to one serverId share server_limits_' adaptive limit on how many
+  // are in flight. A call over it waits for a slot or, once the server's
+  // queue is full, fails with OVERLOADED and details {retriable: true,
+  // serverId, limit}. Streams and batches are not limited.
+  //
+  // request.contextRefs names context blocks the call uses, as ids or
+  // {id, version}; it fails with CONTEXT_NOT_FOUND or CONTEXT_VERSION_MISMATCH
+  // unless each is in contexts_ at that version, and the bridge gets the
+  // refs pinned to the current versions.
+  //
+  // request.cache, true or {tool, ttlMs}, opts a read-only call in to
+  // results_: a repeat of it with the same serverId, tool (cache.tool or
+  // request.tool) and other arguments is answered from there, marked
+  // "cached", without reaching a bridge. Chunked calls are never cached.
   void ProcessMessage(const flutter::EncodableMap& request,
                       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   
+  // Sends every map in request.requests to one bridge as a single batch
+  // array. With mode "all", the default, the call completes with the list of
+  // results in request order; with mode "stream" it completes as soon as the
+  // batch is sent and each result follows as a batch_result event. Entries
+  // take the options of processMessage except chunked, which fails the
+  // entry; their contextRefs are pinned the same way.
+  void ProcessBatch(const flutter::EncodableMap& request,
+                    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Abandons the pending request request.requestId: its MethodResult fails
+  // with CANCELLED and the bridge is told to stop working on it.
+  void CancelRequest(const flutter::EncodableMap& request,
+                     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
   void StreamMessage(const flutter::EncodableMap& request,
                      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   
   void TestConnection(const flutter::EncodableMap& request,
                       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   
+  // Answers from capabilities_ when it can. request.knownVersion, if the
+  // caller's cached copy is current, gets {"unchanged": true} without the
+  // payload; request.refresh bypasses the cache.
   void GetCapabilities(const flutter::EncodableMap& request,
                        std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Asks a bridge for the capabilities of |server_id|, or of every server
+  // when it is empty, and reports the answer to capabilities_.
+  void FetchCapabilities(const std::string& server_id, uint64_t generation);
   
+  // Updates context block request.contextId in contexts_ and forwards the
+  // change to every bridge as a delta. The change is one of content (replace
+  // the block), append, edits [{offset, deleteCount, text}] against
+  // baseVersion, with offsets in UTF-8 bytes, or remove: true. Completes with
+  // {contextId, version, bytes}.
   void InjectContext(const flutter::EncodableMap& request,
                      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
+  // Sends every block in contexts_ whole to the process at |process_index|,
+  // which holds none of them yet.
+  void SendContextBlocks(size_t process_index);
+
+  // Drops the results_ entries of request.serverId and request.tool; either
+  // may be omitted to match all.
+  void InvalidateCache(const flutter::EncodableMap& request,
+                       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Reports McpMetrics counters plus queue depths sampled at the call.
+  void GetMetrics(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Returns McpLogBuffer entries after arguments.since at arguments.level or
+  // above, at most arguments.limit of them, with the nextSeq to pass as since
+  // to continue.
+  void GetLogs(const flutter::EncodableMap& arguments,
+               std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Switches McpTrace between off, a Chrome trace ring buffer and ETW.
+  void SetTracing(const flutter::EncodableMap& arguments,
+                  std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Returns and clears the buffered Chrome trace.
+  void FlushTrace(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
   void DisposeMcp(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
+  // Applies window_visible_ to event delivery and the bridge processes.
+  void ApplyWindowVisibility();
+
   // Node.js message handling
-  void HandleNodeMessage(const std::string& message);
+  void HandleNodeMessage(size_t process_index, const McpFrame& frame);
+
+  // Deliver the outcome of a request taken from pending_requests_, to its
+  // MethodResult or to its batch. Safe to call from any thread; delivery
+  // always happens on the platform thread. A rejection's |details|, unless
+  // null, go with its code and message.
+  void ResolvePendingRequest(McpPendingRequest* pending, flutter::EncodableValue value);
+  void RejectPendingRequest(McpPendingRequest* pending, const std::string& code,
+                            const std::string& message,
+                            flutter::EncodableValue details = flutter::EncodableValue());
+  void CompleteBatchEntry(McpPendingRequest* pending, flutter::EncodableValue item);
+  void CompleteChunkedResponse(McpPendingRequest* pending, flutter::EncodableValue response);
+
+  // Queues one of the plugin's own {"type": "event", "event", "data"}
+  // messages for the event channel; the overflow policy does not apply to
+  // them. Bridge chunks pass kLossless to wait for room. Safe to call from
+  // any thread.
+  void SendEvent(const char* event, flutter::EncodableMap data,
+                 McpEventPriority priority = McpEventPriority::kControl);
+
+  // Sends the queued events to Dart. Runs on the platform thread once per
+  // dispatcher frame.
+  void DeliverEvents();
   
+  // Sends |message| for request |wire_id| now if its lane has room, or
+  // queues it in lanes_ until it does. |pending| is registered only once
+  // the message goes out.
+  void SubmitRequest(McpPriority priority, std::string_view affinity_key, uint64_t wire_id,
+                     std::string_view message, bool stream, McpPendingRequest pending);
+  // Sends a request admitted to its lane to the least-loaded process.
+  void DispatchRequest(McpPriority priority, std::string_view affinity_key, uint64_t wire_id,
+                       std::string_view message, bool stream, McpPendingRequest pending);
+  // Returns the lane slot |pending| holds and sends whatever that admits.
+  void ReleaseLane(McpPendingRequest* pending);
+  void DispatchQueuedRequests();
+  // Returns the server slot |pending| holds, reporting how the request
+  // ended, and submits the requests that frees a slot for.
+  void ReleaseServerSlot(McpPendingRequest* pending, McpConcurrencyLimiter::Outcome outcome);
+
   // Utility methods
   std::string GetMcpScriptPath();
-  flutter::EncodableValue JsonStringToEncodableValue(const std::string& json_str);
-  std::string EncodableValueToJsonString(const flutter::EncodableValue& value);
+
+  // Fails the request with |wire_id| with TIMEOUT after |timeout_ms|, unless
+  // it completes first. Does nothing for a non-positive timeout. Platform
+  // thread only.
+  void ScheduleDeadline(uint64_t wire_id, int64_t timeout_ms);
+
+  // Drops the deadline of |wire_id|, if any, and stops the tick once none is
+  // left. Platform thread only.
+  void CancelDeadline(uint64_t wire_id);
+
+  // Supervision of the pool, on the platform thread. When a bridge exits,
+  // its non-idempotent requests and pings fail at once; idempotent ones,
+  // sent with "idempotent": true, wait. When its replacement starts, it is
+  // sent the initialize config again, and once that is answered the waiting
+  // requests are replayed and the process takes new requests.
+  void HandleBridgeExit(size_t process_index);
+  void HandleBridgeRestart(size_t process_index, uint32_t attempt);
+  void ReplayRequests(size_t process_index);
+
+  // Fails every request whose deadline has passed. Runs on the dispatcher's
+  // tick while deadlines are outstanding.
+  void ExpireRequests();
+
+  struct PingRound;
+
+  // Records the pong for ping |wire_id|, or its loss if |timed_out|, and
+  // completes the testConnection call once every ping of it is accounted
+  // for. Safe to call from any thread.
+  void CompletePing(uint64_t wire_id, bool timed_out);
+  void ReleasePingRound(const std::shared_ptr<PingRound>& round);
+  void FinishPingRound(PingRound* round);
+
+  // Sends a {"method": "$/cancelRequest", "params": {"id", "requestId"}}
+  // notification for the request with |wire_id|. Platform thread only.
+  void SendCancelNotification(size_t process_index, uint64_t wire_id,
+                              const std::string& request_id);
+
+  // Pool affinity for a request: its serverId, or empty for least-loaded
+  // dispatch. The view points into |request|.
+  static std::string_view GetAffinityKey(const flutter::EncodableMap& request);
+
+  // Serializes a {"method", "params", "requestId", "id"} message for the
+  // bridge into outbound_message_ and returns it. Platform thread only; the
+  // result is valid until the next call.
+  const std::string& BuildRequestMessage(const char* method,
+                                         const flutter::EncodableMap& params,
+                                         const std::string& request_id,
+                                         uint64_t wire_id);
+
+  // Like BuildRequestMessage for an initialize request with |config| to the
+  // process at |process_index|. When config.transport asks for
+  // length-prefixed framing and leaves sharedMemory on, the process gets its
+  // shared region first and the message names it in
+  // transport.sharedMemoryPath and transport.sharedMemoryBytes.
+  const std::string& BuildInitializeMessage(size_t process_index,
+                                            const flutter::EncodableMap& config,
+                                            const std::string& request_id, uint64_t wire_id);
+  static void AppendRequestMessage(const char* method, const flutter::EncodableMap& params,
+                                   const std::string& request_id, uint64_t wire_id,
+                                   std::string* out);
 
   // Members
-  std::unique_ptr<flutter::BinaryMessenger> binary_messenger_;
   std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> method_channel_;
   std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>> event_channel_;
-  std::unique_ptr<McpEventStreamHandler> stream_handler_;
-  std::unique_ptr<NodeJsProcess> node_process_;
+  // Owned by event_channel_.
+  McpEventStreamHandler* stream_handler_ = nullptr;
+  std::unique_ptr<NodeJsProcessPool> process_pool_;
   
-  // Pending requests management
-  std::map<std::string, std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>>> pending_requests_;
-  std::mutex pending_requests_mutex_;
+  // Pending requests management. Requests are keyed by a plugin-assigned wire
+  // id that the bridge echoes in every response, either in the JSON "id"
+  // member or in the header of a length-prefixed frame.
+  McpRequestRegistry pending_requests_;
+
+  // getCapabilities results by serverId, refetched after a
+  // capabilitiesChanged event.
+  McpCapabilityCache capabilities_;
+
+  // Responses of calls made with request.cache. Dropped for a server on its
+  // capabilitiesChanged event, and for a server or tool on a
+  // cacheInvalidated event {serverId, tool} from the bridge.
+  McpResultCache results_;
+
+  // Context blocks injected through injectContext, mirrored by every bridge.
+  McpContextStore contexts_;
+
+  // testConnection pings every process and answers once all of them have
+  // replied or timed out. Pings are keyed by wire id like requests, and
+  // share the request deadline wheel.
+  struct PingRound {
+    std::mutex mutex;
+    size_t remaining = 0;
+    // Round trip per process, or -1 if it did not answer.
+    std::vector<int64_t> round_trip_us;
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result;
+  };
+  struct PendingPing {
+    size_t process_index;
+    McpLatencyHistogram::Clock::time_point sent_at;
+    std::shared_ptr<PingRound> round;
+  };
+  std::mutex pings_mutex_;
+  std::unordered_map<uint64_t, PendingPing> pings_;
+  // Round trips to every process of the pool.
+  McpLatencyHistogram ping_latency_;
+
+  // Priority lanes between Dart and the pool. Platform thread only.
+  McpLaneScheduler lanes_;
+  bool dispatching_queued_ = false;
+
+  // Per-server limits ahead of the lanes, and the servers whose queues a
+  // released slot may have unblocked. Platform thread only.
+  McpConcurrencyLimiter server_limits_;
+  std::vector<std::string> servers_to_drain_;
+  bool draining_servers_ = false;
+
+  // Deadlines of pending requests, keyed by wire id, and the timeout for
+  // requests that do not set timeoutMs. Platform thread only.
+  McpTimerWheel request_deadlines_;
+  std::vector<uint64_t> expired_requests_;
+  bool deadlines_ticking_ = false;
+  int64_t default_timeout_ms_ = 0;
+
+  // Events from the bridge wait here for the platform thread, which takes
+  // them once per frame; see McpEventQueue for how streams are coalesced.
+  std::unique_ptr<McpPlatformDispatcher> dispatcher_;
+  McpEventQueue event_queue_;
+  std::vector<flutter::EncodableValue> delivered_events_;
+  // Frame intervals while the window is seen and while it is not; see
+  // SetWindowVisible.
+  std::chrono::milliseconds frame_interval_;
+  std::chrono::milliseconds background_frame_interval_;
+  bool throttle_background_processes_ = true;
+  bool window_visible_ = true;
   
   bool is_initialized_;
+  // The config of the initialize call, sent again to restarted bridges.
+  flutter::EncodableMap init_config_;
   std::string mcp_script_path_;
+
+  // Reused serialization buffer for outbound messages.
+  std::string outbound_message_;
 };
 
 #endif  // RUNNER_MCP_CHANNEL_PLUGIN_H_
\ No newline at end of file
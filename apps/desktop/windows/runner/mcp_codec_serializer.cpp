@@ -0,0 +1,41 @@
+#include "mcp_codec_serializer.h"
+
+#include <any>
+#include <memory>
+
+namespace {
+
+// Held by the CustomEncodableValue through a shared pointer, so copies of
+// the value do not copy the bytes.
+struct EncodedValue {
+  std::vector<uint8_t> bytes;
+};
+
+}  // namespace
+
+McpCodecSerializer::McpCodecSerializer() = default;
+
+// static
+const McpCodecSerializer& McpCodecSerializer::GetInstance() {
+  static McpCodecSerializer serializer;
+  return serializer;
+}
+
+// static
+flutter::EncodableValue McpCodecSerializer::WrapEncoded(std::vector<uint8_t> bytes) {
+  auto encoded = std::make_shared<const EncodedValue>(EncodedValue{std::move(bytes)});
+  return flutter::EncodableValue(flutter::CustomEncodableValue(std::any(std::move(encoded))));
+}
+
+void McpCodecSerializer::WriteValue(const flutter::EncodableValue& value,
+                                    flutter::ByteStreamWriter* stream) const {
+  if (const auto* custom = std::get_if<flutter::CustomEncodableValue>(&value)) {
+    const auto* encoded = std::any_cast<std::shared_ptr<const EncodedValue>>(
+        &static_cast<const std::any&>(*custom));
+    if (encoded) {
+      stream->WriteBytes((*encoded)->bytes.data(), (*encoded)->bytes.size());
+      return;
+    }
+  }
+  flutter::StandardCodecSerializer::WriteValue(value, stream);
+}
@@ -0,0 +1,44 @@
+#ifndef RUNNER_MCP_CODEC_SERIALIZER_H_
+#define RUNNER_MCP_CODEC_SERIALIZER_H_
+
+#include <flutter/byte_streams.h>
+#include <flutter/encodable_value.h>
+#include <flutter/standard_codec_serializer.h>
+
+#include <cstdint>
+#include <vector>
+
+// The standard serializer, plus pass-through of values that are already
+// encoded.
+//
+// A response bound for a Dart MethodResult can be transcoded from JSON to
+// the StandardMessageCodec encoding with TranscodeJsonToStandardCodec and
+// handed over as WrapEncoded bytes, which this serializer copies into the
+// reply as they are. The response then never exists as an EncodableValue
+// tree, whose nodes would all be allocated on the I/O thread only to be
+// freed right after encoding.
+class McpCodecSerializer : public flutter::StandardCodecSerializer {
+ public:
+  // Where a call's result starts in a success envelope, after its status
+  // byte. Encoded results must be made for this offset.
+  static constexpr size_t kResultOffset = 1;
+
+  static const McpCodecSerializer& GetInstance();
+
+  // Prevent copying.
+  McpCodecSerializer(McpCodecSerializer const&) = delete;
+  McpCodecSerializer& operator=(McpCodecSerializer const&) = delete;
+
+  // Wraps |bytes|, encoded for kResultOffset, as a value to pass to
+  // MethodResult::Success of a channel using this serializer. It is only
+  // valid as the whole result, never nested in another value.
+  static flutter::EncodableValue WrapEncoded(std::vector<uint8_t> bytes);
+
+  void WriteValue(const flutter::EncodableValue& value,
+                  flutter::ByteStreamWriter* stream) const override;
+
+ private:
+  McpCodecSerializer();
+};
+
+#endif  // RUNNER_MCP_CODEC_SERIALIZER_H_
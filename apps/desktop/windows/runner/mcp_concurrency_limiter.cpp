@@ -0,0 +1,133 @@
+#include "mcp_concurrency_limiter.h"
+
+#include <algorithm>
+
+McpConcurrencyLimiter::McpConcurrencyLimiter() = default;
+
+McpConcurrencyLimiter::~McpConcurrencyLimiter() = default;
+
+void McpConcurrencyLimiter::Configure(const Options& options) {
+  options_ = options;
+  options_.min_limit = std::max(options_.min_limit, 1.0);
+  options_.max_limit = std::max(options_.max_limit, options_.min_limit);
+  options_.initial_limit =
+      std::clamp(options_.initial_limit, options_.min_limit, options_.max_limit);
+}
+
+McpConcurrencyLimiter::Admission McpConcurrencyLimiter::Admit(const std::string& server_id) {
+  Server& server = GetServer(server_id);
+  if (server.queue.empty() && static_cast<double>(server.in_flight) < server.limit) {
+    ++server.in_flight;
+    return Admission::kAdmitted;
+  }
+  return server.queue.size() < options_.queue_limit ? Admission::kQueue : Admission::kRejected;
+}
+
+void McpConcurrencyLimiter::Enqueue(const std::string& server_id, McpQueuedRequest request) {
+  GetServer(server_id).queue.push_back(std::move(request));
+}
+
+void McpConcurrencyLimiter::Finish(const std::string& server_id,
+                                   std::chrono::microseconds latency, Outcome outcome) {
+  Server& server = GetServer(server_id);
+  if (server.in_flight > 0) {
+    --server.in_flight;
+  }
+
+  if (outcome == Outcome::kTimedOut) {
+    server.limit = std::max(server.limit * options_.backoff_ratio, options_.min_limit);
+    return;
+  }
+  if (outcome != Outcome::kCompleted) {
+    return;
+  }
+
+  if (server.samples == 0 || latency < server.no_load_latency) {
+    server.no_load_latency = latency;
+  }
+  if (++server.samples >= kLatencyWindow) {
+    server.samples = 0;
+  }
+  if (static_cast<double>(latency.count()) >
+      static_cast<double>(server.no_load_latency.count()) * options_.latency_tolerance) {
+    server.limit = std::max(server.limit * options_.backoff_ratio, options_.min_limit);
+  } else {
+    server.limit = std::min(server.limit + 1.0 / server.limit, options_.max_limit);
+  }
+}
+
+bool McpConcurrencyLimiter::Next(const std::string& server_id, McpQueuedRequest* request) {
+  auto it = servers_.find(server_id);
+  if (it == servers_.end()) {
+    return false;
+  }
+  Server& server = it->second;
+  if (server.queue.empty() || static_cast<double>(server.in_flight) >= server.limit) {
+    return false;
+  }
+  *request = std::move(server.queue.front());
+  server.queue.pop_front();
+  ++server.in_flight;
+  return true;
+}
+
+bool McpConcurrencyLimiter::TakeByWireId(uint64_t wire_id, McpQueuedRequest* request) {
+  for (auto& [server_id, server] : servers_) {
+    for (auto it = server.queue.begin(); it != server.queue.end(); ++it) {
+      if (it->wire_id == wire_id) {
+        *request = std::move(*it);
+        server.queue.erase(it);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool McpConcurrencyLimiter::TakeByRequestId(const std::string& request_id,
+                                            McpQueuedRequest* request) {
+  for (auto& [server_id, server] : servers_) {
+    for (auto it = server.queue.begin(); it != server.queue.end(); ++it) {
+      if (it->pending.request_id == request_id) {
+        *request = std::move(*it);
+        server.queue.erase(it);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::vector<McpQueuedRequest> McpConcurrencyLimiter::TakeAll() {
+  std::vector<McpQueuedRequest> requests;
+  for (auto& [server_id, server] : servers_) {
+    for (auto& request : server.queue) {
+      requests.push_back(std::move(request));
+    }
+    server.queue.clear();
+  }
+  return requests;
+}
+
+double McpConcurrencyLimiter::limit(const std::string& server_id) const {
+  auto it = servers_.find(server_id);
+  return it != servers_.end() ? it->second.limit : options_.initial_limit;
+}
+
+std::vector<McpConcurrencyLimiter::ServerStats> McpConcurrencyLimiter::GetStats() const {
+  std::vector<ServerStats> stats;
+  stats.reserve(servers_.size());
+  for (const auto& [server_id, server] : servers_) {
+    stats.push_back(ServerStats{server_id, server.limit, server.in_flight, server.queue.size(),
+                                static_cast<int64_t>(server.no_load_latency.count())});
+  }
+  return stats;
+}
+
+McpConcurrencyLimiter::Server& McpConcurrencyLimiter::GetServer(const std::string& server_id) {
+  auto [it, inserted] = servers_.try_emplace(server_id);
+  if (inserted) {
+    it->second.limit = options_.initial_limit;
+  }
+  return it->second;
+}
@@ -0,0 +1,109 @@
+#ifndef RUNNER_MCP_CONCURRENCY_LIMITER_H_
+#define RUNNER_MCP_CONCURRENCY_LIMITER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mcp_lane_scheduler.h"
+
+// Per-server limits on requests in flight, adapted to measured latency.
+//
+// Each server's limit follows AIMD: a response no slower than
+// latency_tolerance times the server's no-load latency raises the limit by
+// 1/limit, so about one per limit's worth of responses, and a slower
+// response or a timeout cuts it by backoff_ratio. The no-load latency is the
+// fastest response seen, re-measured every kLatencyWindow samples so the
+// baseline follows a server whose work got heavier. A request over the
+// limit waits in its server's queue up to queue_limit, then is refused.
+// Platform thread only.
+class McpConcurrencyLimiter {
+ public:
+  struct Options {
+    double initial_limit = 8;
+    double min_limit = 1;
+    double max_limit = 128;
+    double latency_tolerance = 2.0;
+    double backoff_ratio = 0.9;
+    // Requests that may wait per server; 0 refuses at once.
+    size_t queue_limit = 64;
+  };
+
+  // What became of a finished request, for the limit.
+  enum class Outcome {
+    // Completed; its latency is a sample.
+    kCompleted,
+    // Timed out, a sign of overload.
+    kTimedOut,
+    // Cancelled or lost with its bridge; says nothing about the server.
+    kDropped,
+  };
+
+  enum class Admission {
+    kAdmitted,
+    // Over the limit, but there is room in the queue; Enqueue it.
+    kQueue,
+    kRejected,
+  };
+
+  struct ServerStats {
+    std::string server_id;
+    double limit;
+    size_t in_flight;
+    size_t queued;
+    int64_t no_load_latency_us;
+  };
+
+  static constexpr uint32_t kLatencyWindow = 500;
+
+  McpConcurrencyLimiter();
+  ~McpConcurrencyLimiter();
+
+  // Prevent copying.
+  McpConcurrencyLimiter(McpConcurrencyLimiter const&) = delete;
+  McpConcurrencyLimiter& operator=(McpConcurrencyLimiter const&) = delete;
+
+  // Applies to servers seen from now on; existing ones keep their limits.
+  void Configure(const Options& options);
+
+  // Takes a slot of |server_id| if it is under its limit and nobody waits
+  // for it.
+  Admission Admit(const std::string& server_id);
+  void Enqueue(const std::string& server_id, McpQueuedRequest request);
+
+  // Returns the slot of a request of |server_id| that took |latency|.
+  void Finish(const std::string& server_id, std::chrono::microseconds latency,
+              Outcome outcome);
+
+  // Moves the next waiting request of |server_id| into |request| and takes
+  // a slot for it, if the server has room.
+  bool Next(const std::string& server_id, McpQueuedRequest* request);
+
+  // Removes a waiting request, for cancellation and deadlines.
+  bool TakeByWireId(uint64_t wire_id, McpQueuedRequest* request);
+  bool TakeByRequestId(const std::string& request_id, McpQueuedRequest* request);
+  std::vector<McpQueuedRequest> TakeAll();
+
+  double limit(const std::string& server_id) const;
+  std::vector<ServerStats> GetStats() const;
+
+ private:
+  struct Server {
+    double limit = 0;
+    size_t in_flight = 0;
+    std::chrono::microseconds no_load_latency{0};
+    // Samples since no_load_latency was last re-measured.
+    uint32_t samples = 0;
+    std::deque<McpQueuedRequest> queue;
+  };
+
+  Server& GetServer(const std::string& server_id);
+
+  Options options_;
+  std::unordered_map<std::string, Server> servers_;
+};
+
+#endif  // RUNNER_MCP_CONCURRENCY_LIMITER_H_
@@ -0,0 +1,80 @@
+#include "mcp_context_store.h"
+
+McpContextStore::McpContextStore() = default;
+
+McpContextStore::~McpContextStore() = default;
+
+int64_t McpContextStore::Set(const std::string& id, std::string content) {
+  Block& block = blocks_[id];
+  bytes_ = bytes_ - block.content.size() + content.size();
+  block.content = std::move(content);
+  block.version = next_version_++;
+  return block.version;
+}
+
+int64_t McpContextStore::Append(const std::string& id, std::string_view text,
+                                int64_t* base_version) {
+  Block& block = blocks_[id];
+  *base_version = block.version;
+  block.content.append(text);
+  bytes_ += text.size();
+  block.version = next_version_++;
+  return block.version;
+}
+
+bool McpContextStore::Splice(const std::string& id, int64_t base_version,
+                             const std::vector<McpContextEdit>& edits, int64_t* version,
+                             std::string* error) {
+  auto it = blocks_.find(id);
+  if (it == blocks_.end()) {
+    *error = "No context block " + id;
+    return false;
+  }
+  Block& block = it->second;
+  if (block.version != base_version) {
+    *error = "Context block " + id + " is at version " + std::to_string(block.version) +
+             ", not " + std::to_string(base_version);
+    return false;
+  }
+
+  // Check every edit against the length the earlier ones leave before
+  // touching the content, so a bad edit changes nothing.
+  uint64_t length = block.content.size();
+  for (const McpContextEdit& edit : edits) {
+    if (edit.offset > length || edit.remove > length - edit.offset) {
+      *error = "Edit at " + std::to_string(edit.offset) + " falls outside context block " + id;
+      return false;
+    }
+    length = length - edit.remove + edit.insert.size();
+  }
+
+  bytes_ -= block.content.size();
+  for (const McpContextEdit& edit : edits) {
+    block.content.replace(static_cast<size_t>(edit.offset), static_cast<size_t>(edit.remove),
+                          edit.insert);
+  }
+  bytes_ += block.content.size();
+  block.version = next_version_++;
+  *version = block.version;
+  return true;
+}
+
+bool McpContextStore::Remove(const std::string& id) {
+  auto it = blocks_.find(id);
+  if (it == blocks_.end()) {
+    return false;
+  }
+  bytes_ -= it->second.content.size();
+  blocks_.erase(it);
+  return true;
+}
+
+const McpContextStore::Block* McpContextStore::Find(const std::string& id) const {
+  auto it = blocks_.find(id);
+  return it != blocks_.end() ? &it->second : nullptr;
+}
+
+void McpContextStore::Clear() {
+  blocks_.clear();
+  bytes_ = 0;
+}
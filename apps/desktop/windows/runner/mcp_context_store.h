@@ -0,0 +1,75 @@
+#ifndef RUNNER_MCP_CONTEXT_STORE_H_
+#define RUNNER_MCP_CONTEXT_STORE_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// One replacement within a context block: |remove| bytes at |offset| give
+// way to |insert|. Offsets count UTF-8 bytes.
+struct McpContextEdit {
+  uint64_t offset = 0;
+  uint64_t remove = 0;
+  std::string insert;
+};
+
+// Named context blocks, the plugin's copy of what every bridge holds.
+//
+// Each change gives its block a new version; versions come from one counter,
+// so they never repeat, even for a block removed and created again. Callers
+// forward the change to the bridges as a delta against the version it
+// replaced, and resend whole blocks only to a bridge that lost them.
+// Platform thread only.
+class McpContextStore {
+ public:
+  struct Block {
+    int64_t version = 0;
+    std::string content;
+  };
+
+  McpContextStore();
+  ~McpContextStore();
+
+  // Prevent copying.
+  McpContextStore(McpContextStore const&) = delete;
+  McpContextStore& operator=(McpContextStore const&) = delete;
+
+  // Replaces block |id| with |content|, creating it if needed. Returns the
+  // new version.
+  int64_t Set(const std::string& id, std::string content);
+
+  // Appends |text| to block |id|, creating it if needed. |*base_version| is
+  // set to the version the append applies to, 0 for a new block. Returns
+  // the new version.
+  int64_t Append(const std::string& id, std::string_view text, int64_t* base_version);
+
+  // Applies |edits| in order to block |id|, each against the content the
+  // previous one left, provided the block is at |base_version|. Stores the
+  // new version in |version|. Returns false with |error| set, changing
+  // nothing, if the block is missing or at another version or an edit falls
+  // outside the content.
+  bool Splice(const std::string& id, int64_t base_version, const std::vector<McpContextEdit>& edits,
+              int64_t* version, std::string* error);
+
+  // Returns false if there was no block |id|.
+  bool Remove(const std::string& id);
+
+  // Returns block |id|, or nullptr.
+  const Block* Find(const std::string& id) const;
+
+  const std::unordered_map<std::string, Block>& blocks() const { return blocks_; }
+
+  void Clear();
+
+  // Total size of the block contents.
+  size_t bytes() const { return bytes_; }
+
+ private:
+  std::unordered_map<std::string, Block> blocks_;
+  size_t bytes_ = 0;
+  int64_t next_version_ = 1;
+};
+
+#endif  // RUNNER_MCP_CONTEXT_STORE_H_
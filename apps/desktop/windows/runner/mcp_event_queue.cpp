@@ -0,0 +1,161 @@
+#include "mcp_event_queue.h"
+
+#include <iterator>
+
+namespace {
+
+const std::string* GetString(const flutter::EncodableMap& map, const char* key) {
+  auto it = map.find(flutter::EncodableValue(key));
+  return it != map.end() ? std::get_if<std::string>(&it->second) : nullptr;
+}
+
+// Returns the data map of an event message, or nullptr.
+flutter::EncodableMap* GetEventData(flutter::EncodableValue& event) {
+  auto* fields = std::get_if<flutter::EncodableMap>(&event);
+  if (!fields) {
+    return nullptr;
+  }
+  auto it = fields->find(flutter::EncodableValue("data"));
+  return it != fields->end() ? std::get_if<flutter::EncodableMap>(&it->second) : nullptr;
+}
+
+// Returns the token text of a stream_token event, or nullptr for any other
+// event.
+std::string* GetStreamToken(flutter::EncodableValue& event) {
+  const auto* fields = std::get_if<flutter::EncodableMap>(&event);
+  const std::string* name = fields ? GetString(*fields, "event") : nullptr;
+  if (!name || *name != "stream_token") {
+    return nullptr;
+  }
+  flutter::EncodableMap* data = GetEventData(event);
+  if (!data) {
+    return nullptr;
+  }
+  auto it = data->find(flutter::EncodableValue("token"));
+  return it != data->end() ? std::get_if<std::string>(&it->second) : nullptr;
+}
+
+}  // namespace
+
+McpEventQueue::McpEventQueue() : drain_thread_(std::this_thread::get_id()) {}
+
+McpEventQueue::~McpEventQueue() {
+  Clear();
+}
+
+void McpEventQueue::Configure(size_t capacity, McpEventOverflowPolicy policy) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+  policy_ = policy;
+  drained_.notify_all();
+}
+
+void McpEventQueue::SetFullCallback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  full_callback_ = std::move(callback);
+}
+
+bool McpEventQueue::Push(flutter::EncodableValue event, McpEventPriority priority) {
+  const std::string* token = GetStreamToken(event);
+  flutter::EncodableMap* data = GetEventData(event);
+  const std::string* request_id_field = data ? GetString(*data, "requestId") : nullptr;
+  std::string request_id = request_id_field ? *request_id_field : std::string();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!request_id.empty()) {
+    if (token) {
+      auto open = open_tokens_.find(request_id);
+      if (open != open_tokens_.end()) {
+        flutter::EncodableValue* queued = Find(open->second);
+        std::string* queued_token = queued ? GetStreamToken(*queued) : nullptr;
+        if (queued_token) {
+          queued_token->append(*token);
+          return true;
+        }
+      }
+    } else {
+      // Later tokens must not overtake this event.
+      open_tokens_.erase(request_id);
+    }
+  }
+
+  bool lossless = priority == McpEventPriority::kLossless;
+  if (priority != McpEventPriority::kControl && events_.size() >= Limit()) {
+    if (!lossless && (policy_ == McpEventOverflowPolicy::kDrop || closed_)) {
+      ++dropped_;
+      return false;
+    }
+    if (std::this_thread::get_id() != drain_thread_ && !closed_) {
+      if (full_callback_ && !full_signaled_) {
+        full_signaled_ = true;
+        std::function<void()> callback = full_callback_;
+        lock.unlock();
+        callback();
+        lock.lock();
+      }
+      drained_.wait(lock, [this, lossless] {
+        return events_.size() < Limit() || closed_ ||
+               (!lossless && policy_ == McpEventOverflowPolicy::kDrop);
+      });
+      if (!lossless && events_.size() >= Limit()) {
+        ++dropped_;
+        return false;
+      }
+    }
+  }
+
+  uint64_t sequence = front_sequence_ + events_.size();
+  events_.push_back(std::move(event));
+  if (token && !request_id.empty()) {
+    open_tokens_[request_id] = sequence;
+  }
+  return true;
+}
+
+void McpEventQueue::Drain(std::vector<flutter::EncodableValue>* events) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  events->insert(events->end(), std::make_move_iterator(events_.begin()),
+                 std::make_move_iterator(events_.end()));
+  front_sequence_ += events_.size();
+  events_.clear();
+  open_tokens_.clear();
+  full_signaled_ = false;
+  drained_.notify_all();
+}
+
+void McpEventQueue::Clear() {
+  std::vector<flutter::EncodableValue> discarded;
+  Drain(&discarded);
+}
+
+void McpEventQueue::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  drained_.notify_all();
+}
+
+void McpEventQueue::Reopen() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = false;
+}
+
+uint64_t McpEventQueue::dropped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+size_t McpEventQueue::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return events_.size();
+}
+
+size_t McpEventQueue::Limit() const {
+  return policy_ == McpEventOverflowPolicy::kMerge ? capacity_ * kMergeHeadroom : capacity_;
+}
+
+flutter::EncodableValue* McpEventQueue::Find(uint64_t sequence) {
+  if (sequence < front_sequence_ || sequence - front_sequence_ >= events_.size()) {
+    return nullptr;
+  }
+  return &events_[static_cast<size_t>(sequence - front_sequence_)];
+}
@@ -0,0 +1,118 @@
+#ifndef RUNNER_MCP_EVENT_QUEUE_H_
+#define RUNNER_MCP_EVENT_QUEUE_H_
+
+#include <flutter/encodable_value.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// What McpEventQueue does with a bridge event that arrives while it is full
+// and cannot be merged into a queued one.
+enum class McpEventOverflowPolicy {
+  // Discard the event.
+  kDrop,
+  // Keep it until kMergeHeadroom times the capacity is queued, then wait as
+  // kBlock does. Absorbs a burst without stalling the pipe.
+  kMerge,
+  // Wait until the platform thread drains the queue. Stalls the pipe the
+  // event came from, which pushes back on the bridge.
+  kBlock,
+};
+
+// Who an event is for, and so whether the overflow policy applies to it.
+enum class McpEventPriority {
+  // Events from the bridge, passed through to Dart: subject to the policy.
+  kNormal,
+  // Slices of a chunked response, which Dart must get every one of. Wait
+  // for room as kBlock does whatever the policy, so the stalled pipe paces
+  // the bridge, and are never dropped; while closed they are queued at once.
+  kLossless,
+  // Events the plugin itself sends to finish a request or report a bridge
+  // restart, which Dart cannot do without. Always queued; there is at most
+  // one or two per request or restart, so they need no bound of their own.
+  kControl,
+};
+
+// Bounded queue of event channel messages between the bridge's I/O threads
+// and the platform thread.
+//
+// Events are the decoded {"type": "event", "event", "data"} messages. A
+// stream_token event is merged into the queued token of the same requestId
+// when no other event of that request was queued after it, so a burst of
+// tokens reaches Dart as one delta per drain instead of one message each.
+class McpEventQueue {
+ public:
+  static constexpr size_t kDefaultCapacity = 1024;
+  static constexpr size_t kMergeHeadroom = 4;
+
+  McpEventQueue();
+  ~McpEventQueue();
+
+  // Prevent copying.
+  McpEventQueue(McpEventQueue const&) = delete;
+  McpEventQueue& operator=(McpEventQueue const&) = delete;
+
+  void Configure(size_t capacity, McpEventOverflowPolicy policy);
+
+  // Called, outside the lock, when a kBlock push finds the queue full and is
+  // about to wait; once until the next drain. Lets the owner drain now
+  // instead of at its next frame, which may be a long way off.
+  void SetFullCallback(std::function<void()> callback);
+
+  // Queues |event|. Returns false if it was dropped. A push never waits on
+  // the thread that created the queue, since that thread drains it.
+  bool Push(flutter::EncodableValue event,
+            McpEventPriority priority = McpEventPriority::kNormal);
+
+  // Moves every queued event, oldest first, to the end of |events|.
+  void Drain(std::vector<flutter::EncodableValue>* events);
+
+  // Discards queued events and releases blocked pushers.
+  void Clear();
+
+  // Releases blocked pushers, and until Reopen drops bridge events that
+  // would wait. For stopping the bridges: their I/O threads may be
+  // blocked here while the thread that would drain the queue waits for them.
+  void Close();
+  void Reopen();
+
+  // Bridge events dropped so far, by kDrop or while closed.
+  uint64_t dropped() const;
+
+  // Events waiting for the next drain.
+  size_t size() const;
+
+ private:
+  // Number of queued events at which a bridge event no longer fits under
+  // the current policy. Called with mutex_ held.
+  size_t Limit() const;
+
+  // Returns the queued event |sequence| refers to, or nullptr once drained.
+  flutter::EncodableValue* Find(uint64_t sequence);
+
+  mutable std::mutex mutex_;
+  std::condition_variable drained_;
+  std::deque<flutter::EncodableValue> events_;
+  // Sequence number of events_.front(); sequence numbers never repeat.
+  uint64_t front_sequence_ = 0;
+  // Queued stream_token event that later tokens of each requestId merge into.
+  std::unordered_map<std::string, uint64_t> open_tokens_;
+
+  size_t capacity_ = kDefaultCapacity;
+  McpEventOverflowPolicy policy_ = McpEventOverflowPolicy::kMerge;
+  uint64_t dropped_ = 0;
+  bool closed_ = false;
+  std::function<void()> full_callback_;
+  // Whether full_callback_ ran since the last drain.
+  bool full_signaled_ = false;
+  std::thread::id drain_thread_;
+};
+
+#endif  // RUNNER_MCP_EVENT_QUEUE_H_
@@ -0,0 +1,137 @@
+#include "mcp_framing.h"
+
+#include <cstring>
+
+namespace {
+
+// A buffer that grew this far past its initial size for one large message is
+// released again once it drains, so a single big tool result does not pin
+// memory for the rest of the session.
+constexpr size_t kShrinkFactor = 16;
+
+uint32_t ReadUint32(const char* data) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+  return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+         (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+uint64_t ReadUint64(const char* data) {
+  return static_cast<uint64_t>(ReadUint32(data)) |
+         (static_cast<uint64_t>(ReadUint32(data + 4)) << 32);
+}
+
+void WriteLittleEndian(uint64_t value, size_t size, char* out) {
+  for (size_t i = 0; i < size; ++i) {
+    out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+}  // namespace
+
+void AppendMcpFrame(McpFrameType type, uint64_t request_id, std::string_view payload,
+                    std::string* out) {
+  char header[kMcpFrameHeaderSize] = {};
+  header[0] = static_cast<char>(kMcpFrameMagic);
+  header[1] = static_cast<char>(type);
+  WriteLittleEndian(payload.size(), 4, header + 4);
+  WriteLittleEndian(request_id, 8, header + 8);
+  out->reserve(out->size() + sizeof(header) + payload.size());
+  out->append(header, sizeof(header));
+  out->append(payload.data(), payload.size());
+}
+
+McpMessageFramer::McpMessageFramer(size_t initial_capacity)
+    : buffer_(std::make_unique<char[]>(initial_capacity)),
+      capacity_(initial_capacity),
+      initial_capacity_(initial_capacity) {}
+
+McpMessageFramer::~McpMessageFramer() {}
+
+char* McpMessageFramer::PrepareWrite(size_t min_size, size_t* available) {
+  size_t pending = end_ - start_;
+  if (partial_frame_size_ > pending && partial_frame_size_ - pending > min_size) {
+    min_size = partial_frame_size_ - pending;
+  }
+  if (capacity_ - end_ < min_size) {
+    size_t needed = pending + min_size;
+    size_t capacity = capacity_;
+    while (capacity < needed) {
+      capacity *= 2;
+    }
+    Rebase(capacity);
+  }
+  *available = capacity_ - end_;
+  return buffer_.get() + end_;
+}
+
+void McpMessageFramer::Commit(size_t size, const MessageHandler& handler) {
+  end_ += size;
+  partial_frame_size_ = 0;
+
+  const char* data = buffer_.get();
+  while (start_ < end_) {
+    if (static_cast<uint8_t>(data[start_]) == kMcpFrameMagic) {
+      if (end_ - start_ < kMcpFrameHeaderSize) {
+        partial_frame_size_ = kMcpFrameHeaderSize;
+        break;
+      }
+      const char* header = data + start_;
+      uint32_t length = ReadUint32(header + 4);
+      if (length <= kMcpMaxFramePayload) {
+        size_t frame_size = kMcpFrameHeaderSize + length;
+        if (end_ - start_ < frame_size) {
+          partial_frame_size_ = frame_size;
+          break;
+        }
+        McpFrame frame{static_cast<McpFrameType>(header[1]), ReadUint64(header + 8),
+                       std::string_view(header + kMcpFrameHeaderSize, length)};
+        handler(frame);
+        start_ += frame_size;
+        scan_ = start_;
+        continue;
+      }
+      // An impossible length means the stream is corrupt. Fall through and
+      // discard bytes up to the next newline to resynchronize.
+    }
+
+    const void* found = memchr(data + scan_, '\n', end_ - scan_);
+    if (!found) {
+      scan_ = end_;
+      break;
+    }
+    size_t newline = static_cast<const char*>(found) - data;
+    size_t length = newline - start_;
+    if (length > 0 && data[newline - 1] == '\r') {
+      --length;
+    }
+    if (length > 0 && static_cast<uint8_t>(data[start_]) != kMcpFrameMagic) {
+      handler(McpFrame{McpFrameType::kJson, 0, std::string_view(data + start_, length)});
+    }
+    start_ = newline + 1;
+    scan_ = start_;
+  }
+
+  if (start_ == end_) {
+    // Everything was consumed; rewind without moving any bytes.
+    start_ = scan_ = end_ = 0;
+    if (capacity_ > initial_capacity_ * kShrinkFactor) {
+      Rebase(initial_capacity_);
+    }
+  }
+}
+
+void McpMessageFramer::Rebase(size_t capacity) {
+  size_t pending = end_ - start_;
+  size_t scanned = scan_ - start_;
+  if (capacity != capacity_) {
+    auto buffer = std::make_unique<char[]>(capacity);
+    memcpy(buffer.get(), buffer_.get() + start_, pending);
+    buffer_ = std::move(buffer);
+    capacity_ = capacity;
+  } else if (start_ > 0) {
+    memmove(buffer_.get(), buffer_.get() + start_, pending);
+  }
+  start_ = 0;
+  scan_ = scanned;
+  end_ = pending;
+}
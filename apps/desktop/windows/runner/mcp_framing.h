@@ -0,0 +1,118 @@
+#ifndef RUNNER_MCP_FRAMING_H_
+#define RUNNER_MCP_FRAMING_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Wire framing between the plugin and mcp_bridge.js.
+//
+// The default framing is one JSON message per line. Once both sides agree on
+// "length-prefixed" framing in the initialize exchange, messages may instead
+// be sent as a fixed 16-byte little-endian header followed by the payload:
+//
+//   offset 0   uint8   kMcpFrameMagic
+//   offset 1   uint8   McpFrameType
+//   offset 2   uint16  flags (reserved, zero)
+//   offset 4   uint32  payload length in bytes
+//   offset 8   uint64  request id the payload belongs to, or 0
+//
+// The magic byte can never start a UTF-8 JSON text, so readers tell the two
+// framings apart per message and a switch never races with data in flight.
+//
+// A payload too large to be worth pushing through the pipe can instead be
+// written to the bridge's shared region (see McpSharedMemory) and announced
+// by a kShared frame whose payload is a kMcpSharedDescriptorSize descriptor:
+//
+//   offset 0   uint8   McpFrameType of the payload, kJson or kBinary
+//   offset 1   uint8[7] reserved, zero
+//   offset 8   uint64  offset of the payload in the region
+//   offset 16  uint64  payload length in bytes
+constexpr uint8_t kMcpFrameMagic = 0xFB;
+constexpr size_t kMcpFrameHeaderSize = 16;
+constexpr uint32_t kMcpMaxFramePayload = 256 * 1024 * 1024;
+constexpr size_t kMcpSharedDescriptorSize = 24;
+
+enum class McpFrameType : uint8_t {
+  // The payload is a JSON message, exactly as it would appear on a line.
+  kJson = 1,
+  // The payload is the raw binary result of request |request_id|.
+  kBinary = 2,
+  // The payload is a descriptor of a message in the shared region.
+  kShared = 3,
+};
+
+enum class McpFraming {
+  kNewlineDelimited,
+  kLengthPrefixed,
+};
+
+// One message from the bridge. |payload| points into the framer's buffer.
+struct McpFrame {
+  McpFrameType type;
+  uint64_t request_id;
+  std::string_view payload;
+};
+
+// Appends a length-prefixed frame carrying |payload| to |out|.
+void AppendMcpFrame(McpFrameType type, uint64_t request_id, std::string_view payload,
+                    std::string* out);
+
+// Splits the byte stream from the MCP bridge into messages, accepting both
+// newline-delimited JSON and length-prefixed frames.
+//
+// Reads land directly in the framer's buffer (see PrepareWrite), and complete
+// messages are handed out as views into that buffer, so a message is never
+// copied on its way to the handler. Consumed bytes are reclaimed by moving the
+// trailing partial message to the front at most once per read, which keeps
+// framing linear no matter how many messages one read contains.
+class McpMessageFramer {
+ public:
+  using MessageHandler = std::function<void(const McpFrame& frame)>;
+
+  static constexpr size_t kDefaultCapacity = 64 * 1024;
+
+  explicit McpMessageFramer(size_t initial_capacity = kDefaultCapacity);
+  ~McpMessageFramer();
+
+  // Prevent copying.
+  McpMessageFramer(McpMessageFramer const&) = delete;
+  McpMessageFramer& operator=(McpMessageFramer const&) = delete;
+
+  // Returns the free tail of the buffer, making room for at least |min_size|
+  // bytes first, or for the rest of a partially received frame if that is
+  // larger. The buffer doubles when a single message outgrows it. The number
+  // of writable bytes is stored in |available|.
+  char* PrepareWrite(size_t min_size, size_t* available);
+
+  // Commits |size| bytes written into the region returned by PrepareWrite and
+  // calls |handler| for every complete message. Empty lines are skipped and a
+  // trailing '\r' is stripped; lines are reported as McpFrameType::kJson with
+  // request id 0. Views are only valid for the duration of the call.
+  void Commit(size_t size, const MessageHandler& handler);
+
+  // Number of buffered bytes that do not yet form a complete message.
+  size_t pending_bytes() const { return end_ - start_; }
+
+ private:
+  // Moves the unconsumed bytes to the front of a buffer of |capacity| bytes,
+  // reallocating if the capacity changes.
+  void Rebase(size_t capacity);
+
+  std::unique_ptr<char[]> buffer_;
+  size_t capacity_;
+  size_t initial_capacity_;
+
+  // [start_, end_) is unconsumed data; [start_, scan_) is known to contain no
+  // newline, so each byte is searched exactly once.
+  size_t start_ = 0;
+  size_t scan_ = 0;
+  size_t end_ = 0;
+
+  // Total size of the frame at start_ when only part of it has arrived.
+  size_t partial_frame_size_ = 0;
+};
+
+#endif  // RUNNER_MCP_FRAMING_H_
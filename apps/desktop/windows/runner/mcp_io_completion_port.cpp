@@ -0,0 +1,52 @@
+#include "mcp_io_completion_port.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+// Completions for a single pipe are already serialized because only one read
+// or write is outstanding on it at a time, so a few workers are enough to
+// keep several bridge processes busy.
+constexpr unsigned int kMaxWorkerThreads = 4;
+
+}  // namespace
+
+McpIoCompletionPort& McpIoCompletionPort::GetInstance() {
+  static McpIoCompletionPort* instance = new McpIoCompletionPort();
+  return *instance;
+}
+
+McpIoCompletionPort::McpIoCompletionPort()
+    : port_(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0)) {
+  if (!port_) {
+    std::cerr << "Failed to create MCP I/O completion port: " << GetLastError() << std::endl;
+    return;
+  }
+  unsigned int workers =
+      std::clamp(std::thread::hardware_concurrency(), 1u, kMaxWorkerThreads);
+  for (unsigned int i = 0; i < workers; ++i) {
+    std::thread(&McpIoCompletionPort::WorkerThread, this).detach();
+  }
+}
+
+bool McpIoCompletionPort::Associate(HANDLE handle) {
+  return port_ && CreateIoCompletionPort(handle, port_, 0, 0) == port_;
+}
+
+void McpIoCompletionPort::WorkerThread() {
+  while (true) {
+    DWORD bytes = 0;
+    ULONG_PTR key = 0;
+    OVERLAPPED* overlapped = nullptr;
+    BOOL ok = GetQueuedCompletionStatus(port_, &bytes, &key, &overlapped, INFINITE);
+    if (!overlapped) {
+      // Without an OVERLAPPED the port itself failed.
+      break;
+    }
+    DWORD error = ok ? ERROR_SUCCESS : GetLastError();
+    auto* operation = CONTAINING_RECORD(overlapped, McpIoOperation, overlapped);
+    operation->on_complete(bytes, error);
+  }
+}
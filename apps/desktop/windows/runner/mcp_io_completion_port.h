@@ -0,0 +1,49 @@
+#ifndef RUNNER_MCP_IO_COMPLETION_PORT_H_
+#define RUNNER_MCP_IO_COMPLETION_PORT_H_
+
+#include <windows.h>
+
+#include <functional>
+
+// One overlapped I/O operation. The operation must stay alive, and must not be
+// reissued, until its completion has been delivered.
+struct McpIoOperation {
+  OVERLAPPED overlapped;
+
+  // Runs on a port worker thread with the number of bytes transferred and
+  // the Win32 error code, ERROR_SUCCESS if the operation succeeded.
+  std::function<void(DWORD bytes, DWORD error)> on_complete;
+
+  // Clears |overlapped| ahead of issuing the operation again.
+  void Reset() { ZeroMemory(&overlapped, sizeof(overlapped)); }
+};
+
+// The I/O completion port shared by every bridge process. Pipe handles opened
+// with FILE_FLAG_OVERLAPPED are associated with it, and a small fixed set of
+// worker threads dispatches their completions, so no thread ever blocks in
+// ReadFile or WriteFile on one particular pipe.
+class McpIoCompletionPort {
+ public:
+  // Returns the process-wide port, starting its workers on first use. The
+  // port is never destroyed so it outlives processes stopped during static
+  // destruction.
+  static McpIoCompletionPort& GetInstance();
+
+  // Prevent copying.
+  McpIoCompletionPort(McpIoCompletionPort const&) = delete;
+  McpIoCompletionPort& operator=(McpIoCompletionPort const&) = delete;
+
+  // Associates |handle|, which must have been opened for overlapped I/O, with
+  // the port. Completions for operations issued on it are delivered to the
+  // operation's on_complete callback.
+  bool Associate(HANDLE handle);
+
+ private:
+  McpIoCompletionPort();
+
+  void WorkerThread();
+
+  HANDLE port_;
+};
+
+#endif  // RUNNER_MCP_IO_COMPLETION_PORT_H_
@@ -0,0 +1,936 @@
+#include "mcp_json.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr size_t kMaxDecodeDepth = 512;
+
+// Type tags of the StandardMessageCodec encoding.
+constexpr uint8_t kCodecNull = 0;
+constexpr uint8_t kCodecTrue = 1;
+constexpr uint8_t kCodecFalse = 2;
+constexpr uint8_t kCodecInt32 = 3;
+constexpr uint8_t kCodecInt64 = 4;
+constexpr uint8_t kCodecFloat64 = 6;
+constexpr uint8_t kCodecString = 7;
+constexpr uint8_t kCodecList = 12;
+constexpr uint8_t kCodecMap = 13;
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Matches the JSON number grammar, -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?,
+// at |pos| of |text|. Returns the end of the number, or npos if there is none;
+// |integral| tells whether it has neither fraction nor exponent.
+size_t ScanJsonNumber(std::string_view text, size_t pos, bool* integral) {
+  if (pos < text.size() && text[pos] == '-') {
+    ++pos;
+  }
+  if (pos >= text.size() || !IsDigit(text[pos])) {
+    return std::string_view::npos;
+  }
+  if (text[pos++] != '0') {
+    while (pos < text.size() && IsDigit(text[pos])) {
+      ++pos;
+    }
+  }
+  *integral = true;
+  if (pos < text.size() && text[pos] == '.') {
+    if (++pos >= text.size() || !IsDigit(text[pos])) {
+      return std::string_view::npos;
+    }
+    while (pos < text.size() && IsDigit(text[pos])) {
+      ++pos;
+    }
+    *integral = false;
+  }
+  if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+    if (++pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+      ++pos;
+    }
+    if (pos >= text.size() || !IsDigit(text[pos])) {
+      return std::string_view::npos;
+    }
+    while (pos < text.size() && IsDigit(text[pos])) {
+      ++pos;
+    }
+    *integral = false;
+  }
+  return pos;
+}
+
+// Tells whether a valid JSON |number| that does not fit a double is too large
+// rather than too small, from the power of ten of its first significant digit.
+bool JsonNumberOverflows(std::string_view number) {
+  size_t pos = number[0] == '-' ? 1 : 0;
+  int64_t magnitude = 0;
+  bool significant = false;
+  for (; pos < number.size() && IsDigit(number[pos]); ++pos) {
+    significant = significant || number[pos] != '0';
+    if (significant) {
+      ++magnitude;
+    }
+  }
+  if (pos < number.size() && number[pos] == '.') {
+    for (++pos; pos < number.size() && IsDigit(number[pos]); ++pos) {
+      if (significant) {
+        continue;
+      }
+      --magnitude;
+      significant = number[pos] != '0';
+    }
+  }
+  if (pos < number.size()) {
+    // Exponent; saturated well past the range of a double.
+    ++pos;
+    bool negative = number[pos] == '-';
+    if (number[pos] == '-' || number[pos] == '+') {
+      ++pos;
+    }
+    int64_t exponent = 0;
+    for (; pos < number.size(); ++pos) {
+      exponent = std::min<int64_t>(exponent * 10 + (number[pos] - '0'), 100000);
+    }
+    magnitude += negative ? -exponent : exponent;
+  }
+  return magnitude > 0;
+}
+
+// Output of TranscodeJsonToStandardCodec. The codec prefixes each container
+// with its element count, which JSON only reveals at the closing bracket, so
+// the document is walked twice: the counting pass only records every
+// container's count, in the order the containers open, and the writing pass
+// emits the bytes using them.
+class StandardCodecWriter {
+ public:
+  StandardCodecWriter(size_t base_offset, std::vector<uint8_t>* out)
+      : base_offset_(base_offset), out_(out) {}
+
+  // Switches from counting to writing, with room for about |size_hint|
+  // bytes.
+  void StartWriting(size_t size_hint) {
+    counting_ = false;
+    next_count_ = 0;
+    out_->clear();
+    out_->reserve(size_hint);
+  }
+
+  // Opens a list or map and returns the index its elements are counted
+  // under.
+  size_t BeginContainer(uint8_t type) {
+    if (counting_) {
+      counts_.push_back(0);
+      return counts_.size() - 1;
+    }
+    WriteByte(type);
+    WriteSize(counts_[next_count_]);
+    return next_count_++;
+  }
+
+  // Counts an element, or a key and value pair, of container |index|.
+  void AddElement(size_t index) {
+    if (counting_) {
+      ++counts_[index];
+    }
+  }
+
+  void WriteByte(uint8_t byte) {
+    if (!counting_) {
+      out_->push_back(byte);
+    }
+  }
+
+  void WriteString(std::string_view text) {
+    WriteByte(kCodecString);
+    WriteSize(text.size());
+    if (!counting_) {
+      out_->insert(out_->end(), text.begin(), text.end());
+    }
+  }
+
+  // Writes an int32_t, int64_t or double, the kinds ReadNumber produces.
+  void WriteNumber(const flutter::EncodableValue& number) {
+    if (counting_) {
+      return;
+    }
+    if (const auto* value = std::get_if<int32_t>(&number)) {
+      out_->push_back(kCodecInt32);
+      WriteLittleEndian(static_cast<uint32_t>(*value), 4);
+    } else if (const auto* value = std::get_if<int64_t>(&number)) {
+      out_->push_back(kCodecInt64);
+      WriteLittleEndian(static_cast<uint64_t>(*value), 8);
+    } else {
+      // Doubles are aligned to 8 bytes from the start of the whole message.
+      out_->push_back(kCodecFloat64);
+      while ((base_offset_ + out_->size()) % 8 != 0) {
+        out_->push_back(0);
+      }
+      uint64_t bits;
+      double real = std::get<double>(number);
+      std::memcpy(&bits, &real, sizeof(bits));
+      WriteLittleEndian(bits, 8);
+    }
+  }
+
+ private:
+  void WriteSize(size_t size) {
+    if (counting_) {
+      return;
+    }
+    if (size < 254) {
+      out_->push_back(static_cast<uint8_t>(size));
+    } else if (size <= 0xFFFF) {
+      out_->push_back(254);
+      WriteLittleEndian(size, 2);
+    } else {
+      out_->push_back(255);
+      WriteLittleEndian(size, 4);
+    }
+  }
+
+  void WriteLittleEndian(uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+      out_->push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  size_t base_offset_;
+  std::vector<uint8_t>* out_;
+  bool counting_ = true;
+  std::vector<size_t> counts_;
+  size_t next_count_ = 0;
+};
+
+// Cursor over a JSON document. Each Read/Skip method expects the cursor to be
+// on the first character of the element, leaves it just past the element, and
+// returns false on malformed input.
+class JsonReader {
+ public:
+  explicit JsonReader(std::string_view json) : json_(json), pos_(0) {}
+
+  void SkipWhitespace() {
+    while (pos_ < json_.size()) {
+      char c = json_[pos_];
+      if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+        break;
+      }
+      ++pos_;
+    }
+  }
+
+  // Returns the next significant character without consuming it, or '\0' at
+  // the end of input.
+  char Peek() {
+    SkipWhitespace();
+    return pos_ < json_.size() ? json_[pos_] : '\0';
+  }
+
+  // Consumes |c| if it is the next significant character.
+  bool Consume(char c) {
+    if (Peek() != c) {
+      return false;
+    }
+    ++pos_;
+    return true;
+  }
+
+  bool AtEnd() {
+    SkipWhitespace();
+    return pos_ == json_.size();
+  }
+
+  // Reads a string and appends its unescaped UTF-8 contents to |out|.
+  bool ReadString(std::string* out) {
+    size_t end;
+    if (!FindStringEnd(&end)) {
+      return false;
+    }
+    std::string_view body = json_.substr(pos_ + 1, end - pos_ - 1);
+    pos_ = end + 1;
+    if (body.find('\\') == std::string_view::npos) {
+      out->append(body.data(), body.size());
+      return true;
+    }
+    return Unescape(body, out);
+  }
+
+  // Decodes any value into |value|. |depth| is the nesting level of the
+  // value's container and guards the recursion.
+  bool ReadValue(flutter::EncodableValue* value, size_t depth) {
+    switch (Peek()) {
+      case '"': {
+        std::string text;
+        if (!ReadString(&text)) {
+          return false;
+        }
+        *value = flutter::EncodableValue(std::move(text));
+        return true;
+      }
+      case '{':
+        return depth < kMaxDecodeDepth && ReadObject(value, depth + 1);
+      case '[':
+        return depth < kMaxDecodeDepth && ReadArray(value, depth + 1);
+      case 't':
+        *value = flutter::EncodableValue(true);
+        return SkipLiteral("true");
+      case 'f':
+        *value = flutter::EncodableValue(false);
+        return SkipLiteral("false");
+      case 'n':
+        *value = flutter::EncodableValue();
+        return SkipLiteral("null");
+      default:
+        return ReadNumber(value);
+    }
+  }
+
+  // Writes any value to |writer| in the StandardMessageCodec encoding, with
+  // the same types and the same failures as ReadValue.
+  bool TranscodeValue(StandardCodecWriter* writer, size_t depth) {
+    switch (Peek()) {
+      case '"': {
+        std::string_view text;
+        if (!ReadStringView(&text)) {
+          return false;
+        }
+        writer->WriteString(text);
+        return true;
+      }
+      case '{':
+        return depth < kMaxDecodeDepth && TranscodeObject(writer, depth + 1);
+      case '[':
+        return depth < kMaxDecodeDepth && TranscodeArray(writer, depth + 1);
+      case 't':
+        writer->WriteByte(kCodecTrue);
+        return SkipLiteral("true");
+      case 'f':
+        writer->WriteByte(kCodecFalse);
+        return SkipLiteral("false");
+      case 'n':
+        writer->WriteByte(kCodecNull);
+        return SkipLiteral("null");
+      default: {
+        flutter::EncodableValue number;
+        if (!ReadNumber(&number)) {
+          return false;
+        }
+        writer->WriteNumber(number);
+        return true;
+      }
+    }
+  }
+
+  // Skips any value. If |raw| is non-null it receives the value's JSON text.
+  bool SkipValue(std::string_view* raw) {
+    SkipWhitespace();
+    size_t start = pos_;
+    if (pos_ >= json_.size()) {
+      return false;
+    }
+    char c = json_[pos_];
+    bool ok = c == '{' || c == '[' ? SkipContainer() : SkipScalar();
+    if (ok && raw) {
+      *raw = json_.substr(start, pos_ - start);
+    }
+    return ok;
+  }
+
+ private:
+  // Like ReadString, but points |text| into the document unless the string
+  // has escapes, in which case it views the unescaped copy in scratch_.
+  bool ReadStringView(std::string_view* text) {
+    size_t end;
+    if (!FindStringEnd(&end)) {
+      return false;
+    }
+    std::string_view body = json_.substr(pos_ + 1, end - pos_ - 1);
+    pos_ = end + 1;
+    if (body.find('\\') == std::string_view::npos) {
+      *text = body;
+      return true;
+    }
+    scratch_.clear();
+    if (!Unescape(body, &scratch_)) {
+      return false;
+    }
+    *text = scratch_;
+    return true;
+  }
+
+  // Members keep their JSON order and duplicates are all written; the
+  // decoder on the Dart side lets later duplicates win, as JSON.parse does.
+  bool TranscodeObject(StandardCodecWriter* writer, size_t depth) {
+    ++pos_;
+    size_t index = writer->BeginContainer(kCodecMap);
+    if (!Consume('}')) {
+      do {
+        std::string_view key;
+        if (Peek() != '"' || !ReadStringView(&key)) {
+          return false;
+        }
+        writer->WriteString(key);
+        if (!Consume(':') || !TranscodeValue(writer, depth)) {
+          return false;
+        }
+        writer->AddElement(index);
+      } while (Consume(','));
+      if (!Consume('}')) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool TranscodeArray(StandardCodecWriter* writer, size_t depth) {
+    ++pos_;
+    size_t index = writer->BeginContainer(kCodecList);
+    if (!Consume(']')) {
+      do {
+        if (!TranscodeValue(writer, depth)) {
+          return false;
+        }
+        writer->AddElement(index);
+      } while (Consume(','));
+      if (!Consume(']')) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ReadObject(flutter::EncodableValue* value, size_t depth) {
+    ++pos_;
+    flutter::EncodableMap map;
+    if (!Consume('}')) {
+      do {
+        if (Peek() != '"') {
+          return false;
+        }
+        std::string key;
+        flutter::EncodableValue member;
+        if (!ReadString(&key) || !Consume(':') || !ReadValue(&member, depth)) {
+          return false;
+        }
+        // Later duplicates win, as with JSON.parse.
+        map.insert_or_assign(flutter::EncodableValue(std::move(key)), std::move(member));
+      } while (Consume(','));
+      if (!Consume('}')) {
+        return false;
+      }
+    }
+    *value = flutter::EncodableValue(std::move(map));
+    return true;
+  }
+
+  bool ReadArray(flutter::EncodableValue* value, size_t depth) {
+    ++pos_;
+    flutter::EncodableList list;
+    if (!Consume(']')) {
+      do {
+        list.emplace_back();
+        if (!ReadValue(&list.back(), depth)) {
+          return false;
+        }
+      } while (Consume(','));
+      if (!Consume(']')) {
+        return false;
+      }
+    }
+    *value = flutter::EncodableValue(std::move(list));
+    return true;
+  }
+
+  bool ReadNumber(flutter::EncodableValue* value) {
+    size_t start = pos_;
+    bool integral;
+    size_t end = ScanJsonNumber(json_, pos_, &integral);
+    if (end == std::string_view::npos) {
+      return false;
+    }
+    pos_ = end;
+    const char* first = json_.data() + start;
+    const char* last = json_.data() + pos_;
+    if (integral) {
+      int64_t integer;
+      auto parsed = std::from_chars(first, last, integer);
+      if (parsed.ec == std::errc() && parsed.ptr == last) {
+        if (integer >= std::numeric_limits<int32_t>::min() &&
+            integer <= std::numeric_limits<int32_t>::max()) {
+          *value = flutter::EncodableValue(static_cast<int32_t>(integer));
+        } else {
+          *value = flutter::EncodableValue(integer);
+        }
+        return true;
+      }
+      // Integers beyond int64_t fall through to double, as in JavaScript.
+    }
+    double number = 0;
+    auto parsed = std::from_chars(first, last, number);
+    if (parsed.ptr != last ||
+        (parsed.ec != std::errc() && parsed.ec != std::errc::result_out_of_range)) {
+      return false;
+    }
+    if (parsed.ec == std::errc::result_out_of_range) {
+      // from_chars leaves |number| alone here. Follow JSON.parse: overflow is
+      // Infinity and underflow is zero, both keeping the sign.
+      number = JsonNumberOverflows(json_.substr(start, pos_ - start))
+                   ? std::numeric_limits<double>::infinity()
+                   : 0.0;
+      if (*first == '-') {
+        number = -number;
+      }
+    }
+    *value = flutter::EncodableValue(number);
+    return true;
+  }
+
+  // Locates the closing quote of the string starting at |pos_|. Uses memchr
+  // to jump between quotes and only looks back at the escapes in front of a
+  // candidate quote, so string bodies are scanned once at memchr speed.
+  bool FindStringEnd(size_t* end) {
+    if (pos_ >= json_.size() || json_[pos_] != '"') {
+      return false;
+    }
+    const char* data = json_.data();
+    size_t search = pos_ + 1;
+    while (search < json_.size()) {
+      const void* found = memchr(data + search, '"', json_.size() - search);
+      if (!found) {
+        return false;
+      }
+      size_t quote = static_cast<const char*>(found) - data;
+      size_t backslashes = 0;
+      while (quote - backslashes > pos_ + 1 && data[quote - backslashes - 1] == '\\') {
+        ++backslashes;
+      }
+      if (backslashes % 2 == 0) {
+        *end = quote;
+        return true;
+      }
+      search = quote + 1;
+    }
+    return false;
+  }
+
+  bool SkipString() {
+    size_t end;
+    if (!FindStringEnd(&end)) {
+      return false;
+    }
+    pos_ = end + 1;
+    return true;
+  }
+
+  // Skips a string, number or literal.
+  bool SkipScalar() {
+    switch (Peek()) {
+      case '"':
+        return SkipString();
+      case 't':
+        return SkipLiteral("true");
+      case 'f':
+        return SkipLiteral("false");
+      case 'n':
+        return SkipLiteral("null");
+      default:
+        return SkipNumber();
+    }
+  }
+
+  // Skips an object or array, checking its grammar without decoding it:
+  // strings are still skipped whole by FindStringEnd. The closers of the
+  // open containers are kept in a string rather than on the call stack, so
+  // any depth is fine and the usual shallow payload allocates nothing.
+  bool SkipContainer() {
+    std::string closers;
+    for (;;) {
+      // At a value, after its key if the innermost container is an object.
+      if (!closers.empty() && closers.back() == '}') {
+        if (Peek() != '"' || !SkipString() || !Consume(':')) {
+          return false;
+        }
+      }
+      char c = Peek();
+      if (c == '{' || c == '[') {
+        ++pos_;
+        closers.push_back(c == '{' ? '}' : ']');
+        if (!Consume(closers.back())) {
+          continue;
+        }
+        closers.pop_back();
+      } else if (!SkipScalar()) {
+        return false;
+      }
+      // Past a value: close every container it ends, then expect the next.
+      while (!closers.empty() && Consume(closers.back())) {
+        closers.pop_back();
+      }
+      if (closers.empty()) {
+        return true;
+      }
+      if (!Consume(',')) {
+        return false;
+      }
+    }
+  }
+
+  bool SkipLiteral(std::string_view literal) {
+    if (json_.compare(pos_, literal.size(), literal) != 0) {
+      return false;
+    }
+    pos_ += literal.size();
+    return true;
+  }
+
+  bool SkipNumber() {
+    bool integral;
+    size_t end = ScanJsonNumber(json_, pos_, &integral);
+    if (end == std::string_view::npos) {
+      return false;
+    }
+    pos_ = end;
+    return true;
+  }
+
+  static bool ReadHex4(std::string_view text, size_t pos, uint32_t* value) {
+    if (pos + 4 > text.size()) {
+      return false;
+    }
+    uint32_t result = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+      char c = text[i];
+      result <<= 4;
+      if (c >= '0' && c <= '9') {
+        result |= static_cast<uint32_t>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        result |= static_cast<uint32_t>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        result |= static_cast<uint32_t>(c - 'A' + 10);
+      } else {
+        return false;
+      }
+    }
+    *value = result;
+    return true;
+  }
+
+  static void AppendUtf8(uint32_t code_point, std::string* out) {
+    if (code_point < 0x80) {
+      out->push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+      out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+      out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+      out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+      out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+      out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+      out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+  }
+
+  // Decodes the escape sequences in a string body. Unpaired surrogates are
+  // replaced with U+FFFD rather than rejected, matching JSON.parse leniency.
+  static bool Unescape(std::string_view body, std::string* out) {
+    out->reserve(out->size() + body.size());
+    size_t i = 0;
+    while (i < body.size()) {
+      size_t backslash = body.find('\\', i);
+      if (backslash == std::string_view::npos) {
+        out->append(body.data() + i, body.size() - i);
+        break;
+      }
+      out->append(body.data() + i, backslash - i);
+      if (backslash + 1 >= body.size()) {
+        return false;
+      }
+      char escape = body[backslash + 1];
+      i = backslash + 2;
+      switch (escape) {
+        case '"':
+          out->push_back('"');
+          break;
+        case '\\':
+          out->push_back('\\');
+          break;
+        case '/':
+          out->push_back('/');
+          break;
+        case 'b':
+          out->push_back('\b');
+          break;
+        case 'f':
+          out->push_back('\f');
+          break;
+        case 'n':
+          out->push_back('\n');
+          break;
+        case 'r':
+          out->push_back('\r');
+          break;
+        case 't':
+          out->push_back('\t');
+          break;
+        case 'u': {
+          uint32_t code_unit;
+          if (!ReadHex4(body, i, &code_unit)) {
+            return false;
+          }
+          i += 4;
+          if (code_unit >= 0xD800 && code_unit <= 0xDBFF) {
+            uint32_t low;
+            if (i + 6 <= body.size() && body[i] == '\\' && body[i + 1] == 'u' &&
+                ReadHex4(body, i + 2, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+              i += 6;
+              code_unit = 0x10000 + ((code_unit - 0xD800) << 10) + (low - 0xDC00);
+            } else {
+              code_unit = 0xFFFD;
+            }
+          } else if (code_unit >= 0xDC00 && code_unit <= 0xDFFF) {
+            code_unit = 0xFFFD;
+          }
+          AppendUtf8(code_unit, out);
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+    return true;
+  }
+
+  std::string_view json_;
+  size_t pos_;
+  // Unescaped strings for ReadStringView.
+  std::string scratch_;
+};
+
+// Appends any integral or floating-point number using std::to_chars, which
+// is locale-independent and produces the shortest round-trip form for doubles.
+template <typename T>
+void AppendNumber(T number, std::string* out) {
+  if constexpr (std::is_floating_point_v<T>) {
+    if (!std::isfinite(number)) {
+      out->append("null");
+      return;
+    }
+  }
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+  out->append(buffer, result.ptr - buffer);
+}
+
+template <typename T>
+void AppendNumberArray(const std::vector<T>& numbers, std::string* out) {
+  out->push_back('[');
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    if (i > 0) {
+      out->push_back(',');
+    }
+    AppendNumber(numbers[i], out);
+  }
+  out->push_back(']');
+}
+
+}  // namespace
+
+bool ScanMcpMessageEnvelope(std::string_view json, McpMessageEnvelope* envelope) {
+  *envelope = McpMessageEnvelope();
+
+  JsonReader reader(json);
+  if (!reader.Consume('{')) {
+    return false;
+  }
+  if (reader.Consume('}')) {
+    return reader.AtEnd();
+  }
+
+  std::string key;
+  do {
+    if (reader.Peek() != '"') {
+      return false;
+    }
+    key.clear();
+    if (!reader.ReadString(&key) || !reader.Consume(':')) {
+      return false;
+    }
+
+    bool ok;
+    if (key == "type" && reader.Peek() == '"') {
+      envelope->type.clear();
+      ok = reader.ReadString(&envelope->type);
+    } else if (key == "requestId" && reader.Peek() == '"') {
+      envelope->request_id.clear();
+      ok = reader.ReadString(&envelope->request_id);
+      envelope->has_request_id = ok;
+    } else if (key == "id") {
+      std::string_view raw;
+      ok = reader.SkipValue(&raw);
+      if (ok) {
+        auto parsed = std::from_chars(raw.data(), raw.data() + raw.size(), envelope->id);
+        envelope->has_id = parsed.ec == std::errc() && parsed.ptr == raw.data() + raw.size();
+      }
+    } else if (key == "processingUs") {
+      std::string_view raw;
+      ok = reader.SkipValue(&raw);
+      if (ok) {
+        auto parsed = std::from_chars(raw.data(), raw.data() + raw.size(), envelope->processing_us);
+        if (parsed.ec != std::errc() || parsed.ptr != raw.data() + raw.size()) {
+          envelope->processing_us = 0;
+        }
+      }
+    } else if (key == "error") {
+      ok = reader.SkipValue(&envelope->error);
+      envelope->has_error = ok && envelope->error != "null";
+    } else {
+      ok = reader.SkipValue(nullptr);
+    }
+    if (!ok) {
+      return false;
+    }
+  } while (reader.Consume(','));
+
+  return reader.Consume('}') && reader.AtEnd();
+}
+
+bool DecodeJsonToEncodableValue(std::string_view json, flutter::EncodableValue* value) {
+  JsonReader reader(json);
+  return reader.ReadValue(value, 0) && reader.AtEnd();
+}
+
+bool TranscodeJsonToStandardCodec(std::string_view json, size_t base_offset,
+                                  std::vector<uint8_t>* out) {
+  StandardCodecWriter writer(base_offset, out);
+  {
+    JsonReader reader(json);
+    if (!reader.TranscodeValue(&writer, 0) || !reader.AtEnd()) {
+      return false;
+    }
+  }
+  // The encoding is rarely larger than the JSON text it comes from.
+  writer.StartWriting(json.size());
+  JsonReader reader(json);
+  return reader.TranscodeValue(&writer, 0);
+}
+
+void AppendJson(const flutter::EncodableValue& value, std::string* out) {
+  if (auto str_val = std::get_if<std::string>(&value)) {
+    AppendJsonString(*str_val, out);
+  } else if (auto map = std::get_if<flutter::EncodableMap>(&value)) {
+    AppendJson(*map, out);
+  } else if (auto list = std::get_if<flutter::EncodableList>(&value)) {
+    out->push_back('[');
+    bool first = true;
+    for (const auto& element : *list) {
+      if (!first) {
+        out->push_back(',');
+      }
+      first = false;
+      AppendJson(element, out);
+    }
+    out->push_back(']');
+  } else if (auto bool_val = std::get_if<bool>(&value)) {
+    out->append(*bool_val ? "true" : "false");
+  } else if (auto int_val = std::get_if<int32_t>(&value)) {
+    AppendNumber(*int_val, out);
+  } else if (auto long_val = std::get_if<int64_t>(&value)) {
+    AppendNumber(*long_val, out);
+  } else if (auto double_val = std::get_if<double>(&value)) {
+    AppendNumber(*double_val, out);
+  } else if (auto bytes = std::get_if<std::vector<uint8_t>>(&value)) {
+    AppendNumberArray(*bytes, out);
+  } else if (auto int_list = std::get_if<std::vector<int32_t>>(&value)) {
+    AppendNumberArray(*int_list, out);
+  } else if (auto long_list = std::get_if<std::vector<int64_t>>(&value)) {
+    AppendNumberArray(*long_list, out);
+  } else if (auto float_list = std::get_if<std::vector<float>>(&value)) {
+    AppendNumberArray(*float_list, out);
+  } else if (auto double_list = std::get_if<std::vector<double>>(&value)) {
+    AppendNumberArray(*double_list, out);
+  } else {
+    // std::monostate and CustomEncodableValue.
+    out->append("null");
+  }
+}
+
+void AppendJson(const flutter::EncodableMap& map, std::string* out) {
+  out->push_back('{');
+  bool first = true;
+  for (const auto& [key, val] : map) {
+    if (!first) {
+      out->push_back(',');
+    }
+    first = false;
+
+    if (auto key_str = std::get_if<std::string>(&key)) {
+      AppendJsonString(*key_str, out);
+    } else {
+      std::string key_json;
+      AppendJson(key, &key_json);
+      AppendJsonString(key_json, out);
+    }
+    out->push_back(':');
+    AppendJson(val, out);
+  }
+  out->push_back('}');
+}
+
+void AppendJsonString(std::string_view text, std::string* out) {
+  static const char kHexDigits[] = "0123456789abcdef";
+
+  out->reserve(out->size() + text.size() + 2);
+  out->push_back('"');
+  size_t run_start = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    // Copy the unescaped run in one append before writing the escape.
+    out->append(text.data() + run_start, i - run_start);
+    run_start = i + 1;
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      case '\n':
+        out->append("\\n");
+        break;
+      case '\r':
+        out->append("\\r");
+        break;
+      case '\t':
+        out->append("\\t");
+        break;
+      case '\b':
+        out->append("\\b");
+        break;
+      case '\f':
+        out->append("\\f");
+        break;
+      default: {
+        char escape[] = {'\\', 'u', '0', '0', kHexDigits[c >> 4], kHexDigits[c & 0xF]};
+        out->append(escape, sizeof(escape));
+        break;
+      }
+    }
+  }
+  out->append(text.data() + run_start, text.size() - run_start);
+  out->push_back('"');
+}
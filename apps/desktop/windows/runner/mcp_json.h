@@ -0,0 +1,75 @@
+#ifndef RUNNER_MCP_JSON_H_
+#define RUNNER_MCP_JSON_H_
+
+#include <flutter/encodable_value.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Routing fields of a single message from the MCP bridge. Filled in by
+// ScanMcpMessageEnvelope without building the rest of the document.
+struct McpMessageEnvelope {
+  // Value of the top-level "type" member, e.g. "response" or "event".
+  std::string type;
+
+  // Value of the top-level "requestId" member, if it is a string.
+  std::string request_id;
+  bool has_request_id = false;
+
+  // Value of the top-level "id" member, the plugin-assigned wire id that the
+  // bridge echoes back, if it is a non-negative integer.
+  uint64_t id = 0;
+  bool has_id = false;
+
+  // True when a top-level "error" member is present and is not null.
+  bool has_error = false;
+
+  // Value of the top-level "processingUs" member, the time the bridge spent
+  // on a request, or 0 when absent.
+  uint64_t processing_us = 0;
+
+  // Raw JSON text of the top-level "error" value. Points into the scanned
+  // message and is only valid while that message is alive.
+  std::string_view error;
+};
+
+// Walks the top-level object of |json| once, recording the routing fields in
+// |envelope| and skipping every other member without decoding it, so large
+// payloads are only touched by a memchr over their string contents. Keys
+// nested inside payload values are never mistaken for routing fields.
+// Returns false if |json| is not a valid JSON object. Skipped values are
+// checked against the JSON grammar too, except that string contents are only
+// scanned for their closing quote.
+bool ScanMcpMessageEnvelope(std::string_view json, McpMessageEnvelope* envelope);
+
+// Decodes |json| into the equivalent EncodableValue tree so it can go through
+// the StandardMethodCodec as structured data: objects become EncodableMap with
+// string keys, arrays EncodableList, integers int32_t when they fit and
+// int64_t otherwise, and all other numbers double. Returns false and leaves
+// |value| unspecified if |json| is malformed or nested deeper than 512 levels.
+bool DecodeJsonToEncodableValue(std::string_view json, flutter::EncodableValue* value);
+
+// Writes the StandardMessageCodec encoding of the value
+// DecodeJsonToEncodableValue would decode |json| to into |out|, without
+// building that value. Object members keep their JSON order rather than the
+// key order of an EncodableMap. The codec aligns doubles to the start of the
+// whole message, so |base_offset| is where the bytes will sit in it. Returns
+// false, like the decoder, on malformed or too deeply nested input.
+bool TranscodeJsonToStandardCodec(std::string_view json, size_t base_offset,
+                                  std::vector<uint8_t>* out);
+
+// Appends the JSON text of |value| to |out| without any intermediate
+// buffers, so callers can reuse one string across messages. Strings are
+// escaped, doubles use the shortest representation that round-trips (NaN and
+// infinities become null), and byte arrays and typed lists become arrays of
+// numbers. Non-string map keys are serialized and then used as the key text.
+// Custom values have no JSON form and are written as null.
+void AppendJson(const flutter::EncodableValue& value, std::string* out);
+void AppendJson(const flutter::EncodableMap& map, std::string* out);
+
+// Appends |text| to |out| as a quoted JSON string.
+void AppendJsonString(std::string_view text, std::string* out);
+
+#endif  // RUNNER_MCP_JSON_H_
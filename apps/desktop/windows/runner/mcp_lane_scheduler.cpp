@@ -0,0 +1,156 @@
+#include "mcp_lane_scheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+// Lanes as configured when initialize sets nothing: interactive calls get
+// most of the turns and bulk traffic a bounded share of the pool.
+constexpr uint32_t kDefaultWeights[kMcpPriorityCount] = {8, 4, 1};
+constexpr size_t kDefaultLaneLimits[kMcpPriorityCount] = {64, 32, 8};
+
+}  // namespace
+
+bool ParseMcpPriority(std::string_view name, McpPriority* priority) {
+  if (name == "interactive") {
+    *priority = McpPriority::kInteractive;
+  } else if (name == "normal") {
+    *priority = McpPriority::kNormal;
+  } else if (name == "bulk") {
+    *priority = McpPriority::kBulk;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* McpPriorityName(McpPriority priority) {
+  switch (priority) {
+    case McpPriority::kInteractive:
+      return "interactive";
+    case McpPriority::kBulk:
+      return "bulk";
+    case McpPriority::kNormal:
+    default:
+      return "normal";
+  }
+}
+
+McpLaneScheduler::McpLaneScheduler() {
+  for (size_t index = 0; index < kMcpPriorityCount; ++index) {
+    lanes_[index].weight = kDefaultWeights[index];
+    lanes_[index].max_in_flight = kDefaultLaneLimits[index];
+  }
+}
+
+McpLaneScheduler::~McpLaneScheduler() = default;
+
+void McpLaneScheduler::ConfigureLane(McpPriority priority, uint32_t weight,
+                                     size_t max_in_flight) {
+  Lane& lane = lanes_[static_cast<size_t>(priority)];
+  lane.weight = std::max<uint32_t>(weight, 1);
+  lane.max_in_flight = max_in_flight;
+}
+
+void McpLaneScheduler::SetMaxInFlight(size_t max_in_flight) {
+  max_in_flight_ = max_in_flight;
+}
+
+bool McpLaneScheduler::Admit(McpPriority priority) {
+  Lane& lane = lanes_[static_cast<size_t>(priority)];
+  if (!lane.queue.empty() || !HasRoom(lane)) {
+    return false;
+  }
+  ++lane.in_flight;
+  ++in_flight_;
+  return true;
+}
+
+void McpLaneScheduler::Enqueue(McpQueuedRequest request) {
+  lanes_[static_cast<size_t>(request.priority)].queue.push_back(std::move(request));
+}
+
+void McpLaneScheduler::Finish(McpPriority priority) {
+  Lane& lane = lanes_[static_cast<size_t>(priority)];
+  if (lane.in_flight > 0) {
+    --lane.in_flight;
+    --in_flight_;
+  }
+}
+
+bool McpLaneScheduler::Next(McpQueuedRequest* request) {
+  // Every lane that could go now earns its weight; the richest goes and
+  // pays back the total, which interleaves lanes in proportion to weight.
+  Lane* chosen = nullptr;
+  int64_t total_weight = 0;
+  for (Lane& lane : lanes_) {
+    if (lane.queue.empty() || !HasRoom(lane)) {
+      continue;
+    }
+    lane.current_weight += lane.weight;
+    total_weight += lane.weight;
+    if (!chosen || lane.current_weight > chosen->current_weight) {
+      chosen = &lane;
+    }
+  }
+  if (!chosen) {
+    return false;
+  }
+  chosen->current_weight -= total_weight;
+  *request = std::move(chosen->queue.front());
+  chosen->queue.pop_front();
+  ++chosen->in_flight;
+  ++in_flight_;
+  return true;
+}
+
+bool McpLaneScheduler::TakeByWireId(uint64_t wire_id, McpQueuedRequest* request) {
+  for (Lane& lane : lanes_) {
+    for (auto it = lane.queue.begin(); it != lane.queue.end(); ++it) {
+      if (it->wire_id == wire_id) {
+        *request = std::move(*it);
+        lane.queue.erase(it);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool McpLaneScheduler::TakeByRequestId(const std::string& request_id,
+                                       McpQueuedRequest* request) {
+  for (Lane& lane : lanes_) {
+    for (auto it = lane.queue.begin(); it != lane.queue.end(); ++it) {
+      if (it->pending.request_id == request_id) {
+        *request = std::move(*it);
+        lane.queue.erase(it);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::vector<McpQueuedRequest> McpLaneScheduler::TakeAll() {
+  std::vector<McpQueuedRequest> requests;
+  for (Lane& lane : lanes_) {
+    for (auto& request : lane.queue) {
+      requests.push_back(std::move(request));
+    }
+    lane.queue.clear();
+    lane.current_weight = 0;
+  }
+  return requests;
+}
+
+size_t McpLaneScheduler::queued(McpPriority priority) const {
+  return lanes_[static_cast<size_t>(priority)].queue.size();
+}
+
+size_t McpLaneScheduler::in_flight(McpPriority priority) const {
+  return lanes_[static_cast<size_t>(priority)].in_flight;
+}
+
+bool McpLaneScheduler::HasRoom(const Lane& lane) const {
+  return lane.in_flight < lane.max_in_flight && in_flight_ < max_in_flight_;
+}
@@ -0,0 +1,100 @@
+#ifndef RUNNER_MCP_LANE_SCHEDULER_H_
+#define RUNNER_MCP_LANE_SCHEDULER_H_
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mcp_request_registry.h"
+
+// Priority of a request, from the request's "priority" field.
+enum class McpPriority : int {
+  kInteractive = 0,
+  kNormal = 1,
+  kBulk = 2,
+};
+
+constexpr size_t kMcpPriorityCount = 3;
+
+// Parses "interactive", "normal" or "bulk". Returns false for anything else.
+bool ParseMcpPriority(std::string_view name, McpPriority* priority);
+const char* McpPriorityName(McpPriority priority);
+
+// A request waiting for a slot in its lane, with everything needed to send
+// it once admitted.
+struct McpQueuedRequest {
+  uint64_t wire_id = 0;
+  McpPriority priority = McpPriority::kNormal;
+  std::string affinity_key;
+  std::string message;
+  // A streamMessage call, which answers through events and holds its slot
+  // only while it is sent.
+  bool stream = false;
+  McpPendingRequest pending;
+};
+
+// Admission control for requests on their way to the bridge pool.
+//
+// Each priority is a lane with its own limit on requests in flight, and all
+// lanes share an overall limit. A request that finds its lane or the pool
+// full waits in its lane's FIFO; whenever a slot frees up, the lanes that
+// have work and room take turns by smooth weighted round robin, so bulk
+// traffic keeps moving but cannot crowd out interactive calls. Platform
+// thread only.
+class McpLaneScheduler {
+ public:
+  static constexpr size_t kDefaultMaxInFlight = 64;
+
+  McpLaneScheduler();
+  ~McpLaneScheduler();
+
+  // Prevent copying.
+  McpLaneScheduler(McpLaneScheduler const&) = delete;
+  McpLaneScheduler& operator=(McpLaneScheduler const&) = delete;
+
+  // Sets the round robin weight of |priority|, at least 1, and its limit on
+  // requests in flight.
+  void ConfigureLane(McpPriority priority, uint32_t weight, size_t max_in_flight);
+  void SetMaxInFlight(size_t max_in_flight);
+
+  // Takes a slot of |priority| if one is free and nothing waits ahead in
+  // that lane. Otherwise the caller must Enqueue the request.
+  bool Admit(McpPriority priority);
+  void Enqueue(McpQueuedRequest request);
+
+  // Returns the slot of a request of |priority| that completed.
+  void Finish(McpPriority priority);
+
+  // Moves the next request due a free slot into |request| and takes the
+  // slot for it. Returns false if none can go.
+  bool Next(McpQueuedRequest* request);
+
+  // Removes a waiting request, for cancellation and deadlines.
+  bool TakeByWireId(uint64_t wire_id, McpQueuedRequest* request);
+  bool TakeByRequestId(const std::string& request_id, McpQueuedRequest* request);
+  std::vector<McpQueuedRequest> TakeAll();
+
+  size_t queued(McpPriority priority) const;
+  size_t in_flight(McpPriority priority) const;
+
+ private:
+  struct Lane {
+    uint32_t weight = 1;
+    size_t max_in_flight = kDefaultMaxInFlight;
+    size_t in_flight = 0;
+    // Smooth weighted round robin credit.
+    int64_t current_weight = 0;
+    std::deque<McpQueuedRequest> queue;
+  };
+
+  bool HasRoom(const Lane& lane) const;
+
+  std::array<Lane, kMcpPriorityCount> lanes_;
+  size_t max_in_flight_ = kDefaultMaxInFlight;
+  size_t in_flight_ = 0;
+};
+
+#endif  // RUNNER_MCP_LANE_SCHEDULER_H_
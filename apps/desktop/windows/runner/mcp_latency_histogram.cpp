@@ -0,0 +1,97 @@
+#include "mcp_latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Index of the most significant set bit of |value|, which must be nonzero.
+int HighestBit(uint64_t value) {
+  int bit = 0;
+  while (value >>= 1) {
+    ++bit;
+  }
+  return bit;
+}
+
+// Number of samples at or below the |quantile| percentile of |count|.
+uint64_t Rank(double quantile, uint64_t count) {
+  return std::max<uint64_t>(static_cast<uint64_t>(std::ceil(quantile * count)), 1);
+}
+
+}  // namespace
+
+McpLatencyHistogram::McpLatencyHistogram(std::chrono::seconds window)
+    : window_(window), window_start_(Clock::now()) {}
+
+void McpLatencyHistogram::Record(std::chrono::microseconds latency) {
+  uint64_t value = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0));
+  std::lock_guard<std::mutex> lock(mutex_);
+  RotateLocked(Clock::now());
+  ++current_.counts[BucketFor(value)];
+  ++current_.total;
+  current_.max = std::max(current_.max, value);
+}
+
+McpLatencySummary McpLatencyHistogram::Summarize() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RotateLocked(Clock::now());
+
+  McpLatencySummary summary;
+  summary.count = current_.total + previous_.total;
+  summary.max = std::max(current_.max, previous_.max);
+  if (summary.count == 0) {
+    return summary;
+  }
+
+  // One pass over the buckets finds all three ranks in order.
+  const double quantiles[] = {0.50, 0.95, 0.99};
+  uint64_t* results[] = {&summary.p50, &summary.p95, &summary.p99};
+  size_t next = 0;
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < kBucketCount && next < 3; ++bucket) {
+    seen += current_.counts[bucket] + previous_.counts[bucket];
+    while (next < 3 && seen >= Rank(quantiles[next], summary.count)) {
+      *results[next++] = std::min(BucketUpperBound(bucket), summary.max);
+    }
+  }
+  return summary;
+}
+
+// static
+size_t McpLatencyHistogram::BucketFor(uint64_t value) {
+  value = std::min(value, (uint64_t{1} << kMaxValueBits) - 1);
+  if (value < (uint64_t{1} << kSubBucketBits)) {
+    return static_cast<size_t>(value);
+  }
+  int shift = HighestBit(value) - (kSubBucketBits - 1);
+  size_t sub_bucket = static_cast<size_t>(value >> shift) - (size_t{1} << (kSubBucketBits - 1));
+  return (size_t{1} << kSubBucketBits) + (shift - 1) * (size_t{1} << (kSubBucketBits - 1)) +
+         sub_bucket;
+}
+
+// static
+uint64_t McpLatencyHistogram::BucketUpperBound(size_t bucket) {
+  if (bucket < (size_t{1} << kSubBucketBits)) {
+    return bucket;
+  }
+  size_t offset = bucket - (size_t{1} << kSubBucketBits);
+  int shift = static_cast<int>(offset >> (kSubBucketBits - 1)) + 1;
+  uint64_t sub_bucket = offset & ((size_t{1} << (kSubBucketBits - 1)) - 1);
+  uint64_t lower = (sub_bucket + (uint64_t{1} << (kSubBucketBits - 1))) << shift;
+  return lower + (uint64_t{1} << shift) - 1;
+}
+
+void McpLatencyHistogram::RotateLocked(Clock::time_point now) {
+  if (now - window_start_ < window_) {
+    return;
+  }
+  // A gap of two windows or more leaves nothing recent to keep.
+  if (now - window_start_ < 2 * window_) {
+    previous_ = current_;
+  } else {
+    previous_ = Window();
+  }
+  current_ = Window();
+  window_start_ = now;
+}
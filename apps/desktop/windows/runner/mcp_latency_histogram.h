@@ -0,0 +1,69 @@
+#ifndef RUNNER_MCP_LATENCY_HISTOGRAM_H_
+#define RUNNER_MCP_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Percentiles of the samples in a McpLatencyHistogram, in microseconds.
+struct McpLatencySummary {
+  uint64_t count = 0;
+  uint64_t p50 = 0;
+  uint64_t p95 = 0;
+  uint64_t p99 = 0;
+  uint64_t max = 0;
+};
+
+// Rolling histogram of recent latencies.
+//
+// Buckets are log-linear, as in HdrHistogram: every power of two is split
+// into 16 linear sub-buckets, so any recorded value is reported within about
+// 6% across the whole range from 1us to hours. Samples age out by window:
+// the histogram keeps the current window and the one before it, so a summary
+// covers between one and two windows of history. Thread-safe.
+class McpLatencyHistogram {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit McpLatencyHistogram(std::chrono::seconds window = std::chrono::seconds(60));
+
+  // Prevent copying.
+  McpLatencyHistogram(McpLatencyHistogram const&) = delete;
+  McpLatencyHistogram& operator=(McpLatencyHistogram const&) = delete;
+
+  void Record(std::chrono::microseconds latency);
+
+  McpLatencySummary Summarize();
+
+ private:
+  // Values below 2^kSubBucketBits get a bucket each; above that every power
+  // of two gets 2^(kSubBucketBits - 1) buckets.
+  static constexpr int kSubBucketBits = 5;
+  static constexpr int kMaxValueBits = 36;
+  static constexpr size_t kBucketCount =
+      (size_t{1} << kSubBucketBits) +
+      (kMaxValueBits - kSubBucketBits) * (size_t{1} << (kSubBucketBits - 1));
+
+  struct Window {
+    std::array<uint64_t, kBucketCount> counts{};
+    uint64_t total = 0;
+    uint64_t max = 0;
+  };
+
+  static size_t BucketFor(uint64_t value);
+  // Largest value that lands in |bucket|.
+  static uint64_t BucketUpperBound(size_t bucket);
+
+  // Starts a new window if the current one has run its course. mutex_ must
+  // be held.
+  void RotateLocked(Clock::time_point now);
+
+  std::chrono::seconds window_;
+  std::mutex mutex_;
+  Clock::time_point window_start_;
+  Window current_;
+  Window previous_;
+};
+
+#endif  // RUNNER_MCP_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,358 @@
+#include "mcp_log_buffer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace {
+
+// Sources beyond this many are pruned of those idle with a full bucket.
+constexpr size_t kMaxSources = 64;
+
+// Untagged lines are scanned this far for words that give their level away.
+constexpr size_t kLevelScanBytes = 160;
+
+// Windows FILETIME of the Unix epoch, in 100 ns units.
+constexpr int64_t kUnixEpochFileTime = 116444736000000000LL;
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+bool ContainsWord(std::string_view text, std::string_view word) {
+  return text.find(word) != std::string_view::npos;
+}
+
+// Guesses the level of an untagged line, the way a person skimming it would.
+McpLogLevel GuessLevel(std::string_view line) {
+  std::string lower(line.substr(0, kLevelScanBytes));
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  // "✗", which the bridge prefixes its failures with.
+  if (ContainsWord(lower, "\xE2\x9C\x97") || ContainsWord(lower, "error") ||
+      ContainsWord(lower, "fatal") || ContainsWord(lower, "exception")) {
+    return McpLogLevel::kError;
+  }
+  if (ContainsWord(lower, "warn")) {
+    return McpLogLevel::kWarn;
+  }
+  if (ContainsWord(lower, "debug") || ContainsWord(lower, "trace")) {
+    return McpLogLevel::kDebug;
+  }
+  return McpLogLevel::kInfo;
+}
+
+// Appends |entry| to |out| as "2024-01-02T03:04:05.678Z [level] pid=N text".
+void FormatEntry(const McpLogEntry& entry, std::string* out) {
+  int64_t file_time = entry.time_ms * 10000 + kUnixEpochFileTime;
+  FILETIME ft;
+  ft.dwLowDateTime = static_cast<DWORD>(file_time);
+  ft.dwHighDateTime = static_cast<DWORD>(file_time >> 32);
+  SYSTEMTIME st = {};
+  FileTimeToSystemTime(&ft, &st);
+  char prefix[80];
+  int length = std::snprintf(prefix, sizeof(prefix),
+                             "%04u-%02u-%02uT%02u:%02u:%02u.%03uZ [%s] pid=%u ", st.wYear,
+                             st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond,
+                             st.wMilliseconds, McpLogLevelName(entry.level), entry.pid);
+  out->append(prefix, static_cast<size_t>(std::max(length, 0)));
+  out->append(entry.text);
+  out->append("\r\n");
+}
+
+std::wstring RotatedPath(const std::wstring& path, uint32_t index) {
+  return path + L"." + std::to_wstring(index);
+}
+
+}  // namespace
+
+bool ParseMcpLogLevel(std::string_view name, McpLogLevel* level) {
+  if (name == "debug") {
+    *level = McpLogLevel::kDebug;
+  } else if (name == "info") {
+    *level = McpLogLevel::kInfo;
+  } else if (name == "warn" || name == "warning") {
+    *level = McpLogLevel::kWarn;
+  } else if (name == "error") {
+    *level = McpLogLevel::kError;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* McpLogLevelName(McpLogLevel level) {
+  switch (level) {
+    case McpLogLevel::kDebug:
+      return "debug";
+    case McpLogLevel::kInfo:
+      return "info";
+    case McpLogLevel::kWarn:
+      return "warn";
+    case McpLogLevel::kError:
+      return "error";
+  }
+  return "info";
+}
+
+// static
+McpLogBuffer& McpLogBuffer::Get() {
+  static McpLogBuffer buffer;
+  return buffer;
+}
+
+// static
+std::wstring McpLogBuffer::DefaultFilePath() {
+  wchar_t temp[MAX_PATH + 1];
+  DWORD length = GetTempPathW(MAX_PATH + 1, temp);
+  if (length == 0 || length > MAX_PATH) {
+    return std::wstring();
+  }
+  return std::wstring(temp, length) + L"asmbli-mcp-bridge.log";
+}
+
+McpLogBuffer::McpLogBuffer() {
+  options_.file_path = DefaultFilePath();
+  flush_timer_ = CreateThreadpoolTimer(&McpLogBuffer::OnFlushTimer, this, nullptr);
+}
+
+McpLogBuffer::~McpLogBuffer() {
+  if (flush_timer_) {
+    SetThreadpoolTimer(flush_timer_, nullptr, 0, 0);
+    WaitForThreadpoolTimerCallbacks(flush_timer_, TRUE);
+    CloseThreadpoolTimer(flush_timer_);
+  }
+  Flush();
+  if (file_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_);
+  }
+}
+
+void McpLogBuffer::Configure(const Options& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+  options_.max_entries = std::max<size_t>(options_.max_entries, 1);
+  while (entries_.size() > options_.max_entries || bytes_ > options_.max_bytes) {
+    bytes_ -= entries_.front().text.size();
+    entries_.pop_front();
+    ++evicted_;
+  }
+}
+
+void McpLogBuffer::AppendOutput(uint32_t pid, std::string_view chunk, std::string* partial) {
+  while (!chunk.empty()) {
+    size_t newline = chunk.find('\n');
+    if (newline == std::string_view::npos) {
+      partial->append(chunk.substr(0, kMaxLineBytes - std::min(partial->size(), kMaxLineBytes)));
+      if (partial->size() >= kMaxLineBytes) {
+        AppendLine(pid, *partial);
+        partial->clear();
+      }
+      return;
+    }
+    std::string_view line = chunk.substr(0, newline);
+    chunk.remove_prefix(newline + 1);
+    if (partial->empty()) {
+      AppendLine(pid, line);
+    } else {
+      partial->append(line);
+      AppendLine(pid, *partial);
+      partial->clear();
+    }
+  }
+}
+
+void McpLogBuffer::AppendLine(uint32_t pid, std::string_view line) {
+  while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+    line.remove_suffix(1);
+  }
+  if (line.empty()) {
+    return;
+  }
+  line = line.substr(0, kMaxLineBytes);
+
+  McpLogLevel level = McpLogLevel::kInfo;
+  size_t tag_end = line.size() > 1 && line[0] == '[' ? line.find(']') : std::string_view::npos;
+  if (tag_end != std::string_view::npos && ParseMcpLogLevel(line.substr(1, tag_end - 1), &level)) {
+    line.remove_prefix(tag_end + 1);
+    if (!line.empty() && line[0] == ' ') {
+      line.remove_prefix(1);
+    }
+  } else {
+    level = GuessLevel(line);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t suppressed = 0;
+  if (!TakeTokenLocked(pid, &suppressed)) {
+    return;
+  }
+  if (suppressed > 0) {
+    PushLocked(pid, McpLogLevel::kWarn,
+               std::to_string(suppressed) + " lines suppressed by rate limiting");
+  }
+  PushLocked(pid, level, std::string(line));
+}
+
+uint64_t McpLogBuffer::Query(uint64_t after, McpLogLevel min_level, size_t limit,
+                             std::vector<McpLogEntry>* entries) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t next = std::max(after, next_sequence_ - 1);
+  // Sequences are consecutive, so the first entry after |after| is found by
+  // offset rather than by a scan.
+  uint64_t first = entries_.empty() ? 0 : entries_.front().sequence;
+  size_t index = after >= first ? static_cast<size_t>(after - first + 1) : 0;
+  for (; index < entries_.size(); ++index) {
+    const McpLogEntry& entry = entries_[index];
+    if (entry.level < min_level) {
+      continue;
+    }
+    if (entries->size() >= limit) {
+      next = entry.sequence - 1;
+      break;
+    }
+    entries->push_back(entry);
+  }
+  return next;
+}
+
+void McpLogBuffer::Flush() {
+  std::lock_guard<std::mutex> file_lock(file_mutex_);
+  std::string data;
+  Options options;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    data.swap(pending_file_);
+    options = options_;
+    flush_timer_armed_ = false;
+  }
+  if (!data.empty() && !options.file_path.empty()) {
+    WriteFileLocked(options, data);
+  }
+}
+
+uint64_t McpLogBuffer::evicted() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return evicted_;
+}
+
+uint64_t McpLogBuffer::suppressed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return suppressed_;
+}
+
+bool McpLogBuffer::TakeTokenLocked(uint32_t pid, uint64_t* suppressed) {
+  if (options_.lines_per_second == 0) {
+    return true;
+  }
+  const double rate = options_.lines_per_second;
+  const double burst = rate * 2;
+  auto now = std::chrono::steady_clock::now();
+  auto [it, inserted] = sources_.try_emplace(pid);
+  Source& source = it->second;
+  if (inserted) {
+    source.tokens = burst;
+  } else {
+    double elapsed = std::chrono::duration<double>(now - source.refilled).count();
+    source.tokens = std::min(source.tokens + elapsed * rate, burst);
+  }
+  source.refilled = now;
+
+  if (source.tokens < 1) {
+    ++source.suppressed;
+    ++suppressed_;
+    return false;
+  }
+  source.tokens -= 1;
+  *suppressed = source.suppressed;
+  source.suppressed = 0;
+
+  if (inserted && sources_.size() > kMaxSources) {
+    for (auto source_it = sources_.begin(); source_it != sources_.end();) {
+      double idle = std::chrono::duration<double>(now - source_it->second.refilled).count();
+      if (source_it->first != pid && source_it->second.suppressed == 0 &&
+          source_it->second.tokens + idle * rate >= burst) {
+        source_it = sources_.erase(source_it);
+      } else {
+        ++source_it;
+      }
+    }
+  }
+  return true;
+}
+
+void McpLogBuffer::PushLocked(uint32_t pid, McpLogLevel level, std::string text) {
+  McpLogEntry entry{next_sequence_++, NowMs(), level, pid, std::move(text)};
+  if (!options_.file_path.empty()) {
+    FormatEntry(entry, &pending_file_);
+    if (!flush_timer_armed_ && flush_timer_) {
+      // Negative due time is relative, in 100 ns units.
+      ULARGE_INTEGER relative;
+      relative.QuadPart = static_cast<ULONGLONG>(
+          -std::chrono::duration_cast<std::chrono::nanoseconds>(kFileFlushDelay).count() / 100);
+      FILETIME due_time;
+      due_time.dwLowDateTime = relative.LowPart;
+      due_time.dwHighDateTime = relative.HighPart;
+      flush_timer_armed_ = true;
+      SetThreadpoolTimer(flush_timer_, &due_time, 0, 0);
+    }
+  }
+
+  bytes_ += entry.text.size();
+  entries_.push_back(std::move(entry));
+  while (entries_.size() > options_.max_entries ||
+         (bytes_ > options_.max_bytes && entries_.size() > 1)) {
+    bytes_ -= entries_.front().text.size();
+    entries_.pop_front();
+    ++evicted_;
+  }
+}
+
+void McpLogBuffer::WriteFileLocked(const Options& options, const std::string& data) {
+  const std::wstring& path = options.file_path;
+  if (file_ != INVALID_HANDLE_VALUE && path != open_path_) {
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+  }
+  if (file_ != INVALID_HANDLE_VALUE && options.max_file_bytes > 0 &&
+      file_bytes_ + data.size() > options.max_file_bytes) {
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+    RotateLocked(path, options.max_files);
+  }
+  if (file_ == INVALID_HANDLE_VALUE) {
+    file_ = CreateFileW(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      return;
+    }
+    open_path_ = path;
+    LARGE_INTEGER size;
+    file_bytes_ = GetFileSizeEx(file_, &size) ? static_cast<uint64_t>(size.QuadPart) : 0;
+  }
+
+  DWORD written = 0;
+  if (WriteFile(file_, data.data(), static_cast<DWORD>(data.size()), &written, nullptr)) {
+    file_bytes_ += written;
+  }
+}
+
+void McpLogBuffer::RotateLocked(const std::wstring& path, uint32_t max_files) {
+  if (max_files == 0) {
+    DeleteFileW(path.c_str());
+    return;
+  }
+  DeleteFileW(RotatedPath(path, max_files).c_str());
+  for (uint32_t index = max_files - 1; index >= 1; --index) {
+    MoveFileExW(RotatedPath(path, index).c_str(), RotatedPath(path, index + 1).c_str(),
+                MOVEFILE_REPLACE_EXISTING);
+  }
+  MoveFileExW(path.c_str(), RotatedPath(path, 1).c_str(), MOVEFILE_REPLACE_EXISTING);
+}
+
+void CALLBACK McpLogBuffer::OnFlushTimer(PTP_CALLBACK_INSTANCE instance, PVOID context,
+                                         PTP_TIMER timer) {
+  static_cast<McpLogBuffer*>(context)->Flush();
+}
@@ -0,0 +1,149 @@
+#ifndef RUNNER_MCP_LOG_BUFFER_H_
+#define RUNNER_MCP_LOG_BUFFER_H_
+
+#include <windows.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class McpLogLevel {
+  kDebug,
+  kInfo,
+  kWarn,
+  kError,
+};
+
+// Returns the level named |name| ("debug", "info", "warn" or "warning",
+// "error"), or false.
+bool ParseMcpLogLevel(std::string_view name, McpLogLevel* level);
+const char* McpLogLevelName(McpLogLevel level);
+
+struct McpLogEntry {
+  uint64_t sequence;
+  // Milliseconds since the Unix epoch.
+  int64_t time_ms;
+  McpLogLevel level;
+  // Bridge process the line came from.
+  uint32_t pid;
+  std::string text;
+};
+
+// Process-wide log of bridge stderr.
+//
+// Lines are kept in a ring buffer bounded by entry count and bytes, so
+// getLogs can page through the recent ones without touching the disk. Each
+// process gets a token bucket of lines_per_second with a burst of twice
+// that; lines over it are counted and summed up in one warning when the
+// bucket refills, so a chatty MCP server costs a counter increment per line
+// rather than a write. Accepted lines are appended to a pending buffer that a
+// threadpool timer writes out kFileFlushDelay after the first, rotating the
+// file at max_file_bytes. Safe to call from any thread.
+class McpLogBuffer {
+ public:
+  struct Options {
+    size_t max_entries = 2000;
+    size_t max_bytes = 1024 * 1024;
+    // Per process; 0 disables rate limiting.
+    uint32_t lines_per_second = 200;
+    // Empty disables the file; defaults to asmbli-mcp-bridge.log in %TEMP%.
+    std::wstring file_path;
+    uint64_t max_file_bytes = 4 * 1024 * 1024;
+    // Rotated files kept next to the current one, as <file>.1 and so on.
+    uint32_t max_files = 3;
+  };
+
+  // Longer lines are cut here, and a partial line this long is logged
+  // without waiting for its newline.
+  static constexpr size_t kMaxLineBytes = 4096;
+
+  static constexpr std::chrono::milliseconds kFileFlushDelay{500};
+
+  // Returns the process-wide instance.
+  static McpLogBuffer& Get();
+
+  // Returns the default Options::file_path.
+  static std::wstring DefaultFilePath();
+
+  // Prevent copying.
+  McpLogBuffer(McpLogBuffer const&) = delete;
+  McpLogBuffer& operator=(McpLogBuffer const&) = delete;
+
+  // Takes effect for lines appended from now on; a new file_path starts a
+  // new file and leaves the old one where it is.
+  void Configure(const Options& options);
+
+  // Splits a stderr |chunk| of process |pid| into lines. |partial| holds the
+  // unterminated tail between calls and belongs to the caller's stream.
+  void AppendOutput(uint32_t pid, std::string_view chunk, std::string* partial);
+
+  // Logs one line without its newline. A leading "[level]" tag sets the
+  // level and is dropped; untagged lines get a level guessed from their
+  // wording.
+  void AppendLine(uint32_t pid, std::string_view line);
+
+  // Copies up to |limit| entries after sequence |after| at |min_level| or
+  // above into |entries|, oldest first. Returns the sequence to pass as
+  // |after| next time.
+  uint64_t Query(uint64_t after, McpLogLevel min_level, size_t limit,
+                 std::vector<McpLogEntry>* entries) const;
+
+  // Writes pending lines to the file now.
+  void Flush();
+
+  // Entries pushed out of the ring buffer, and lines dropped by rate
+  // limiting, since startup.
+  uint64_t evicted() const;
+  uint64_t suppressed() const;
+
+ private:
+  struct Source {
+    double tokens = 0;
+    std::chrono::steady_clock::time_point refilled;
+    uint64_t suppressed = 0;
+  };
+
+  McpLogBuffer();
+  ~McpLogBuffer();
+
+  // Spends a token of |pid|'s bucket. On success |*suppressed| is the count
+  // of lines dropped since the last accepted one.
+  bool TakeTokenLocked(uint32_t pid, uint64_t* suppressed);
+
+  void PushLocked(uint32_t pid, McpLogLevel level, std::string text);
+
+  // Writes |data| to options.file_path, rotating first if it would grow past
+  // max_file_bytes. Caller holds file_mutex_.
+  void WriteFileLocked(const Options& options, const std::string& data);
+  void RotateLocked(const std::wstring& path, uint32_t max_files);
+
+  static void CALLBACK OnFlushTimer(PTP_CALLBACK_INSTANCE instance, PVOID context,
+                                    PTP_TIMER timer);
+
+  mutable std::mutex mutex_;
+  Options options_;
+  std::deque<McpLogEntry> entries_;
+  size_t bytes_ = 0;
+  uint64_t next_sequence_ = 1;
+  uint64_t evicted_ = 0;
+  uint64_t suppressed_ = 0;
+  std::unordered_map<uint32_t, Source> sources_;
+
+  // Formatted lines waiting for the flush timer.
+  std::string pending_file_;
+  PTP_TIMER flush_timer_ = nullptr;
+  bool flush_timer_armed_ = false;
+
+  // Serializes file writes, so flushes land in order; taken before mutex_.
+  std::mutex file_mutex_;
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  std::wstring open_path_;
+  uint64_t file_bytes_ = 0;
+};
+
+#endif  // RUNNER_MCP_LOG_BUFFER_H_
@@ -0,0 +1,91 @@
+#ifndef RUNNER_MCP_METRICS_H_
+#define RUNNER_MCP_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Process-wide counters for the MCP transport, reported by getMetrics.
+//
+// Every field is a relaxed atomic, cheap enough to bump on the hot path from
+// any thread. Counters only grow; readers diff two snapshots for rates.
+struct McpMetrics {
+  using Counter = std::atomic<uint64_t>;
+
+  // Returns the process-wide instance.
+  static McpMetrics& Get() {
+    static McpMetrics metrics;
+    return metrics;
+  }
+
+  static void Add(Counter& counter, uint64_t value = 1) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  static uint64_t Read(const Counter& counter) {
+    return counter.load(std::memory_order_relaxed);
+  }
+
+  // Plugin to bridge: framed bytes and messages accepted by SendMessage,
+  // and sends that failed.
+  Counter bytes_sent{0};
+  Counter messages_sent{0};
+  Counter send_failures{0};
+
+  // Bridge to plugin: bytes read from stdout and messages framed from them.
+  Counter bytes_received{0};
+  Counter messages_received{0};
+
+  // Time spent splitting reads into messages, excluding the handlers, and
+  // scanning and decoding those messages.
+  Counter framing_ns{0};
+  Counter parse_ns{0};
+  Counter parse_errors{0};
+
+  // Request outcomes.
+  Counter requests_started{0};
+  Counter requests_succeeded{0};
+  Counter requests_failed{0};
+  Counter requests_cancelled{0};
+  Counter requests_timed_out{0};
+  // Refused because their server was at its concurrency limit with a full
+  // queue.
+  Counter requests_overloaded{0};
+
+  // Events handed to the EventSink, and events discarded because nobody was
+  // listening. Drops by a full queue are reported by the queue itself.
+  Counter events_delivered{0};
+  Counter events_unheard{0};
+
+  // Bridge processes restarted after exiting unexpectedly.
+  Counter process_restarts{0};
+
+  // McpResultCache lookups, and entries evicted to stay within its budget.
+  Counter result_cache_hits{0};
+  Counter result_cache_misses{0};
+  Counter result_cache_evictions{0};
+};
+
+// Adds the lifetime of the scope to |counter|, in nanoseconds.
+class McpScopedTimer {
+ public:
+  explicit McpScopedTimer(McpMetrics::Counter& counter)
+      : counter_(counter), start_(std::chrono::steady_clock::now()) {}
+
+  ~McpScopedTimer() {
+    McpMetrics::Add(counter_, static_cast<uint64_t>(
+                                  std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - start_)
+                                      .count()));
+  }
+
+  // Prevent copying.
+  McpScopedTimer(McpScopedTimer const&) = delete;
+  McpScopedTimer& operator=(McpScopedTimer const&) = delete;
+
+ private:
+  McpMetrics::Counter& counter_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#endif  // RUNNER_MCP_METRICS_H_
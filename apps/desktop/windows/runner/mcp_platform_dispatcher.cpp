@@ -0,0 +1,170 @@
+#include "mcp_platform_dispatcher.h"
+
+#include <iostream>
+
+namespace {
+
+constexpr const wchar_t kWindowClassName[] = L"ASMBLI_MCP_PLATFORM_DISPATCHER";
+
+// Posted by RequestFrame; the timer can only be armed by the window's thread.
+constexpr UINT kFrameRequestMessage = WM_APP + 1;
+// Posted when a task is queued while no batch is pending.
+constexpr UINT kRunTasksMessage = WM_APP + 2;
+constexpr UINT_PTR kFrameTimerId = 1;
+constexpr UINT_PTR kTickTimerId = 2;
+
+// About one display frame at 60 Hz.
+constexpr std::chrono::milliseconds kDefaultFrameInterval(16);
+
+// Returns the dispatcher window class, registering it on first use.
+const wchar_t* GetWindowClass(WNDPROC window_proc) {
+  static bool registered = [window_proc] {
+    WNDCLASSEX window_class{};
+    window_class.cbSize = sizeof(window_class);
+    window_class.lpfnWndProc = window_proc;
+    window_class.hInstance = GetModuleHandle(nullptr);
+    window_class.lpszClassName = kWindowClassName;
+    return RegisterClassEx(&window_class) != 0;
+  }();
+  return registered ? kWindowClassName : nullptr;
+}
+
+}  // namespace
+
+McpPlatformDispatcher::McpPlatformDispatcher()
+    : thread_id_(GetCurrentThreadId()), frame_interval_(kDefaultFrameInterval) {
+  const wchar_t* window_class = GetWindowClass(&McpPlatformDispatcher::WndProc);
+  if (window_class) {
+    window_ = CreateWindowEx(0, window_class, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr,
+                             GetModuleHandle(nullptr), this);
+  }
+  if (!window_) {
+    std::cerr << "Failed to create MCP dispatcher window: " << GetLastError() << std::endl;
+  }
+}
+
+McpPlatformDispatcher::~McpPlatformDispatcher() {
+  if (window_) {
+    DestroyWindow(window_);
+  }
+}
+
+void McpPlatformDispatcher::Post(Task task) {
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(tasks_mutex_);
+    wake = tasks_.empty();
+    tasks_.push_back(std::move(task));
+  }
+  if (wake && window_) {
+    PostMessage(window_, kRunTasksMessage, 0, 0);
+  }
+}
+
+bool McpPlatformDispatcher::RunsTasksOnCurrentThread() const {
+  return GetCurrentThreadId() == thread_id_;
+}
+
+void McpPlatformDispatcher::SetFrameCallback(std::function<void()> callback) {
+  frame_callback_ = std::move(callback);
+}
+
+void McpPlatformDispatcher::SetFrameInterval(std::chrono::milliseconds interval) {
+  if (interval == frame_interval_) {
+    return;
+  }
+  frame_interval_ = interval;
+  if (frame_timer_armed_) {
+    SetTimer(window_, kFrameTimerId, static_cast<UINT>(frame_interval_.count()), nullptr);
+  }
+}
+
+void McpPlatformDispatcher::RequestFrame() {
+  if (window_ && !frame_requested_.exchange(true)) {
+    PostMessage(window_, kFrameRequestMessage, 0, 0);
+  }
+}
+
+void McpPlatformDispatcher::StartTicking(std::chrono::milliseconds interval,
+                                         std::function<void()> callback) {
+  tick_callback_ = std::move(callback);
+  if (window_) {
+    SetTimer(window_, kTickTimerId, static_cast<UINT>(interval.count()), nullptr);
+  }
+}
+
+void McpPlatformDispatcher::StopTicking() {
+  if (window_) {
+    KillTimer(window_, kTickTimerId);
+  }
+  tick_callback_ = nullptr;
+}
+
+// static
+LRESULT CALLBACK McpPlatformDispatcher::WndProc(HWND const window, UINT const message,
+                                                WPARAM const wparam,
+                                                LPARAM const lparam) noexcept {
+  if (message == WM_NCCREATE) {
+    auto create_struct = reinterpret_cast<CREATESTRUCT*>(lparam);
+    SetWindowLongPtr(window, GWLP_USERDATA,
+                     reinterpret_cast<LONG_PTR>(create_struct->lpCreateParams));
+  } else if (auto* that = reinterpret_cast<McpPlatformDispatcher*>(
+                 GetWindowLongPtr(window, GWLP_USERDATA))) {
+    switch (message) {
+      case kRunTasksMessage:
+        that->RunTasks();
+        return 0;
+      case kFrameRequestMessage:
+        that->OnFrameRequested();
+        return 0;
+      case WM_TIMER:
+        if (wparam == kFrameTimerId) {
+          that->OnFrameTimer();
+          return 0;
+        }
+        if (wparam == kTickTimerId) {
+          that->OnTickTimer();
+          return 0;
+        }
+        break;
+    }
+  }
+  return DefWindowProc(window, message, wparam, lparam);
+}
+
+void McpPlatformDispatcher::RunTasks() {
+  {
+    std::lock_guard<std::mutex> lock(tasks_mutex_);
+    running_tasks_.swap(tasks_);
+  }
+  for (auto& task : running_tasks_) {
+    task();
+  }
+  running_tasks_.clear();
+}
+
+void McpPlatformDispatcher::OnFrameRequested() {
+  if (!frame_timer_armed_) {
+    frame_timer_armed_ = true;
+    SetTimer(window_, kFrameTimerId, static_cast<UINT>(frame_interval_.count()), nullptr);
+  }
+}
+
+void McpPlatformDispatcher::OnFrameTimer() {
+  KillTimer(window_, kFrameTimerId);
+  frame_timer_armed_ = false;
+  // Cleared before the callback so work queued while it runs requests the
+  // next frame.
+  frame_requested_ = false;
+  // Picks up tasks whose wakeup message could not be posted.
+  RunTasks();
+  if (frame_callback_) {
+    frame_callback_();
+  }
+}
+
+void McpPlatformDispatcher::OnTickTimer() {
+  if (tick_callback_) {
+    tick_callback_();
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef RUNNER_MCP_PLATFORM_DISPATCHER_H_
+#define RUNNER_MCP_PLATFORM_DISPATCHER_H_
+
+#include <windows.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Runs work on the platform thread on behalf of the bridge's I/O threads.
+//
+// The dispatcher owns a message-only window created on the thread that
+// constructs it, which must be the platform thread running the Win32 message
+// loop. The Flutter embedder requires MethodResult and EventSink calls on
+// that thread, so completions are Posted here rather than made in place.
+//
+// Posted tasks are drained in batches: only the first task posted to an idle
+// queue wakes the window, and one wakeup runs everything queued by then.
+// Separately, any thread may request a frame; the frame callback then runs
+// once the frame interval elapses, so everything requested within one
+// interval is handled together.
+class McpPlatformDispatcher {
+ public:
+  using Task = std::function<void()>;
+
+  McpPlatformDispatcher();
+  ~McpPlatformDispatcher();
+
+  // Prevent copying.
+  McpPlatformDispatcher(McpPlatformDispatcher const&) = delete;
+  McpPlatformDispatcher& operator=(McpPlatformDispatcher const&) = delete;
+
+  // False if the window could not be created. Tasks posted then are queued
+  // but never run, so owners must not start work that completes through
+  // Post.
+  bool IsValid() const { return window_ != nullptr; }
+
+  // Runs |task| on the platform thread, after the tasks posted before it.
+  // Never runs it in place, even on the platform thread. Safe to call from
+  // any thread.
+  void Post(Task task);
+
+  // True on the platform thread, where tasks run.
+  bool RunsTasksOnCurrentThread() const;
+
+  // Sets the callback run once per requested frame. Platform thread only.
+  void SetFrameCallback(std::function<void()> callback);
+
+  // Sets the time between a frame request and its callback. A frame already
+  // requested is rescheduled to the new interval. Platform thread only.
+  void SetFrameInterval(std::chrono::milliseconds interval);
+
+  // Schedules the frame callback. Safe to call from any thread; requests made
+  // before the callback runs share it.
+  void RequestFrame();
+
+  // Runs |callback| every |interval| until StopTicking, replacing any earlier
+  // tick callback. Platform thread only.
+  void StartTicking(std::chrono::milliseconds interval, std::function<void()> callback);
+  void StopTicking();
+
+ private:
+  static LRESULT CALLBACK WndProc(HWND const window, UINT const message, WPARAM const wparam,
+                                  LPARAM const lparam) noexcept;
+
+  void RunTasks();
+  void OnFrameRequested();
+  void OnFrameTimer();
+  void OnTickTimer();
+
+  HWND window_ = nullptr;
+  DWORD thread_id_;
+
+  std::mutex tasks_mutex_;
+  std::vector<Task> tasks_;
+  // Swapped with tasks_ to run a batch without holding the lock.
+  std::vector<Task> running_tasks_;
+
+  std::function<void()> frame_callback_;
+  std::chrono::milliseconds frame_interval_;
+  std::atomic<bool> frame_requested_{false};
+  bool frame_timer_armed_ = false;
+
+  std::function<void()> tick_callback_;
+};
+
+#endif  // RUNNER_MCP_PLATFORM_DISPATCHER_H_
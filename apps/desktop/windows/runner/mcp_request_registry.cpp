@@ -0,0 +1,103 @@
+#include "mcp_request_registry.h"
+
+McpRequestRegistry::McpRequestRegistry() {}
+
+McpRequestRegistry::~McpRequestRegistry() {}
+
+uint64_t McpRequestRegistry::AllocateId() {
+  return next_id_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void McpRequestRegistry::Insert(uint64_t id, McpPendingRequest request) {
+  Shard& shard = ShardFor(id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.requests.emplace(id, std::move(request));
+}
+
+bool McpRequestRegistry::Take(uint64_t id, McpPendingRequest* request) {
+  Shard& shard = ShardFor(id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.requests.find(id);
+  if (it == shard.requests.end()) {
+    return false;
+  }
+  *request = std::move(it->second);
+  shard.requests.erase(it);
+  return true;
+}
+
+bool McpRequestRegistry::Contains(uint64_t id) const {
+  const Shard& shard = ShardFor(id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.requests.find(id) != shard.requests.end();
+}
+
+bool McpRequestRegistry::TakeByRequestId(const std::string& request_id, uint64_t* id,
+                                         McpPendingRequest* request) {
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto it = shard.requests.begin(); it != shard.requests.end(); ++it) {
+      if (it->second.request_id == request_id) {
+        *id = it->first;
+        *request = std::move(it->second);
+        shard.requests.erase(it);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::vector<McpPendingRequest> McpRequestRegistry::TakeAll() {
+  std::vector<McpPendingRequest> requests;
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto& entry : shard.requests) {
+      requests.push_back(std::move(entry.second));
+    }
+    shard.requests.clear();
+  }
+  return requests;
+}
+
+std::vector<McpPendingRequest> McpRequestRegistry::TakeUnreplayable(size_t process_index,
+                                                                    uint32_t max_replays) {
+  std::vector<McpPendingRequest> requests;
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto it = shard.requests.begin(); it != shard.requests.end();) {
+      McpPendingRequest& request = it->second;
+      if (request.process_index != process_index) {
+        ++it;
+      } else if (!request.replay_message.empty() && request.replays < max_replays) {
+        ++request.replays;
+        ++it;
+      } else {
+        requests.push_back(std::move(request));
+        it = shard.requests.erase(it);
+      }
+    }
+  }
+  return requests;
+}
+
+void McpRequestRegistry::GetReplayMessages(size_t process_index,
+                                           std::vector<std::string>* messages) const {
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto& entry : shard.requests) {
+      if (entry.second.process_index == process_index && entry.second.replays > 0) {
+        messages->push_back(entry.second.replay_message);
+      }
+    }
+  }
+}
+
+size_t McpRequestRegistry::size() const {
+  size_t count = 0;
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    count += shard.requests.size();
+  }
+  return count;
+}
@@ -0,0 +1,149 @@
+#ifndef RUNNER_MCP_REQUEST_REGISTRY_H_
+#define RUNNER_MCP_REQUEST_REGISTRY_H_
+
+#include <flutter/encodable_value.h>
+#include <flutter/method_result.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A processBatch call, completed once every request in it has.
+struct McpPendingBatch {
+  std::string batch_id;
+  // Report each result as a batch_result event as it arrives, rather than
+  // all of them as one list at the end.
+  bool stream = false;
+
+  std::mutex mutex;
+  flutter::EncodableList results;
+  size_t remaining = 0;
+  // Completed with |results|; unused in stream mode.
+  std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result;
+};
+
+// A request sent to a bridge process and waiting for its response.
+struct McpPendingRequest {
+  std::string request_id;
+  // Key of the request in the registry and of its deadline; 0 until one is
+  // allocated.
+  uint64_t wire_id = 0;
+  // Pool slot the request was dispatched to, released on completion.
+  size_t process_index = 0;
+  std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result;
+
+  // Set instead of |result| for a request that is part of a batch, along
+  // with its position in the batch.
+  std::shared_ptr<McpPendingBatch> batch;
+  size_t batch_index = 0;
+
+  // The message as sent, kept only for idempotent requests so they can be
+  // sent again to a bridge restarted after a crash, and the number of times
+  // that has happened.
+  std::string replay_message;
+  uint32_t replays = 0;
+
+  // The McpLaneScheduler lane, as an McpPriority, whose slot the request
+  // holds until it completes; -1 if it holds none.
+  int lane = -1;
+
+  // The request's serverId. While |holds_server_slot|, the request counts
+  // against that server's McpConcurrencyLimiter limit; |sent_at| is when it
+  // was handed to a bridge, which starts the round trip the limit adapts to.
+  std::string server_id;
+  bool holds_server_slot = false;
+  std::chrono::steady_clock::time_point sent_at;
+
+  // Set for a processMessage call made with "chunked": true. Its
+  // MethodResult completed when the request was sent; the response follows
+  // as response_chunk events and a final response_complete event.
+  bool chunked = false;
+
+  // Set when the response goes straight to a Dart MethodResult, untouched,
+  // so it is transcoded from JSON to the channel's encoding without
+  // decoding it into an EncodableValue first; see McpCodecSerializer.
+  bool transcode = false;
+
+  // Where a successful response goes in McpResultCache, under |server_id|,
+  // for a call made with request.cache; |cache_key| is empty otherwise.
+  std::string cache_key;
+  std::string cache_tool;
+  int64_t cache_ttl_ms = 0;
+  uint64_t cache_generation = 0;
+};
+
+// The table of in-flight requests, keyed by the 64-bit wire id the bridge
+// echoes in every response.
+//
+// Ids come from a single atomic counter, so they increase monotonically and
+// spread round-robin over independently locked shards; concurrent callers
+// rarely touch the same lock. Locks are held only to insert or remove an
+// entry: callers Take the entry out and then decode the response and deliver
+// the result with no lock held.
+class McpRequestRegistry {
+ public:
+  McpRequestRegistry();
+  ~McpRequestRegistry();
+
+  // Prevent copying.
+  McpRequestRegistry(McpRequestRegistry const&) = delete;
+  McpRequestRegistry& operator=(McpRequestRegistry const&) = delete;
+
+  // Returns a fresh wire id, for messages that expect no response.
+  uint64_t AllocateId();
+
+  // Stores |request| under |id|, which must come from AllocateId. Lets the
+  // caller build the message, which carries the id, before registering.
+  void Insert(uint64_t id, McpPendingRequest request);
+
+  // Moves the entry for |id| into |request| and removes it. Returns false if
+  // there is none, e.g. because it already completed.
+  bool Take(uint64_t id, McpPendingRequest* request);
+
+  // True while the entry for |id| is pending.
+  bool Contains(uint64_t id) const;
+
+  // Like Take, but finds the entry by its Dart request id and also returns
+  // its wire id. Scans every shard, so it suits rare lookups like cancel.
+  bool TakeByRequestId(const std::string& request_id, uint64_t* id,
+                       McpPendingRequest* request);
+
+  // Removes and returns every entry, in no particular order.
+  std::vector<McpPendingRequest> TakeAll();
+
+  // After the bridge at |process_index| crashed: removes and returns its
+  // entries, except those with a replay message and fewer than
+  // |max_replays| replays, which stay and have a replay counted.
+  std::vector<McpPendingRequest> TakeUnreplayable(size_t process_index, uint32_t max_replays);
+
+  // Appends the replay messages of the entries TakeUnreplayable left on
+  // |process_index|; requests sent since are not included.
+  void GetReplayMessages(size_t process_index, std::vector<std::string>* messages) const;
+
+  // Number of entries; a snapshot that may be stale by the time it returns.
+  size_t size() const;
+
+ private:
+  static constexpr size_t kShardCount = 16;
+
+  // Each shard sits on its own cache line so neighbouring locks do not
+  // contend through false sharing.
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, McpPendingRequest> requests;
+  };
+
+  Shard& ShardFor(uint64_t id) { return shards_[id % kShardCount]; }
+  const Shard& ShardFor(uint64_t id) const { return shards_[id % kShardCount]; }
+
+  std::atomic<uint64_t> next_id_{1};
+  std::array<Shard, kShardCount> shards_;
+};
+
+#endif  // RUNNER_MCP_REQUEST_REGISTRY_H_
@@ -0,0 +1,143 @@
+#include "mcp_result_cache.h"
+
+#include <iterator>
+
+#include "mcp_json.h"
+#include "mcp_metrics.h"
+
+McpResultCache::McpResultCache() = default;
+
+McpResultCache::~McpResultCache() = default;
+
+void McpResultCache::Configure(size_t max_bytes, int64_t default_ttl_ms,
+                               std::unordered_map<std::string, int64_t> tool_ttls_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lru_.clear();
+  index_.clear();
+  bytes_ = 0;
+  ++generation_;
+  max_bytes_ = max_bytes;
+  default_ttl_ms_ = default_ttl_ms;
+  tool_ttls_ms_ = std::move(tool_ttls_ms);
+}
+
+int64_t McpResultCache::TtlFor(const std::string& tool) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = tool_ttls_ms_.find(tool);
+  return it != tool_ttls_ms_.end() ? it->second : default_ttl_ms_;
+}
+
+// static
+std::string McpResultCache::MakeKey(const std::string& server_id, const std::string& tool,
+                                    const flutter::EncodableMap& params) {
+  // Server ids and tool names hold no NULs, so the parts cannot run together.
+  std::string key = server_id;
+  key.push_back('\0');
+  key.append(tool);
+  key.push_back('\0');
+  AppendJson(params, &key);
+  return key;
+}
+
+bool McpResultCache::Lookup(const std::string& key, flutter::EncodableValue* value) {
+  McpMetrics& metrics = McpMetrics::Get();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(key);
+  if (found == index_.end()) {
+    McpMetrics::Add(metrics.result_cache_misses);
+    return false;
+  }
+  EntryList::iterator it = found->second;
+  if (it->expires_at <= Clock::now()) {
+    EraseLocked(it);
+    McpMetrics::Add(metrics.result_cache_misses);
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, it);
+  *value = it->value;
+  McpMetrics::Add(metrics.result_cache_hits);
+  return true;
+}
+
+uint64_t McpResultCache::generation() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return generation_;
+}
+
+void McpResultCache::Store(const std::string& key, const std::string& server_id,
+                           const std::string& tool, flutter::EncodableValue value,
+                           int64_t ttl_ms, uint64_t generation) {
+  if (ttl_ms <= 0) {
+    return;
+  }
+  size_t entry_bytes = key.size() + EstimateBytes(value);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (generation != generation_ || entry_bytes > max_bytes_) {
+    return;
+  }
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    EraseLocked(found->second);
+  }
+  while (!lru_.empty() && bytes_ + entry_bytes > max_bytes_) {
+    EraseLocked(std::prev(lru_.end()));
+    McpMetrics::Add(McpMetrics::Get().result_cache_evictions);
+  }
+  lru_.push_front(Entry{key, server_id, tool, std::move(value), entry_bytes,
+                        Clock::now() + std::chrono::milliseconds(ttl_ms)});
+  index_.emplace(key, lru_.begin());
+  bytes_ += entry_bytes;
+}
+
+void McpResultCache::Invalidate(const std::string& server_id, const std::string& tool) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++generation_;
+  for (auto it = lru_.begin(); it != lru_.end();) {
+    auto next = std::next(it);
+    if ((server_id.empty() || it->server_id == server_id) && (tool.empty() || it->tool == tool)) {
+      EraseLocked(it);
+    }
+    it = next;
+  }
+}
+
+void McpResultCache::Clear() {
+  Invalidate(std::string(), std::string());
+}
+
+size_t McpResultCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+size_t McpResultCache::entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return lru_.size();
+}
+
+// static
+size_t McpResultCache::EstimateBytes(const flutter::EncodableValue& value) {
+  size_t bytes = sizeof(flutter::EncodableValue);
+  if (const auto* text = std::get_if<std::string>(&value)) {
+    bytes += text->capacity();
+  } else if (const auto* data = std::get_if<std::vector<uint8_t>>(&value)) {
+    bytes += data->capacity();
+  } else if (const auto* list = std::get_if<flutter::EncodableList>(&value)) {
+    for (const auto& item : *list) {
+      bytes += EstimateBytes(item);
+    }
+  } else if (const auto* map = std::get_if<flutter::EncodableMap>(&value)) {
+    // Tree nodes carry three pointers and a color besides the pair.
+    for (const auto& entry : *map) {
+      bytes += 4 * sizeof(void*) + EstimateBytes(entry.first) + EstimateBytes(entry.second);
+    }
+  }
+  return bytes;
+}
+
+void McpResultCache::EraseLocked(EntryList::iterator it) {
+  bytes_ -= it->bytes;
+  index_.erase(it->key);
+  lru_.erase(it);
+}
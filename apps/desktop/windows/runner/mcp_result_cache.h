@@ -0,0 +1,99 @@
+#ifndef RUNNER_MCP_RESULT_CACHE_H_
+#define RUNNER_MCP_RESULT_CACHE_H_
+
+#include <flutter/encodable_value.h>
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Responses of read-only tool calls, kept so that repeating a call with the
+// same server, tool and params completes without a bridge round trip.
+//
+// Entries expire after their tool's TTL and are evicted least recently used
+// first once the cached responses exceed the byte budget. Invalidate drops
+// the entries of a server or tool and also discards every response that
+// was in flight when it ran, so a result computed before an invalidation is
+// never stored after it. Thread-safe.
+class McpResultCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t kDefaultMaxBytes = 16 * 1024 * 1024;
+  static constexpr int64_t kDefaultTtlMs = 30000;
+
+  McpResultCache();
+  ~McpResultCache();
+
+  // Prevent copying.
+  McpResultCache(McpResultCache const&) = delete;
+  McpResultCache& operator=(McpResultCache const&) = delete;
+
+  // Sets the byte budget and the TTL of tools without one in |tool_ttls_ms|.
+  // Drops every entry.
+  void Configure(size_t max_bytes, int64_t default_ttl_ms,
+                 std::unordered_map<std::string, int64_t> tool_ttls_ms);
+
+  // TTL of responses of |tool|; 0 means they are not cached.
+  int64_t TtlFor(const std::string& tool) const;
+
+  // The cache key of a call. |params| is serialized with its keys in
+  // EncodableValue order, so equal params give equal keys however the
+  // caller built them.
+  static std::string MakeKey(const std::string& server_id, const std::string& tool,
+                             const flutter::EncodableMap& params);
+
+  // Copies the live entry for |key| into |value| and marks it most recently
+  // used. Returns false on a miss.
+  bool Lookup(const std::string& key, flutter::EncodableValue* value);
+
+  // Returns the token a response must be stored with; see Store.
+  uint64_t generation() const;
+
+  // Caches |value| under |key| for |ttl_ms|, unless Invalidate or Clear ran
+  // since |generation| was read or the value alone exceeds the budget.
+  void Store(const std::string& key, const std::string& server_id, const std::string& tool,
+             flutter::EncodableValue value, int64_t ttl_ms, uint64_t generation);
+
+  // Drops the entries of |server_id| and |tool|; an empty argument matches
+  // every server or tool.
+  void Invalidate(const std::string& server_id, const std::string& tool);
+
+  void Clear();
+
+  size_t bytes() const;
+  size_t entries() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string server_id;
+    std::string tool;
+    flutter::EncodableValue value;
+    size_t bytes = 0;
+    Clock::time_point expires_at;
+  };
+  using EntryList = std::list<Entry>;
+
+  // Approximate heap footprint of |value|.
+  static size_t EstimateBytes(const flutter::EncodableValue& value);
+
+  // mutex_ must be held.
+  void EraseLocked(EntryList::iterator it);
+
+  mutable std::mutex mutex_;
+  // Most recently used first.
+  EntryList lru_;
+  std::unordered_map<std::string, EntryList::iterator> index_;
+  size_t bytes_ = 0;
+  uint64_t generation_ = 0;
+
+  size_t max_bytes_ = kDefaultMaxBytes;
+  int64_t default_ttl_ms_ = kDefaultTtlMs;
+  std::unordered_map<std::string, int64_t> tool_ttls_ms_;
+};
+
+#endif  // RUNNER_MCP_RESULT_CACHE_H_
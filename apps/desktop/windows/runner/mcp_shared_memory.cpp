@@ -0,0 +1,80 @@
+#include "mcp_shared_memory.h"
+
+#include <atomic>
+
+#include "utils.h"
+
+McpSharedMemory::McpSharedMemory() {}
+
+McpSharedMemory::~McpSharedMemory() {
+  Close();
+}
+
+bool McpSharedMemory::Create(size_t capacity) {
+  Close();
+
+  static std::atomic<unsigned int> region_serial{0};
+  wchar_t temp_dir[MAX_PATH];
+  DWORD length = GetTempPathW(MAX_PATH, temp_dir);
+  if (length == 0 || length >= MAX_PATH) {
+    return false;
+  }
+  std::wstring path = std::wstring(temp_dir, length) + L"asmbli-mcp-" +
+                      std::to_wstring(GetCurrentProcessId()) + L"-" +
+                      std::to_wstring(region_serial++) + L".shm";
+  path_ = Utf8FromUtf16(path.c_str());
+
+  // The bridge opens the file too, so sharing must allow its writes and the
+  // delete-on-close that removes the file once both sides are done.
+  file_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS,
+                      FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    Close();
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  size.QuadPart = static_cast<LONGLONG>(capacity);
+  if (!SetFilePointerEx(file_, size, NULL, FILE_BEGIN) || !SetEndOfFile(file_)) {
+    Close();
+    return false;
+  }
+
+  mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping_) {
+    Close();
+    return false;
+  }
+  view_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (!view_) {
+    Close();
+    return false;
+  }
+  capacity_ = capacity;
+  return true;
+}
+
+void McpSharedMemory::Close() {
+  if (view_) {
+    UnmapViewOfFile(view_);
+    view_ = nullptr;
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+  if (file_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+  }
+  capacity_ = 0;
+}
+
+bool McpSharedMemory::View(uint64_t offset, uint64_t length, std::string_view* view) const {
+  if (!view_ || offset > capacity_ || length > capacity_ - offset) {
+    return false;
+  }
+  *view = std::string_view(view_ + offset, static_cast<size_t>(length));
+  return true;
+}
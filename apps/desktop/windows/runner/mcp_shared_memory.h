@@ -0,0 +1,53 @@
+#ifndef RUNNER_MCP_SHARED_MEMORY_H_
+#define RUNNER_MCP_SHARED_MEMORY_H_
+
+#include <windows.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// The region a bridge writes large payloads to instead of its stdout pipe.
+//
+// Node has no API for named file mappings, so the region is a temporary
+// file: the bridge writes it with positioned fs writes and the plugin maps
+// it read-only. Windows keeps mapped views and file writes of a local file
+// coherent through the cache manager, and the file is temporary and deleted
+// on close, so data normally stays in memory. The bridge owns the ring
+// allocation and announces each payload with a kShared frame (see
+// mcp_framing.h); the plugin returns regions with $/releaseShared.
+class McpSharedMemory {
+ public:
+  static constexpr size_t kDefaultCapacity = 64 * 1024 * 1024;
+
+  McpSharedMemory();
+  ~McpSharedMemory();
+
+  // Prevent copying.
+  McpSharedMemory(McpSharedMemory const&) = delete;
+  McpSharedMemory& operator=(McpSharedMemory const&) = delete;
+
+  // Creates and maps a new region of |capacity| bytes. Returns false, leaving
+  // the region closed, if any step fails.
+  bool Create(size_t capacity);
+  void Close();
+
+  bool is_open() const { return view_ != nullptr; }
+
+  // Path the bridge opens to write the region, in UTF-8.
+  const std::string& path() const { return path_; }
+  size_t capacity() const { return capacity_; }
+
+  // Points |view| at the |length| bytes at |offset|. Returns false if that
+  // range is not inside the region.
+  bool View(uint64_t offset, uint64_t length, std::string_view* view) const;
+
+ private:
+  std::string path_;
+  size_t capacity_ = 0;
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+  const char* view_ = nullptr;
+};
+
+#endif  // RUNNER_MCP_SHARED_MEMORY_H_
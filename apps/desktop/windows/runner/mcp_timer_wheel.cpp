@@ -0,0 +1,75 @@
+#include "mcp_timer_wheel.h"
+
+#include <algorithm>
+
+McpTimerWheel::McpTimerWheel(std::chrono::milliseconds tick)
+    : tick_(std::max(tick, std::chrono::milliseconds(1))), start_(Clock::now()) {}
+
+void McpTimerWheel::Schedule(uint64_t key, std::chrono::milliseconds delay) {
+  // Count from the present even if Advance has fallen behind it.
+  uint64_t now_tick = static_cast<uint64_t>((Clock::now() - start_) / tick_);
+  uint64_t ticks = static_cast<uint64_t>((delay + tick_ - std::chrono::milliseconds(1)) / tick_);
+  ticks = std::clamp<uint64_t>(ticks, 1, kMaxDelayTicks - (now_tick - current_tick_));
+  Cancel(key);
+  Insert(Timer{key, now_tick + ticks});
+}
+
+bool McpTimerWheel::Cancel(uint64_t key) {
+  auto it = locations_.find(key);
+  if (it == locations_.end()) {
+    return false;
+  }
+  Location location = it->second;
+  locations_.erase(it);
+  // Fill the hole with the slot's last timer; order within a slot is free.
+  Slot& slot = levels_[location.level][location.slot];
+  if (location.index + 1 < slot.size()) {
+    slot[location.index] = slot.back();
+    locations_[slot[location.index].key].index = location.index;
+  }
+  slot.pop_back();
+  return true;
+}
+
+void McpTimerWheel::Advance(Clock::time_point now, std::vector<uint64_t>* expired) {
+  uint64_t target_tick = static_cast<uint64_t>((now - start_) / tick_);
+  while (current_tick_ < target_tick) {
+    ++current_tick_;
+    // Higher levels first, so a timer can fall through several levels in one
+    // tick.
+    for (int level = kLevels - 1; level > 0; --level) {
+      uint64_t level_mask = (uint64_t{1} << (level * kSlotBits)) - 1;
+      if ((current_tick_ & level_mask) == 0) {
+        Cascade(level);
+      }
+    }
+    Slot& slot = levels_[0][current_tick_ & kSlotMask];
+    for (const Timer& timer : slot) {
+      expired->push_back(timer.key);
+      locations_.erase(timer.key);
+    }
+    slot.clear();
+  }
+}
+
+void McpTimerWheel::Insert(const Timer& timer) {
+  // A timer sits in the finest level whose span still reaches its deadline.
+  // Its slot comes around exactly when the deadline enters the level below.
+  uint64_t delta = timer.deadline - current_tick_;
+  int level = 0;
+  while (level < kLevels - 1 && delta >= (uint64_t{1} << ((level + 1) * kSlotBits))) {
+    ++level;
+  }
+  uint64_t slot_index = (timer.deadline >> (level * kSlotBits)) & kSlotMask;
+  Slot& slot = levels_[level][slot_index];
+  slot.push_back(timer);
+  locations_[timer.key] = Location{level, slot_index, slot.size() - 1};
+}
+
+void McpTimerWheel::Cascade(int level) {
+  Slot timers;
+  timers.swap(levels_[level][(current_tick_ >> (level * kSlotBits)) & kSlotMask]);
+  for (const Timer& timer : timers) {
+    Insert(timer);
+  }
+}
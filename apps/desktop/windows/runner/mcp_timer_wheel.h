@@ -0,0 +1,78 @@
+#ifndef RUNNER_MCP_TIMER_WHEEL_H_
+#define RUNNER_MCP_TIMER_WHEEL_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Deadlines for pending requests, kept in a hierarchical timer wheel.
+//
+// Four levels of 64 slots each cover 64, 64^2, 64^3 and 64^4 ticks; a timer
+// lives in the coarsest slot that still separates it from the present and
+// cascades down a level each time its slot comes around. Scheduling and
+// expiring are O(1) per timer however many are outstanding.
+//
+// Every key's slot and position in it are indexed, so a request that
+// completes can take its timer out in O(1) too, and an idle wheel really is
+// empty. Not thread-safe.
+class McpTimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit McpTimerWheel(std::chrono::milliseconds tick);
+
+  // Prevent copying.
+  McpTimerWheel(McpTimerWheel const&) = delete;
+  McpTimerWheel& operator=(McpTimerWheel const&) = delete;
+
+  // Fires |key| once |delay| has passed, rounded up to whole ticks. Delays
+  // beyond the wheel's span are clamped to it. Replaces any timer of |key|.
+  void Schedule(uint64_t key, std::chrono::milliseconds delay);
+
+  // Removes the timer of |key|. Returns false if there is none, as when it
+  // already expired.
+  bool Cancel(uint64_t key);
+
+  // Moves the wheel forward to |now| and appends the keys of every timer that
+  // expired on the way to |expired|.
+  void Advance(Clock::time_point now, std::vector<uint64_t>* expired);
+
+  // True if no timer is outstanding.
+  bool empty() const { return locations_.empty(); }
+
+ private:
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotBits = 6;
+  static constexpr uint64_t kSlots = uint64_t{1} << kSlotBits;
+  static constexpr uint64_t kSlotMask = kSlots - 1;
+  // Longest delay the wheel can represent, in ticks.
+  static constexpr uint64_t kMaxDelayTicks = (uint64_t{1} << (kLevels * kSlotBits)) - 1;
+
+  struct Timer {
+    uint64_t key;
+    uint64_t deadline;
+  };
+  using Slot = std::vector<Timer>;
+
+  // Where a timer sits: levels_[level][slot][index].
+  struct Location {
+    int level;
+    uint64_t slot;
+    size_t index;
+  };
+
+  void Insert(const Timer& timer);
+  // Redistributes the slot of |level| that the current tick has reached.
+  void Cascade(int level);
+
+  std::chrono::milliseconds tick_;
+  Clock::time_point start_;
+  // Ticks processed so far since |start_|.
+  uint64_t current_tick_ = 0;
+  std::unordered_map<uint64_t, Location> locations_;
+  std::array<std::array<Slot, kSlots>, kLevels> levels_;
+};
+
+#endif  // RUNNER_MCP_TIMER_WHEEL_H_
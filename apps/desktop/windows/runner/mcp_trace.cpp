@@ -0,0 +1,164 @@
+#include "mcp_trace.h"
+
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+
+#include <algorithm>
+
+#include "mcp_json.h"
+
+// {b95f4e11-fbf2-4754-9575-22ab38a6f066}
+TRACELOGGING_DEFINE_PROVIDER(g_mcp_trace_provider, "Asmbli.Mcp",
+                             (0xb95f4e11, 0xfbf2, 0x4754, 0x95, 0x75, 0x22, 0xab, 0x38, 0xa6,
+                              0xf0, 0x66));
+
+namespace {
+
+int64_t ToMicroseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+}  // namespace
+
+// static
+McpTrace& McpTrace::Get() {
+  static McpTrace trace;
+  return trace;
+}
+
+McpTrace::McpTrace() : origin_(Clock::now()) {}
+
+McpTrace::~McpTrace() {
+  if (etw_registered_) {
+    TraceLoggingUnregister(g_mcp_trace_provider);
+  }
+}
+
+void McpTrace::SetMode(McpTraceMode mode, size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (mode == McpTraceMode::kEtw && !etw_registered_) {
+    etw_registered_ = SUCCEEDED(TraceLoggingRegister(g_mcp_trace_provider));
+    if (!etw_registered_) {
+      mode = McpTraceMode::kOff;
+    }
+  }
+  if (mode == McpTraceMode::kChromeTrace) {
+    spans_.clear();
+    spans_.resize(std::max<size_t>(capacity, 1));
+  } else {
+    std::vector<Span>().swap(spans_);
+  }
+  next_ = 0;
+  size_ = 0;
+  overwritten_ = 0;
+  mode_.store(mode, std::memory_order_relaxed);
+}
+
+void McpTrace::Record(const char* name, Clock::time_point start, Clock::time_point end,
+                      uint64_t id, std::string_view detail) {
+  RecordOnThread(name, GetCurrentThreadId(), start, end, id, detail);
+}
+
+void McpTrace::RecordBridge(const char* name, size_t process_index, Clock::time_point start,
+                            Clock::time_point end, uint64_t id) {
+  RecordOnThread(name, kBridgeThreadBase + static_cast<uint32_t>(process_index), start, end, id,
+                 {});
+}
+
+void McpTrace::RecordOnThread(const char* name, uint32_t thread_id, Clock::time_point start,
+                              Clock::time_point end, uint64_t id, std::string_view detail) {
+  McpTraceMode mode = mode_.load(std::memory_order_relaxed);
+  if (mode == McpTraceMode::kEtw) {
+    // TraceLogging stamps the event itself; the span's own start goes with it
+    // so WPA can place it.
+    TraceLoggingWrite(g_mcp_trace_provider, "Span",
+                      TraceLoggingString(name, "Name"),
+                      TraceLoggingUInt64(id, "Id"),
+                      TraceLoggingUInt32(thread_id, "Thread"),
+                      TraceLoggingInt64(ToMicroseconds(start - origin_), "StartUs"),
+                      TraceLoggingInt64(ToMicroseconds(end - start), "DurationUs"),
+                      TraceLoggingCountedString(detail.data(), static_cast<USHORT>(std::min<size_t>(
+                                                                   detail.size(), 0xffff)),
+                                                "Detail"));
+    return;
+  }
+  if (mode != McpTraceMode::kChromeTrace) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (spans_.empty()) {
+    return;
+  }
+  Span& span = spans_[next_];
+  span.name = name;
+  span.thread_id = thread_id;
+  span.start_us = ToMicroseconds(start - origin_);
+  span.duration_us = ToMicroseconds(end - start);
+  span.id = id;
+  span.detail.assign(detail.data(), detail.size());
+  next_ = (next_ + 1) % spans_.size();
+  if (size_ < spans_.size()) {
+    ++size_;
+  } else {
+    ++overwritten_;
+  }
+}
+
+uint64_t McpTrace::Flush(std::string* out) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string pid = std::to_string(GetCurrentProcessId());
+  std::vector<uint32_t> bridge_threads;
+
+  out->append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  const size_t first = (next_ + spans_.size() - size_) % std::max<size_t>(spans_.size(), 1);
+  for (size_t i = 0; i < size_; ++i) {
+    const Span& span = spans_[(first + i) % spans_.size()];
+    if (i > 0) {
+      out->push_back(',');
+    }
+    out->append("{\"ph\":\"X\",\"cat\":\"mcp\",\"name\":");
+    AppendJsonString(span.name, out);
+    out->append(",\"pid\":");
+    out->append(pid);
+    out->append(",\"tid\":");
+    out->append(std::to_string(span.thread_id));
+    out->append(",\"ts\":");
+    out->append(std::to_string(span.start_us));
+    out->append(",\"dur\":");
+    out->append(std::to_string(span.duration_us));
+    out->append(",\"args\":{\"id\":");
+    out->append(std::to_string(span.id));
+    if (!span.detail.empty()) {
+      out->append(",\"detail\":");
+      AppendJsonString(span.detail, out);
+    }
+    out->append("}}");
+    if (span.thread_id >= kBridgeThreadBase &&
+        std::find(bridge_threads.begin(), bridge_threads.end(), span.thread_id) ==
+            bridge_threads.end()) {
+      bridge_threads.push_back(span.thread_id);
+    }
+  }
+
+  // Bridge spans sit on synthetic threads; name them after their pool slot.
+  for (uint32_t thread_id : bridge_threads) {
+    if (size_ > 0) {
+      out->push_back(',');
+    }
+    out->append("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":");
+    out->append(pid);
+    out->append(",\"tid\":");
+    out->append(std::to_string(thread_id));
+    out->append(",\"args\":{\"name\":\"mcp_bridge ");
+    out->append(std::to_string(thread_id - kBridgeThreadBase));
+    out->append("\"}}");
+  }
+  out->append("]}");
+
+  uint64_t overwritten = overwritten_;
+  next_ = 0;
+  size_ = 0;
+  overwritten_ = 0;
+  return overwritten;
+}
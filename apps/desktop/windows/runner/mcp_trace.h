@@ -0,0 +1,128 @@
+#ifndef RUNNER_MCP_TRACE_H_
+#define RUNNER_MCP_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Where McpTrace sends finished spans.
+enum class McpTraceMode {
+  kOff,
+  // Kept in a ring buffer and returned as Chrome trace-event JSON by Flush,
+  // for chrome://tracing or Perfetto.
+  kChromeTrace,
+  // Written as TraceLogging events of the Asmbli.Mcp provider, for WPR/WPA.
+  kEtw,
+};
+
+// Process-wide recorder of request lifecycle spans.
+//
+// Tracing is off by default, and a disabled McpTraceSpan costs one relaxed
+// atomic load. Spans carry the wire id of the request they belong to, so the
+// method call, serialization, pipe writes, bridge processing, framing,
+// parsing and result delivery of one request line up in the viewer.
+class McpTrace {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t kDefaultCapacity = 65536;
+
+  // Thread ids at and above this are the bridge processes, one per pool slot;
+  // their spans come from the processingUs the bridge reports.
+  static constexpr uint32_t kBridgeThreadBase = 0x40000000;
+
+  // Returns the process-wide instance.
+  static McpTrace& Get();
+
+  static bool enabled() {
+    return Get().mode_.load(std::memory_order_relaxed) != McpTraceMode::kOff;
+  }
+
+  // Switches mode. Spans recorded under a previous kChromeTrace mode are
+  // discarded; |capacity| is the number of spans the ring buffer keeps.
+  void SetMode(McpTraceMode mode, size_t capacity = kDefaultCapacity);
+
+  McpTraceMode mode() const { return mode_.load(std::memory_order_relaxed); }
+
+  // Records a span on the calling thread. |name| must outlive the trace,
+  // which in practice means a string literal; |detail| is copied.
+  void Record(const char* name, Clock::time_point start, Clock::time_point end, uint64_t id,
+              std::string_view detail = {});
+
+  // Records a span on the bridge thread of pool slot |process_index|.
+  void RecordBridge(const char* name, size_t process_index, Clock::time_point start,
+                    Clock::time_point end, uint64_t id);
+
+  // Appends the buffered spans, oldest first, to |out| as a Chrome trace
+  // JSON object and empties the buffer. Returns the number of spans that
+  // were overwritten since the last flush because the buffer was full.
+  uint64_t Flush(std::string* out);
+
+ private:
+  struct Span {
+    const char* name = nullptr;
+    uint32_t thread_id = 0;
+    int64_t start_us = 0;
+    int64_t duration_us = 0;
+    uint64_t id = 0;
+    std::string detail;
+  };
+
+  McpTrace();
+  ~McpTrace();
+
+  void RecordOnThread(const char* name, uint32_t thread_id, Clock::time_point start,
+                      Clock::time_point end, uint64_t id, std::string_view detail);
+
+  std::atomic<McpTraceMode> mode_{McpTraceMode::kOff};
+  const Clock::time_point origin_;
+
+  std::mutex mutex_;
+  // Ring buffer; next_ is where the next span goes and size_ how many are
+  // valid.
+  std::vector<Span> spans_;
+  size_t next_ = 0;
+  size_t size_ = 0;
+  uint64_t overwritten_ = 0;
+  bool etw_registered_ = false;
+};
+
+// Records the lifetime of the enclosing scope as a span when tracing is on.
+class McpTraceSpan {
+ public:
+  explicit McpTraceSpan(const char* name, uint64_t id = 0)
+      : name_(name), id_(id), active_(McpTrace::enabled()) {
+    if (active_) {
+      start_ = McpTrace::Clock::now();
+    }
+  }
+
+  ~McpTraceSpan() {
+    if (active_) {
+      McpTrace::Get().Record(name_, start_, McpTrace::Clock::now(), id_, detail_);
+    }
+  }
+
+  // Prevent copying.
+  McpTraceSpan(McpTraceSpan const&) = delete;
+  McpTraceSpan& operator=(McpTraceSpan const&) = delete;
+
+  // For spans whose request is only known partway through.
+  void set_id(uint64_t id) { id_ = id; }
+
+  // |detail| must outlive the span.
+  void set_detail(std::string_view detail) { detail_ = detail; }
+
+ private:
+  const char* name_;
+  uint64_t id_;
+  bool active_;
+  std::string_view detail_;
+  McpTrace::Clock::time_point start_;
+};
+
+#endif  // RUNNER_MCP_TRACE_H_
@@ -0,0 +1,596 @@
+#include "node_js_process.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "mcp_log_buffer.h"
+#include "mcp_metrics.h"
+#include "mcp_trace.h"
+
+namespace {
+
+// Kernel buffer for each pipe direction.
+constexpr DWORD kPipeBufferSize = 64 * 1024;
+
+// Each stdout read asks the framer for at least this much room and accepts
+// up to kMaxReadSize when it has more.
+constexpr size_t kMinReadSize = 4096;
+constexpr size_t kMaxReadSize = 1024 * 1024;
+
+// Default size at which a batch is written without waiting out the flush
+// latency.
+constexpr size_t kDefaultMaxBatchBytes = 256 * 1024;
+
+uint64_t ReadUint64(const char* data) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i) {
+    value = (value << 8) | static_cast<uint8_t>(data[i]);
+  }
+  return value;
+}
+
+// Path of the startup snapshot built from |script_path| with
+// node --snapshot-blob <path> --build-snapshot, or empty if there is none.
+std::string GetSnapshotBlobPath(const std::string& script_path) {
+  std::string blob_path = script_path;
+  size_t extension = blob_path.find_last_of('.');
+  size_t separator = blob_path.find_last_of("\\/");
+  if (extension != std::string::npos &&
+      (separator == std::string::npos || extension > separator)) {
+    blob_path.erase(extension);
+  }
+  blob_path.append(".snapshot.blob");
+  DWORD attributes = GetFileAttributesA(blob_path.c_str());
+  if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+    return std::string();
+  }
+  return blob_path;
+}
+
+// Creates a connected pipe whose parent end is opened for overlapped I/O and
+// whose child end is inheritable and synchronous, as Node.js expects for its
+// stdio. |parent_reads| selects the direction of the data.
+bool CreateOverlappedPipe(bool parent_reads, HANDLE* parent_end, HANDLE* child_end) {
+  static std::atomic<unsigned int> pipe_serial{0};
+  std::string name = "\\\\.\\pipe\\asmbli-mcp-" + std::to_string(GetCurrentProcessId()) +
+                     "-" + std::to_string(pipe_serial++);
+
+  DWORD open_mode = (parent_reads ? PIPE_ACCESS_INBOUND : PIPE_ACCESS_OUTBOUND) |
+                    FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE;
+  *parent_end = CreateNamedPipeA(name.c_str(), open_mode,
+                                 PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+                                     PIPE_REJECT_REMOTE_CLIENTS,
+                                 1, kPipeBufferSize, kPipeBufferSize, 0, NULL);
+  if (*parent_end == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  SECURITY_ATTRIBUTES security_attributes;
+  security_attributes.nLength = sizeof(SECURITY_ATTRIBUTES);
+  security_attributes.bInheritHandle = TRUE;
+  security_attributes.lpSecurityDescriptor = NULL;
+
+  // The extra attribute right lets libuv adjust the pipe mode on its end.
+  DWORD access = parent_reads ? (GENERIC_WRITE | FILE_READ_ATTRIBUTES)
+                              : (GENERIC_READ | FILE_WRITE_ATTRIBUTES);
+  *child_end = CreateFileA(name.c_str(), access, 0, &security_attributes, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+  if (*child_end == INVALID_HANDLE_VALUE) {
+    CloseHandle(*parent_end);
+    *parent_end = INVALID_HANDLE_VALUE;
+    return false;
+  }
+  return true;
+}
+
+void CloseIfValid(HANDLE* handle) {
+  if (*handle != INVALID_HANDLE_VALUE) {
+    CloseHandle(*handle);
+    *handle = INVALID_HANDLE_VALUE;
+  }
+}
+
+}  // namespace
+
+NodeJsProcess::NodeJsProcess()
+    : child_stdin_write_(INVALID_HANDLE_VALUE),
+      child_stdout_read_(INVALID_HANDLE_VALUE),
+      child_stderr_read_(INVALID_HANDLE_VALUE),
+      is_running_(false),
+      pipe_broken_(false),
+      outbound_framing_(McpFraming::kNewlineDelimited),
+      max_batch_bytes_(kDefaultMaxBatchBytes) {
+  ZeroMemory(&process_info_, sizeof(process_info_));
+  flush_timer_ = CreateThreadpoolTimer(&NodeJsProcess::OnFlushTimer, this, nullptr);
+  output_read_.on_complete = [this](DWORD bytes, DWORD error) { OnOutputRead(bytes, error); };
+  error_read_.on_complete = [this](DWORD bytes, DWORD error) { OnErrorRead(bytes, error); };
+  write_op_.on_complete = [this](DWORD bytes, DWORD error) { OnWriteComplete(bytes, error); };
+}
+
+NodeJsProcess::~NodeJsProcess() {
+  Stop();
+  if (flush_timer_) {
+    CloseThreadpoolTimer(flush_timer_);
+  }
+}
+
+bool NodeJsProcess::Start(const std::string& script_path) {
+  if (is_running_) {
+    return true;
+  }
+
+  HANDLE child_stdout_write, child_stdin_read, child_stderr_write;
+
+  // Create pipes
+  if (!CreateOverlappedPipe(true, &child_stdout_read_, &child_stdout_write)) {
+    return false;
+  }
+  if (!CreateOverlappedPipe(false, &child_stdin_write_, &child_stdin_read)) {
+    CloseHandle(child_stdout_write);
+    CloseIfValid(&child_stdout_read_);
+    return false;
+  }
+  if (!CreateOverlappedPipe(true, &child_stderr_read_, &child_stderr_write)) {
+    CloseHandle(child_stdout_write);
+    CloseHandle(child_stdin_read);
+    CloseIfValid(&child_stdout_read_);
+    CloseIfValid(&child_stdin_write_);
+    return false;
+  }
+
+  McpIoCompletionPort& port = McpIoCompletionPort::GetInstance();
+  bool associated = port.Associate(child_stdout_read_) && port.Associate(child_stdin_write_) &&
+                    port.Associate(child_stderr_read_);
+
+  // Create the Node.js process
+  STARTUPINFOA startup_info;
+  ZeroMemory(&startup_info, sizeof(startup_info));
+  startup_info.cb = sizeof(startup_info);
+  startup_info.hStdOutput = child_stdout_write;
+  startup_info.hStdError = child_stderr_write;
+  startup_info.hStdInput = child_stdin_read;
+  startup_info.dwFlags |= STARTF_USESTDHANDLES;
+
+  std::string command = "node ";
+  std::string snapshot_blob = GetSnapshotBlobPath(script_path);
+  if (!snapshot_blob.empty()) {
+    command += "--snapshot-blob \"" + snapshot_blob + "\" ";
+  }
+  command += "\"" + script_path + "\"";
+
+  std::unique_lock<std::mutex> process_lock(process_mutex_);
+  bool created = associated &&
+                 CreateProcessA(NULL, const_cast<char*>(command.c_str()), NULL, NULL, TRUE,
+                                CREATE_NO_WINDOW, NULL, NULL, &startup_info, &process_info_);
+  if (created && efficiency_mode_) {
+    ApplyEfficiencyModeLocked();
+  }
+  process_lock.unlock();
+
+  // Close handles not needed by parent
+  CloseHandle(child_stdout_write);
+  CloseHandle(child_stdin_read);
+  CloseHandle(child_stderr_write);
+
+  if (!created) {
+    CloseIfValid(&child_stdout_read_);
+    CloseIfValid(&child_stdin_write_);
+    CloseIfValid(&child_stderr_read_);
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    stopping_ = false;
+  }
+  output_framer_ = std::make_unique<McpMessageFramer>();
+  pid_ = process_info_.dwProcessId;
+  error_partial_.clear();
+  // A new bridge reads newline-delimited JSON until it acknowledges more.
+  outbound_framing_ = McpFraming::kNewlineDelimited;
+  pipe_broken_ = false;
+  is_running_ = true;
+
+  // Keep a read outstanding on each output pipe from now on.
+  if (!IssueOutputRead() || !IssueErrorRead()) {
+    Stop();
+    return false;
+  }
+
+  if (!RegisterWaitForSingleObject(&exit_wait_, process_info_.hProcess,
+                                   &NodeJsProcess::OnProcessExit, this, INFINITE,
+                                   WT_EXECUTEONLYONCE)) {
+    // Still usable; a crash then only shows up as a broken pipe.
+    exit_wait_ = nullptr;
+    std::cerr << "Failed to watch Node.js process for exit: " << GetLastError() << std::endl;
+  }
+
+  return true;
+}
+
+void NodeJsProcess::Stop() {
+  if (!is_running_.exchange(false)) {
+    return;
+  }
+
+  // Stop watching first, so terminating the process below is not reported
+  // as an exit; this also waits out an exit callback already running.
+  if (exit_wait_) {
+    UnregisterWaitEx(exit_wait_, INVALID_HANDLE_VALUE);
+    exit_wait_ = nullptr;
+  }
+
+  // Terminate the process
+  {
+    std::lock_guard<std::mutex> lock(process_mutex_);
+    if (process_info_.hProcess) {
+      TerminateProcess(process_info_.hProcess, 0);
+      CloseHandle(process_info_.hProcess);
+      CloseHandle(process_info_.hThread);
+      ZeroMemory(&process_info_, sizeof(process_info_));
+    }
+  }
+
+  // Cancel outstanding I/O and wait for every completion to be delivered
+  // before the pipes and buffers it refers to go away. A pending flush timer
+  // is cancelled too; a callback already running finds stopping_ set.
+  {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    stopping_ = true;
+  }
+  if (flush_timer_) {
+    SetThreadpoolTimer(flush_timer_, nullptr, 0, 0);
+    WaitForThreadpoolTimerCallbacks(flush_timer_, TRUE);
+  }
+  CancelIoEx(child_stdin_write_, NULL);
+  CancelIoEx(child_stdout_read_, NULL);
+  CancelIoEx(child_stderr_read_, NULL);
+  {
+    std::unique_lock<std::mutex> lock(io_mutex_);
+    io_idle_.wait(lock, [this] { return outstanding_io_ == 0; });
+  }
+
+  // Close pipes
+  CloseIfValid(&child_stdin_write_);
+  CloseIfValid(&child_stdout_read_);
+  CloseIfValid(&child_stderr_read_);
+  {
+    std::lock_guard<std::mutex> lock(shared_memory_mutex_);
+    shared_memory_.Close();
+  }
+
+  // Whatever the bridge wrote last without a newline.
+  if (!error_partial_.empty()) {
+    McpLogBuffer::Get().AppendLine(pid_, error_partial_);
+    error_partial_.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  ClearWriteQueueLocked();
+  flush_timer_armed_ = false;
+}
+
+bool NodeJsProcess::IsRunning() const {
+  return is_running_;
+}
+
+bool NodeJsProcess::IsConnected() const {
+  return is_running_ && !pipe_broken_;
+}
+
+bool NodeJsProcess::SendMessage(std::string_view message) {
+  if (!IsConnected()) {
+    return false;
+  }
+
+  McpTraceSpan span("SendMessage");
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  size_t batch_size = write_batch_.size();
+  if (outbound_framing_ == McpFraming::kLengthPrefixed) {
+    AppendMcpFrame(McpFrameType::kJson, 0, message, &write_batch_);
+  } else {
+    write_batch_.append(message.data(), message.size());
+    write_batch_.push_back('\n');
+  }
+  ++write_batch_messages_;
+  ++queued_messages_;
+  queued_bytes_ += write_batch_.size() - batch_size;
+  McpMetrics& metrics = McpMetrics::Get();
+  McpMetrics::Add(metrics.bytes_sent, write_batch_.size() - batch_size);
+  McpMetrics::Add(metrics.messages_sent);
+
+  if (write_pending_) {
+    // Picked up by OnWriteComplete.
+    return true;
+  }
+  if (flush_latency_.count() > 0 && write_batch_.size() < max_batch_bytes_ && flush_timer_) {
+    if (!flush_timer_armed_) {
+      // Relative due times are negative, in 100ns units.
+      ULARGE_INTEGER due;
+      due.QuadPart = static_cast<ULONGLONG>(-(flush_latency_.count() * 10));
+      FILETIME due_time;
+      due_time.dwLowDateTime = due.LowPart;
+      due_time.dwHighDateTime = due.HighPart;
+      flush_timer_armed_ = true;
+      SetThreadpoolTimer(flush_timer_, &due_time, 0, 0);
+    }
+    return true;
+  }
+  return IssueNextWriteLocked();
+}
+
+void NodeJsProcess::SetWriteCoalescing(std::chrono::microseconds flush_latency,
+                                       size_t max_batch_bytes) {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  flush_latency_ = flush_latency;
+  max_batch_bytes_ = max_batch_bytes;
+}
+
+void NodeJsProcess::SetEfficiencyMode(bool enabled) {
+  std::lock_guard<std::mutex> lock(process_mutex_);
+  if (efficiency_mode_ == enabled) {
+    return;
+  }
+  efficiency_mode_ = enabled;
+  if (process_info_.hProcess) {
+    ApplyEfficiencyModeLocked();
+  }
+}
+
+void NodeJsProcess::ApplyEfficiencyModeLocked() {
+  SetPriorityClass(process_info_.hProcess,
+                   efficiency_mode_ ? BELOW_NORMAL_PRIORITY_CLASS : NORMAL_PRIORITY_CLASS);
+
+  // EcoQoS: the scheduler prefers efficient cores and lower clocks for the
+  // process. Windows before 10 1709 refuses the class, which only costs the
+  // power saving.
+  PROCESS_POWER_THROTTLING_STATE throttling = {};
+  throttling.Version = PROCESS_POWER_THROTTLING_CURRENT_VERSION;
+  throttling.ControlMask = PROCESS_POWER_THROTTLING_EXECUTION_SPEED;
+  throttling.StateMask = efficiency_mode_ ? PROCESS_POWER_THROTTLING_EXECUTION_SPEED : 0;
+  SetProcessInformation(process_info_.hProcess, ProcessPowerThrottling, &throttling,
+                        sizeof(throttling));
+}
+
+bool NodeJsProcess::OpenSharedMemory(std::string* path, size_t* capacity) {
+  std::lock_guard<std::mutex> lock(shared_memory_mutex_);
+  if (!is_running_) {
+    return false;
+  }
+  if (!shared_memory_.is_open() && !shared_memory_.Create(McpSharedMemory::kDefaultCapacity)) {
+    return false;
+  }
+  *path = shared_memory_.path();
+  *capacity = shared_memory_.capacity();
+  return true;
+}
+
+void NodeJsProcess::SetOutboundFraming(McpFraming framing) {
+  outbound_framing_ = framing;
+}
+
+void NodeJsProcess::SetExitCallback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  exit_callback_ = std::move(callback);
+}
+
+void NodeJsProcess::SetMessageCallback(std::function<void(const McpFrame&)> callback) {
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  message_callback_ = callback;
+}
+
+bool NodeJsProcess::BeginIo() {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  if (stopping_) {
+    return false;
+  }
+  ++outstanding_io_;
+  return true;
+}
+
+void NodeJsProcess::EndIo() {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  if (--outstanding_io_ == 0) {
+    io_idle_.notify_all();
+  }
+}
+
+bool NodeJsProcess::IssueOutputRead() {
+  if (!BeginIo()) {
+    return false;
+  }
+  // ReadFile writes straight into the framer's buffer and complete messages
+  // are delivered as views into it, so output is never copied before parsing.
+  size_t available;
+  char* region = output_framer_->PrepareWrite(kMinReadSize, &available);
+  DWORD read_size = static_cast<DWORD>(std::min(available, kMaxReadSize));
+  output_read_.Reset();
+  if (!ReadFile(child_stdout_read_, region, read_size, NULL, &output_read_.overlapped) &&
+      GetLastError() != ERROR_IO_PENDING) {
+    EndIo();
+    return false;
+  }
+  return true;
+}
+
+bool NodeJsProcess::IssueErrorRead() {
+  if (!BeginIo()) {
+    return false;
+  }
+  error_read_.Reset();
+  if (!ReadFile(child_stderr_read_, error_buffer_, sizeof(error_buffer_), NULL,
+                &error_read_.overlapped) &&
+      GetLastError() != ERROR_IO_PENDING) {
+    EndIo();
+    return false;
+  }
+  return true;
+}
+
+void NodeJsProcess::DeliverFrameLocked(const McpFrame& frame) {
+  if (frame.type != McpFrameType::kShared) {
+    message_callback_(frame);
+    return;
+  }
+
+  if (frame.payload.size() != kMcpSharedDescriptorSize) {
+    std::cerr << "Malformed shared-memory descriptor from Node.js" << std::endl;
+    return;
+  }
+  const char* descriptor = frame.payload.data();
+  McpFrame resolved;
+  resolved.type = static_cast<McpFrameType>(descriptor[0]);
+  resolved.request_id = frame.request_id;
+  uint64_t offset = ReadUint64(descriptor + 8);
+  uint64_t length = ReadUint64(descriptor + 16);
+  bool viewed;
+  {
+    // Only the lookup is locked; an open region stays mapped until Stop.
+    std::lock_guard<std::mutex> lock(shared_memory_mutex_);
+    viewed = shared_memory_.View(offset, length, &resolved.payload);
+  }
+  if ((resolved.type != McpFrameType::kJson && resolved.type != McpFrameType::kBinary) ||
+      !viewed) {
+    std::cerr << "Invalid shared-memory descriptor from Node.js" << std::endl;
+    return;
+  }
+  message_callback_(resolved);
+
+  // The callback is done with the view, so the bridge may reuse the bytes.
+  SendMessage("{\"method\":\"$/releaseShared\",\"params\":{\"offset\":" +
+              std::to_string(offset) + ",\"length\":" + std::to_string(length) + "}}");
+}
+
+void NodeJsProcess::OnOutputRead(DWORD bytes, DWORD error) {
+  if (error == ERROR_SUCCESS && bytes > 0) {
+    McpMetrics& metrics = McpMetrics::Get();
+    McpMetrics::Add(metrics.bytes_received, bytes);
+    {
+      McpTraceSpan span("FrameOutput");
+      // Framing time is the Commit minus the handlers it runs.
+      auto framing_start = std::chrono::steady_clock::now();
+      std::chrono::steady_clock::duration handler_time{0};
+      std::lock_guard<std::mutex> lock(callback_mutex_);
+      output_framer_->Commit(bytes, [this, &metrics, &handler_time](const McpFrame& frame) {
+        McpMetrics::Add(metrics.messages_received);
+        if (message_callback_) {
+          auto handler_start = std::chrono::steady_clock::now();
+          DeliverFrameLocked(frame);
+          handler_time += std::chrono::steady_clock::now() - handler_start;
+        }
+      });
+      auto framing_time = std::chrono::steady_clock::now() - framing_start - handler_time;
+      McpMetrics::Add(metrics.framing_ns,
+                      static_cast<uint64_t>(
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(framing_time)
+                              .count()));
+    }
+    if (!IssueOutputRead() && is_running_) {
+      pipe_broken_ = true;
+    }
+  } else if (error != ERROR_OPERATION_ABORTED) {
+    // stdout closed: the bridge exited or crashed.
+    pipe_broken_ = true;
+  }
+  EndIo();
+}
+
+void NodeJsProcess::OnErrorRead(DWORD bytes, DWORD error) {
+  if (error == ERROR_SUCCESS && bytes > 0) {
+    // Only one stderr read is outstanding, so error_partial_ needs no lock.
+    McpLogBuffer::Get().AppendOutput(pid_, std::string_view(error_buffer_, bytes),
+                                     &error_partial_);
+    IssueErrorRead();
+  }
+  EndIo();
+}
+
+bool NodeJsProcess::IssueNextWriteLocked() {
+  if (write_batch_.empty()) {
+    write_pending_ = false;
+    return true;
+  }
+  // Everything batched so far goes out in this one write.
+  write_in_flight_.swap(write_batch_);
+  write_batch_.clear();
+  write_in_flight_messages_ = write_batch_messages_;
+  write_batch_messages_ = 0;
+  write_offset_ = 0;
+  return IssueWriteLocked();
+}
+
+bool NodeJsProcess::IssueWriteLocked() {
+  if (!BeginIo()) {
+    write_pending_ = false;
+    return false;
+  }
+  write_pending_ = true;
+  write_op_.Reset();
+  DWORD size = static_cast<DWORD>(write_in_flight_.size() - write_offset_);
+  if (!WriteFile(child_stdin_write_, write_in_flight_.data() + write_offset_, size, NULL,
+                 &write_op_.overlapped) &&
+      GetLastError() != ERROR_IO_PENDING) {
+    ClearWriteQueueLocked();
+    pipe_broken_ = true;
+    EndIo();
+    return false;
+  }
+  return true;
+}
+
+void NodeJsProcess::ClearWriteQueueLocked() {
+  write_batch_.clear();
+  write_batch_messages_ = 0;
+  write_in_flight_.clear();
+  write_in_flight_messages_ = 0;
+  write_offset_ = 0;
+  write_pending_ = false;
+  queued_messages_ = 0;
+  queued_bytes_ = 0;
+}
+
+void NodeJsProcess::OnWriteComplete(DWORD bytes, DWORD error) {
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (error != ERROR_SUCCESS) {
+      ClearWriteQueueLocked();
+      if (error != ERROR_OPERATION_ABORTED) {
+        pipe_broken_ = true;
+      }
+    } else {
+      write_offset_ += bytes;
+      queued_bytes_ -= bytes;
+      if (write_offset_ < write_in_flight_.size()) {
+        IssueWriteLocked();
+      } else {
+        queued_messages_ -= write_in_flight_messages_;
+        write_in_flight_messages_ = 0;
+        IssueNextWriteLocked();
+      }
+    }
+  }
+  EndIo();
+}
+
+void CALLBACK NodeJsProcess::OnFlushTimer(PTP_CALLBACK_INSTANCE instance, PVOID context,
+                                          PTP_TIMER timer) {
+  auto* process = static_cast<NodeJsProcess*>(context);
+  std::lock_guard<std::mutex> lock(process->write_mutex_);
+  process->flush_timer_armed_ = false;
+  if (!process->write_pending_) {
+    process->IssueNextWriteLocked();
+  }
+}
+
+void CALLBACK NodeJsProcess::OnProcessExit(PVOID context, BOOLEAN timed_out) {
+  auto* process = static_cast<NodeJsProcess*>(context);
+  process->pipe_broken_ = true;
+  std::function<void()> callback;
+  {
+    std::lock_guard<std::mutex> lock(process->callback_mutex_);
+    callback = process->exit_callback_;
+  }
+  if (callback) {
+    callback();
+  }
+}
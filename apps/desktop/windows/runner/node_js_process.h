@@ -0,0 +1,189 @@
+#ifndef RUNNER_NODE_JS_PROCESS_H_
+#define RUNNER_NODE_JS_PROCESS_H_
+
+#include <windows.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "mcp_framing.h"
+#include "mcp_io_completion_port.h"
+#include "mcp_shared_memory.h"
+
+// A Node.js child process running the MCP bridge script, connected through
+// its stdin, stdout and stderr.
+//
+// The parent ends of the pipes are named pipes opened for overlapped I/O and
+// serviced by the shared McpIoCompletionPort, so the process owns no threads.
+// Reads are always outstanding on stdout and stderr, and SendMessage only
+// queues: a bridge that stops draining its stdin backs up the queue instead
+// of blocking the caller.
+//
+// Outbound messages are coalesced. Every message sent while a write is in
+// flight, or within the configured flush latency of an idle pipe, joins one
+// batch that goes out in a single WriteFile, so a burst of requests costs one
+// syscall and one bridge wakeup rather than one per message.
+//
+// Large inbound payloads can bypass the pipe: once OpenSharedMemory gives a
+// process a region, its bridge writes them there and sends only a kShared
+// frame. The message callback sees such a payload as an ordinary frame
+// viewing the mapped memory, and the region is handed back to the bridge
+// once the callback returns.
+class NodeJsProcess {
+ public:
+  NodeJsProcess();
+  ~NodeJsProcess();
+
+  // Prevent copying.
+  NodeJsProcess(NodeJsProcess const&) = delete;
+  NodeJsProcess& operator=(NodeJsProcess const&) = delete;
+
+  // Launches node on |script_path|. If a startup snapshot of the script sits
+  // next to it, named like mcp_bridge.snapshot.blob for mcp_bridge.js, node
+  // boots from that instead of loading the script's modules.
+  bool Start(const std::string& script_path);
+  void Stop();
+  bool IsRunning() const;
+
+  // True while the process is running and none of its pipes has failed.
+  bool IsConnected() const;
+
+  // Queues a JSON message for the Node.js process and returns without waiting
+  // for the write. Returns false if the process is not running or its stdin
+  // has failed.
+  bool SendMessage(std::string_view message);
+
+  // Configures outbound coalescing. A message sent to an idle pipe waits up
+  // to |flush_latency| for others to join its batch, unless the batch already
+  // holds |max_batch_bytes|. A zero latency, the default, writes as soon as
+  // the pipe is idle; messages still coalesce behind a write in flight.
+  void SetWriteCoalescing(std::chrono::microseconds flush_latency, size_t max_batch_bytes);
+
+  // Runs the bridge at below-normal priority with EcoQoS power throttling
+  // while |enabled|, for when nobody is looking at the app. Kept across
+  // restarts. Safe to call from any thread.
+  void SetEfficiencyMode(bool enabled);
+
+  // Messages and bytes accepted by SendMessage but not yet written.
+  size_t queued_messages() const { return queued_messages_; }
+  size_t queued_bytes() const { return queued_bytes_; }
+
+  // Creates the running process's shared region unless it already has one,
+  // and sets |path| and |capacity| for the bridge to open it with. Only a
+  // bridge on length-prefixed framing can use it, so none is made up front.
+  // Returns false if the process is not running or the region cannot be
+  // created; the pipe then carries everything. The region lasts until Stop.
+  bool OpenSharedMemory(std::string* path, size_t* capacity);
+
+  // Selects how SendMessage frames outbound messages. Starts out
+  // newline-delimited; switched once the bridge acknowledges
+  // length-prefixed framing.
+  void SetOutboundFraming(McpFraming framing);
+
+  // Set callback for receiving messages from Node.js. It runs on a completion
+  // port worker thread and must not call Stop. Frame payloads are views into
+  // the read buffer, valid only during the call.
+  void SetMessageCallback(std::function<void(const McpFrame&)> callback);
+
+  // Set callback for the process exiting on its own rather than through
+  // Stop. It runs on a thread pool wait thread and must not call Stop; the
+  // process reports itself disconnected from then on.
+  void SetExitCallback(std::function<void()> callback);
+
+ private:
+  // Registers an operation as outstanding before it is issued, so Stop waits
+  // for its completion. Returns false once the process is stopping.
+  bool BeginIo();
+  void EndIo();
+
+  bool IssueOutputRead();
+  bool IssueErrorRead();
+  void OnOutputRead(DWORD bytes, DWORD error);
+  void OnErrorRead(DWORD bytes, DWORD error);
+
+  // Applies efficiency_mode_ to the running process. Caller holds
+  // process_mutex_.
+  void ApplyEfficiencyModeLocked();
+
+  // Runs the message callback on |frame|, first resolving a kShared frame to
+  // the payload it describes and afterwards releasing that payload's region.
+  // callback_mutex_ must be held.
+  void DeliverFrameLocked(const McpFrame& frame);
+
+  // Write queue helpers; write_mutex_ must be held.
+  bool IssueNextWriteLocked();
+  bool IssueWriteLocked();
+  void ClearWriteQueueLocked();
+  void OnWriteComplete(DWORD bytes, DWORD error);
+
+  static void CALLBACK OnFlushTimer(PTP_CALLBACK_INSTANCE instance, PVOID context,
+                                    PTP_TIMER timer);
+  static void CALLBACK OnProcessExit(PVOID context, BOOLEAN timed_out);
+
+  HANDLE child_stdin_write_;
+  HANDLE child_stdout_read_;
+  HANDLE child_stderr_read_;
+  // Guards process_info_.hProcess against SetEfficiencyMode racing Stop.
+  std::mutex process_mutex_;
+  PROCESS_INFORMATION process_info_;
+  bool efficiency_mode_ = false;
+  std::atomic<bool> is_running_;
+
+  // Set when a pipe reports the bridge has gone away.
+  std::atomic<bool> pipe_broken_;
+
+  McpIoOperation output_read_;
+  McpIoOperation error_read_;
+  McpIoOperation write_op_;
+  std::unique_ptr<McpMessageFramer> output_framer_;
+  // Created on demand by OpenSharedMemory on the platform thread and read
+  // by DeliverFrameLocked on completion threads.
+  std::mutex shared_memory_mutex_;
+  McpSharedMemory shared_memory_;
+  // Bridge stderr goes to McpLogBuffer a line at a time; error_partial_
+  // holds a line still waiting for its newline.
+  char error_buffer_[4096];
+  std::string error_partial_;
+  uint32_t pid_ = 0;
+
+  std::function<void(const McpFrame&)> message_callback_;
+  std::function<void()> exit_callback_;
+  std::mutex callback_mutex_;
+  // Wait on process_info_.hProcess, registered by Start and removed by Stop
+  // before it terminates the process.
+  HANDLE exit_wait_ = nullptr;
+  std::atomic<McpFraming> outbound_framing_;
+
+  // Outbound messages, already framed, waiting to join the next write. The
+  // batch and the write in flight swap buffers, so steady-state sends reuse
+  // their capacity instead of allocating.
+  std::mutex write_mutex_;
+  std::string write_batch_;
+  size_t write_batch_messages_ = 0;
+  std::string write_in_flight_;
+  size_t write_in_flight_messages_ = 0;
+  size_t write_offset_ = 0;
+  bool write_pending_ = false;
+  std::atomic<size_t> queued_messages_{0};
+  std::atomic<size_t> queued_bytes_{0};
+
+  // Delays the first write of a batch by flush_latency_.
+  PTP_TIMER flush_timer_ = nullptr;
+  bool flush_timer_armed_ = false;
+  std::chrono::microseconds flush_latency_{0};
+  size_t max_batch_bytes_;
+
+  // Outstanding overlapped operations, drained by Stop.
+  std::mutex io_mutex_;
+  std::condition_variable io_idle_;
+  size_t outstanding_io_ = 0;
+  bool stopping_ = false;
+};
+
+#endif  // RUNNER_NODE_JS_PROCESS_H_
@@ -0,0 +1,304 @@
+#include "node_js_process_pool.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "mcp_metrics.h"
+
+namespace {
+
+// A process that fails this many sends in a row stops receiving new requests.
+constexpr uint32_t kMaxConsecutiveFailures = 3;
+
+// Restart backoff: doubles from kInitialRestartDelay up to kMaxRestartDelay,
+// and starts over for a process that ran at least kStableUptime.
+constexpr std::chrono::milliseconds kInitialRestartDelay(250);
+constexpr std::chrono::milliseconds kMaxRestartDelay(30000);
+constexpr std::chrono::seconds kStableUptime(60);
+
+}  // namespace
+
+NodeJsProcessPool::NodeJsProcessPool() {}
+
+NodeJsProcessPool::~NodeJsProcessPool() {
+  Stop();
+}
+
+bool NodeJsProcessPool::Start(const std::string& script_path, size_t size,
+                              MessageCallback callback) {
+  if (IsRunning()) {
+    return true;
+  }
+
+  Stop();
+  callback_ = std::move(callback);
+  script_path_ = script_path;
+  {
+    std::lock_guard<std::mutex> lock(supervisor_mutex_);
+    stopping_ = false;
+  }
+  bool any_started = false;
+  std::vector<Slot*> failed;
+  for (size_t index = 0; index < size; ++index) {
+    auto slot = std::make_unique<Slot>();
+    slot->pool = this;
+    slot->index = index;
+    slot->restart_timer =
+        CreateThreadpoolTimer(&NodeJsProcessPool::OnRestartTimer, slot.get(), nullptr);
+    slot->process = std::make_unique<NodeJsProcess>();
+    slot->process->SetMessageCallback([this, index](const McpFrame& frame) {
+      callback_(index, frame);
+    });
+    slot->process->SetExitCallback([this, slot = slot.get()]() { OnProcessExit(slot); });
+    slot->started_at = std::chrono::steady_clock::now();
+    if (slot->process->Start(script_path)) {
+      any_started = true;
+    } else {
+      failed.push_back(slot.get());
+    }
+    slots_.push_back(std::move(slot));
+  }
+  if (!any_started) {
+    Stop();
+    return false;
+  }
+
+  // A slot that failed to start is retried with the same backoff as one
+  // whose process exited, rather than left out of the pool for good.
+  std::lock_guard<std::mutex> lock(supervisor_mutex_);
+  for (Slot* slot : failed) {
+    slot->restarting.store(true, std::memory_order_relaxed);
+    ScheduleRestartLocked(slot);
+  }
+  return true;
+}
+
+void NodeJsProcessPool::SetSupervisorCallbacks(ExitCallback on_exit,
+                                               RestartCallback on_restart) {
+  exit_callback_ = std::move(on_exit);
+  restart_callback_ = std::move(on_restart);
+}
+
+void NodeJsProcessPool::FinishRestart(size_t index) {
+  if (index < slots_.size()) {
+    slots_[index]->restarting.store(false, std::memory_order_relaxed);
+  }
+}
+
+void NodeJsProcessPool::Stop() {
+  // No restart can be armed once stopping_ is set; then wait out any that
+  // is already running before stopping the processes it would touch.
+  {
+    std::lock_guard<std::mutex> lock(supervisor_mutex_);
+    stopping_ = true;
+  }
+  for (auto& slot : slots_) {
+    if (slot->restart_timer) {
+      SetThreadpoolTimer(slot->restart_timer, nullptr, 0, 0);
+      WaitForThreadpoolTimerCallbacks(slot->restart_timer, TRUE);
+    }
+  }
+  for (auto& slot : slots_) {
+    slot->process->Stop();
+    if (slot->restart_timer) {
+      CloseThreadpoolTimer(slot->restart_timer);
+    }
+  }
+  slots_.clear();
+}
+
+bool NodeJsProcessPool::IsRunning() const {
+  for (const auto& slot : slots_) {
+    if (slot->process->IsRunning()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t NodeJsProcessPool::Acquire(std::string_view affinity_key, size_t requests) {
+  size_t chosen = kNoProcess;
+  if (!affinity_key.empty() && !slots_.empty()) {
+    size_t index = std::hash<std::string_view>()(affinity_key) % slots_.size();
+    if (IsHealthy(*slots_[index])) {
+      chosen = index;
+    }
+  }
+  if (chosen == kNoProcess) {
+    size_t least_in_flight = 0;
+    for (size_t index = 0; index < slots_.size(); ++index) {
+      const Slot& slot = *slots_[index];
+      if (!IsHealthy(slot)) {
+        continue;
+      }
+      size_t in_flight = slot.in_flight.load(std::memory_order_relaxed);
+      if (chosen == kNoProcess || in_flight < least_in_flight) {
+        chosen = index;
+        least_in_flight = in_flight;
+      }
+    }
+  }
+  if (chosen != kNoProcess) {
+    slots_[chosen]->in_flight.fetch_add(requests, std::memory_order_relaxed);
+    slots_[chosen]->dispatched.fetch_add(requests, std::memory_order_relaxed);
+  }
+  return chosen;
+}
+
+void NodeJsProcessPool::Release(size_t index) {
+  if (index < slots_.size()) {
+    slots_[index]->in_flight.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void NodeJsProcessPool::Retain(size_t index) {
+  if (index < slots_.size()) {
+    slots_[index]->in_flight.fetch_add(1, std::memory_order_relaxed);
+    slots_[index]->dispatched.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool NodeJsProcessPool::SendMessage(size_t index, std::string_view message) {
+  if (index >= slots_.size()) {
+    return false;
+  }
+  Slot& slot = *slots_[index];
+  if (!slot.process->SendMessage(message)) {
+    slot.send_failures.fetch_add(1, std::memory_order_relaxed);
+    McpMetrics::Add(McpMetrics::Get().send_failures);
+    slot.consecutive_failures.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  slot.consecutive_failures.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+bool NodeJsProcessPool::Broadcast(std::string_view message) {
+  bool any_sent = false;
+  for (size_t index = 0; index < slots_.size(); ++index) {
+    if (IsConnected(index)) {
+      any_sent = SendMessage(index, message) || any_sent;
+    }
+  }
+  return any_sent;
+}
+
+bool NodeJsProcessPool::IsConnected(size_t index) const {
+  return index < slots_.size() && slots_[index]->process->IsConnected();
+}
+
+bool NodeJsProcessPool::OpenSharedMemory(size_t index, std::string* path, size_t* capacity) {
+  return index < slots_.size() && slots_[index]->process->OpenSharedMemory(path, capacity);
+}
+
+void NodeJsProcessPool::SetOutboundFraming(size_t index, McpFraming framing) {
+  if (index < slots_.size()) {
+    slots_[index]->process->SetOutboundFraming(framing);
+  }
+}
+
+void NodeJsProcessPool::SetWriteCoalescing(std::chrono::microseconds flush_latency,
+                                           size_t max_batch_bytes) {
+  for (auto& slot : slots_) {
+    slot->process->SetWriteCoalescing(flush_latency, max_batch_bytes);
+  }
+}
+
+void NodeJsProcessPool::SetEfficiencyMode(bool enabled) {
+  for (auto& slot : slots_) {
+    slot->process->SetEfficiencyMode(enabled);
+  }
+}
+
+void NodeJsProcessPool::RecordRoundTrip(size_t index, std::chrono::microseconds round_trip) {
+  if (index < slots_.size()) {
+    slots_[index]->round_trips.Record(round_trip);
+  }
+}
+
+std::vector<NodeJsProcessPool::ProcessStats> NodeJsProcessPool::GetStats() const {
+  std::vector<ProcessStats> stats;
+  stats.reserve(slots_.size());
+  for (const auto& slot : slots_) {
+    stats.push_back(ProcessStats{IsHealthy(*slot),
+                                 slot->in_flight.load(std::memory_order_relaxed),
+                                 slot->dispatched.load(std::memory_order_relaxed),
+                                 slot->send_failures.load(std::memory_order_relaxed),
+                                 slot->process->queued_messages(),
+                                 slot->process->queued_bytes(),
+                                 slot->round_trips.Summarize()});
+  }
+  return stats;
+}
+
+bool NodeJsProcessPool::IsHealthy(const Slot& slot) const {
+  return slot.process->IsConnected() && !slot.restarting.load(std::memory_order_relaxed) &&
+         slot.consecutive_failures.load(std::memory_order_relaxed) < kMaxConsecutiveFailures;
+}
+
+void NodeJsProcessPool::OnProcessExit(Slot* slot) {
+  {
+    std::lock_guard<std::mutex> lock(supervisor_mutex_);
+    if (stopping_) {
+      return;
+    }
+    slot->restarting.store(true, std::memory_order_relaxed);
+    if (std::chrono::steady_clock::now() - slot->started_at >= kStableUptime) {
+      slot->restart_attempts = 0;
+    }
+    ScheduleRestartLocked(slot);
+  }
+  if (exit_callback_) {
+    exit_callback_(slot->index);
+  }
+}
+
+void NodeJsProcessPool::ScheduleRestartLocked(Slot* slot) {
+  // Shifting stops at 2^7 x 250ms, past kMaxRestartDelay already.
+  std::chrono::milliseconds delay =
+      std::min(kInitialRestartDelay * (int64_t{1} << std::min<uint32_t>(slot->restart_attempts, 7)),
+               kMaxRestartDelay);
+  ++slot->restart_attempts;
+
+  // Relative due times are negative, in 100ns units.
+  ULARGE_INTEGER due;
+  due.QuadPart = static_cast<ULONGLONG>(-(delay.count() * 10000));
+  FILETIME due_time;
+  due_time.dwLowDateTime = due.LowPart;
+  due_time.dwHighDateTime = due.HighPart;
+  SetThreadpoolTimer(slot->restart_timer, &due_time, 0, 0);
+}
+
+// static
+void CALLBACK NodeJsProcessPool::OnRestartTimer(PTP_CALLBACK_INSTANCE instance, PVOID context,
+                                                PTP_TIMER timer) {
+  auto* slot = static_cast<Slot*>(context);
+  NodeJsProcessPool* pool = slot->pool;
+  uint32_t attempt;
+  {
+    std::lock_guard<std::mutex> lock(pool->supervisor_mutex_);
+    if (pool->stopping_) {
+      return;
+    }
+    attempt = slot->restart_attempts;
+    slot->started_at = std::chrono::steady_clock::now();
+  }
+
+  // Stop releases the dead process's pipes; Stop on the pool waits for this
+  // callback, so the slot outlives it.
+  slot->process->Stop();
+  slot->consecutive_failures.store(0, std::memory_order_relaxed);
+  if (!slot->process->Start(pool->script_path_)) {
+    std::lock_guard<std::mutex> lock(pool->supervisor_mutex_);
+    if (!pool->stopping_) {
+      pool->ScheduleRestartLocked(slot);
+    }
+    return;
+  }
+  McpMetrics::Add(McpMetrics::Get().process_restarts);
+  if (pool->restart_callback_) {
+    pool->restart_callback_(slot->index, attempt);
+  } else {
+    slot->restarting.store(false, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,159 @@
+#ifndef RUNNER_NODE_JS_PROCESS_POOL_H_
+#define RUNNER_NODE_JS_PROCESS_POOL_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mcp_framing.h"
+#include "mcp_latency_histogram.h"
+#include "node_js_process.h"
+
+// A fixed set of bridge processes that share the MCP load, so one CPU-heavy
+// tool call cannot stall every other request behind a single Node.js event
+// loop. Every process runs the same script and receives the same initialize
+// config; requests are dispatched to the least-loaded healthy process, or
+// pinned to one process by an affinity key.
+//
+// The pool also supervises its processes. One that exits unexpectedly takes
+// no new requests and is restarted in its slot after an exponential backoff,
+// which resets once a process has stayed up for a while.
+class NodeJsProcessPool {
+ public:
+  // Receives a message from the process at |index|. Runs on a completion
+  // port worker thread; see NodeJsProcess::SetMessageCallback.
+  using MessageCallback = std::function<void(size_t index, const McpFrame& frame)>;
+
+  // Told that the process at |index| exited on its own, or that its
+  // replacement started as restart number |attempt| since the slot was last
+  // stable. Both run on thread pool threads and must not call Stop.
+  using ExitCallback = std::function<void(size_t index)>;
+  using RestartCallback = std::function<void(size_t index, uint32_t attempt)>;
+
+  // Returned by Acquire when no process is healthy.
+  static constexpr size_t kNoProcess = static_cast<size_t>(-1);
+
+  // Health and load of one process.
+  struct ProcessStats {
+    bool healthy;
+    size_t in_flight;
+    uint64_t dispatched;
+    uint64_t send_failures;
+    size_t queued_messages;
+    size_t queued_bytes;
+    // Recent ping round trips, in microseconds.
+    McpLatencySummary round_trip;
+  };
+
+  NodeJsProcessPool();
+  ~NodeJsProcessPool();
+
+  // Prevent copying.
+  NodeJsProcessPool(NodeJsProcessPool const&) = delete;
+  NodeJsProcessPool& operator=(NodeJsProcessPool const&) = delete;
+
+  // Starts |size| processes running |script_path|. Returns true if at least
+  // one of them started; the others are reported unhealthy and restarted
+  // like processes that exited. Returns false, with no slots left, if none
+  // started.
+  bool Start(const std::string& script_path, size_t size, MessageCallback callback);
+
+  // Set before Start.
+  void SetSupervisorCallbacks(ExitCallback on_exit, RestartCallback on_restart);
+
+  // Lets a restarted process take requests again. Until then it reports
+  // unhealthy, so the owner can re-initialize it first.
+  void FinishRestart(size_t index);
+
+  void Stop();
+  bool IsRunning() const;
+  size_t size() const { return slots_.size(); }
+
+  // Picks the process for |requests| new requests and counts them against it
+  // until each is Released. With an empty |affinity_key| this is the healthy
+  // process with the fewest requests in flight; otherwise the key hashes to a
+  // fixed process while that process is healthy. Returns kNoProcess if none
+  // is.
+  size_t Acquire(std::string_view affinity_key, size_t requests = 1);
+  void Release(size_t index);
+
+  // Counts a request against the process at |index| regardless of its
+  // health, for messages that must go to that particular process.
+  void Retain(size_t index);
+
+  // Sends |message| to the process at |index|. Consecutive failures mark the
+  // process unhealthy until it sends successfully again.
+  bool SendMessage(size_t index, std::string_view message);
+
+  // Sends |message| to every connected process. Returns true if at least one
+  // accepted it.
+  bool Broadcast(std::string_view message);
+
+  // True if the process at |index| is running and its pipes work.
+  bool IsConnected(size_t index) const;
+
+  // Applies NodeJsProcess::OpenSharedMemory to the process at |index|.
+  bool OpenSharedMemory(size_t index, std::string* path, size_t* capacity);
+
+  void SetOutboundFraming(size_t index, McpFraming framing);
+
+  // Applies NodeJsProcess::SetWriteCoalescing to every process.
+  void SetWriteCoalescing(std::chrono::microseconds flush_latency, size_t max_batch_bytes);
+
+  // Applies NodeJsProcess::SetEfficiencyMode to every process.
+  void SetEfficiencyMode(bool enabled);
+
+  // Records a ping round trip to the process at |index|.
+  void RecordRoundTrip(size_t index, std::chrono::microseconds round_trip);
+
+  std::vector<ProcessStats> GetStats() const;
+
+ private:
+  struct Slot {
+    NodeJsProcessPool* pool = nullptr;
+    size_t index = 0;
+    std::unique_ptr<NodeJsProcess> process;
+    std::atomic<size_t> in_flight{0};
+    std::atomic<uint64_t> dispatched{0};
+    std::atomic<uint64_t> send_failures{0};
+    std::atomic<uint32_t> consecutive_failures{0};
+    McpLatencyHistogram round_trips;
+
+    // Set from an unexpected exit until FinishRestart.
+    std::atomic<bool> restarting{false};
+    // Fires the restart after the backoff. The fields below it are guarded
+    // by the pool's supervisor_mutex_.
+    PTP_TIMER restart_timer = nullptr;
+    uint32_t restart_attempts = 0;
+    std::chrono::steady_clock::time_point started_at;
+  };
+
+  bool IsHealthy(const Slot& slot) const;
+
+  // Exit wait callback of the process in |slot|.
+  void OnProcessExit(Slot* slot);
+  // Arms |slot|'s restart timer for the next backoff. supervisor_mutex_ must
+  // be held.
+  void ScheduleRestartLocked(Slot* slot);
+  static void CALLBACK OnRestartTimer(PTP_CALLBACK_INSTANCE instance, PVOID context,
+                                      PTP_TIMER timer);
+
+  std::vector<std::unique_ptr<Slot>> slots_;
+  MessageCallback callback_;
+  ExitCallback exit_callback_;
+  RestartCallback restart_callback_;
+  std::string script_path_;
+
+  // Guards stopping_ and restart scheduling, so Stop cannot race a restart
+  // being armed.
+  std::mutex supervisor_mutex_;
+  bool stopping_ = false;
+};
+
+#endif  // RUNNER_NODE_JS_PROCESS_POOL_H_
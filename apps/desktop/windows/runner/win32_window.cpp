@@ -18,6 +18,11 @@ namespace {
 
 constexpr const wchar_t kWindowClassName[] = L"FLUTTER_RUNNER_WIN32_WINDOW";
 
+/// Timer that re-checks visibility while another app is active, since being
+/// covered by it or switched away from on a virtual desktop sends no message.
+constexpr UINT_PTR kVisibilityTimerId = 0x5649;
+constexpr UINT kVisibilityPollMs = 1000;
+
 /// Registry key for app theme preference.
 ///
 /// A value of 0 indicates apps should use dark mode. A non-zero or missing
@@ -29,6 +34,33 @@ constexpr const wchar_t kGetPreferredBrightnessRegValue[] = L"AppsUseLightTheme"
 // The number of Win32Window objects that currently exist.
 static int g_active_window_count = 0;
 
+// Returns the bounds of |window| as drawn, without the invisible resize
+// borders GetWindowRect includes.
+RECT GetVisibleBounds(HWND window) {
+  RECT bounds;
+  if (FAILED(DwmGetWindowAttribute(window, DWMWA_EXTENDED_FRAME_BOUNDS,
+                                   &bounds, sizeof(bounds)))) {
+    GetWindowRect(window, &bounds);
+  }
+  return bounds;
+}
+
+// True if the foreground window belongs to someone else and covers all of
+// |window|. Click-through overlays do not count.
+bool IsCoveredByForeground(HWND window) {
+  HWND foreground = GetForegroundWindow();
+  if (!foreground || foreground == window ||
+      GetAncestor(foreground, GA_ROOTOWNER) == window ||
+      !IsWindowVisible(foreground) || IsIconic(foreground) ||
+      (GetWindowLongPtr(foreground, GWL_EXSTYLE) & WS_EX_TRANSPARENT)) {
+    return false;
+  }
+  RECT ours = GetVisibleBounds(window);
+  RECT theirs = GetVisibleBounds(foreground);
+  return theirs.left <= ours.left && theirs.top <= ours.top &&
+         theirs.right >= ours.right && theirs.bottom >= ours.bottom;
+}
+
 using EnableNonClientDpiScaling = BOOL __stdcall(HWND hwnd);
 
 // Scale helper to convert logical scaler values to physical using passed in
@@ -216,6 +248,28 @@ Win32Window::MessageHandler(HWND hwnd,
     case WM_DWMCOLORIZATIONCOLORCHANGED:
       UpdateTheme(hwnd);
       return 0;
+
+    case WM_WINDOWPOSCHANGED:
+      // Minimizing, restoring, showing and hiding all end up here. Default
+      // processing still has to send WM_SIZE and WM_MOVE.
+      UpdateVisibility();
+      break;
+
+    case WM_ACTIVATEAPP:
+      if (wparam) {
+        KillTimer(hwnd, kVisibilityTimerId);
+      } else {
+        SetTimer(hwnd, kVisibilityTimerId, kVisibilityPollMs, nullptr);
+      }
+      UpdateVisibility();
+      break;
+
+    case WM_TIMER:
+      if (wparam == kVisibilityTimerId) {
+        UpdateVisibility();
+        return 0;
+      }
+      break;
   }
 
   return DefWindowProc(window_handle_, message, wparam, lparam);
@@ -272,6 +326,27 @@ void Win32Window::OnDestroy() {
   // No-op; provided for subclasses.
 }
 
+void Win32Window::OnVisibilityChanged(bool visible) {
+  // No-op; provided for subclasses.
+}
+
+void Win32Window::UpdateVisibility() {
+  if (!window_handle_) {
+    return;
+  }
+  DWORD cloaked = 0;
+  if (FAILED(DwmGetWindowAttribute(window_handle_, DWMWA_CLOAKED, &cloaked,
+                                   sizeof(cloaked)))) {
+    cloaked = 0;
+  }
+  bool visible = IsWindowVisible(window_handle_) && !IsIconic(window_handle_) &&
+                 !cloaked && !IsCoveredByForeground(window_handle_);
+  if (visible != visible_) {
+    visible_ = visible;
+    OnVisibilityChanged(visible);
+  }
+}
+
 void Win32Window::UpdateTheme(HWND const window) {
   DWORD light_mode;
   DWORD light_mode_size = sizeof(light_mode);
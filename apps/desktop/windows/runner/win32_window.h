@@ -71,6 +71,11 @@ class Win32Window {
   // Called when Destroy is called.
   virtual void OnDestroy();
 
+  // Called when the window stops being seen, because it is minimized, hidden,
+  // cloaked on another virtual desktop or covered by another app's foreground
+  // window, and again when it is seen once more.
+  virtual void OnVisibilityChanged(bool visible);
+
  private:
   friend class WindowClassRegistrar;
 
@@ -90,6 +95,10 @@ class Win32Window {
   // Update the window frame's theme to match the system theme.
   static void UpdateTheme(HWND const window);
 
+  // Reports a change in whether the window can be seen to
+  // OnVisibilityChanged.
+  void UpdateVisibility();
+
   bool quit_on_close_ = false;
 
   // window handle for top level window.
@@ -97,6 +106,9 @@ class Win32Window {
 
   // window handle for hosted content.
   HWND child_content_ = nullptr;
+
+  // Last visibility passed to OnVisibilityChanged.
+  bool visible_ = true;
 };
 
 #endif  // RUNNER_WIN32_WINDOW_H_
@@ -0,0 +1,207 @@
+#!/usr/bin/env node
+
+/**
+ * Tests of the order in which mcp_bridge.js handles what the plugin writes.
+ * Runs the real script against a stand-in for mcp-core whose processMessage
+ * never finishes for the message 'slow', so each case checks what a long
+ * request must not hold up or overtake.
+ *
+ *   node mcp_bridge_dispatch_test.js [path/to/mcp_bridge.js]
+ *
+ * Exits with 1 if any case fails.
+ */
+
+const childProcess = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+// Nothing should take anywhere near this long once the bridge is up.
+const TIMEOUT_MS = 10000;
+
+// Stand-in for packages/mcp-core/dist/index.js. Answers with the message and
+// the filenames of the context documents injected so far.
+const FAKE_MCP_CORE = `
+class MCPManager {
+  async enableServer() {}
+  getAvailableServers() { return []; }
+  getConnectedServers() { return []; }
+  async dispose() {}
+}
+
+class ChatMCPBridge {
+  constructor() { this.injected = []; }
+  async injectContext(documents) {
+    for (const document of documents) this.injected.push(document.filename);
+  }
+  processMessage(message) {
+    if (message === 'slow') return new Promise(() => {});
+    return Promise.resolve({
+      response: message + ':' + this.injected.join(','),
+      usedServers: [],
+      metadata: {}
+    });
+  }
+}
+
+module.exports = { MCPManager, ChatMCPBridge };
+`;
+
+let failures = 0;
+
+function expect(condition, description) {
+  if (!condition) {
+    console.error(`FAILED: ${description}`);
+    failures++;
+  }
+}
+
+// Copies the bridge into a scratch tree with the stand-in where the bridge
+// looks for mcp-core, and starts it.
+function startBridge(scriptPath) {
+  const root = fs.mkdtempSync(path.join(os.tmpdir(), 'mcp_bridge_test_'));
+  const runnerDir = path.join(root, 'apps', 'desktop', 'windows', 'runner');
+  const coreDir = path.join(root, 'packages', 'mcp-core', 'dist');
+  fs.mkdirSync(runnerDir, { recursive: true });
+  fs.mkdirSync(coreDir, { recursive: true });
+  fs.copyFileSync(scriptPath, path.join(runnerDir, 'mcp_bridge.js'));
+  fs.writeFileSync(path.join(coreDir, 'index.js'), FAKE_MCP_CORE);
+
+  const child = childProcess.spawn(process.execPath, [path.join(runnerDir, 'mcp_bridge.js')], {
+    stdio: ['pipe', 'pipe', 'ignore']
+  });
+  const bridge = { child, root, messages: [], waiters: [] };
+  let buffer = '';
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', (text) => {
+    buffer += text;
+    let newline;
+    while ((newline = buffer.indexOf('\n')) !== -1) {
+      const line = buffer.slice(0, newline);
+      buffer = buffer.slice(newline + 1);
+      if (line.trim()) {
+        bridge.messages.push(JSON.parse(line));
+      }
+    }
+    for (const waiter of bridge.waiters.slice()) {
+      waiter();
+    }
+  });
+  return bridge;
+}
+
+function stopBridge(bridge) {
+  bridge.child.kill();
+  fs.rmSync(bridge.root, { recursive: true, force: true });
+}
+
+// Writes |messages| to the bridge in a single write, so they arrive in one
+// read.
+function send(bridge, messages) {
+  bridge.child.stdin.write(messages.map((message) => JSON.stringify(message) + '\n').join(''));
+}
+
+// Resolves with the first message from the bridge with |requestId|, or null
+// after TIMEOUT_MS.
+function receive(bridge, requestId) {
+  return new Promise((resolve) => {
+    const check = () => {
+      const message = bridge.messages.find((candidate) => candidate.requestId === requestId);
+      if (!message) {
+        return false;
+      }
+      bridge.waiters.splice(bridge.waiters.indexOf(check), 1);
+      clearTimeout(timer);
+      resolve(message);
+      return true;
+    };
+    const timer = setTimeout(() => {
+      bridge.waiters.splice(bridge.waiters.indexOf(check), 1);
+      resolve(null);
+    }, TIMEOUT_MS);
+    bridge.waiters.push(check);
+    check();
+  });
+}
+
+// Wire ids, as the plugin assigns them.
+let nextId = 1;
+
+function request(requestId, method, params = {}) {
+  return { method, params, requestId, id: nextId++ };
+}
+
+async function initialize(bridge) {
+  send(bridge, [request('init1', 'initialize', { mcpServers: {} })]);
+  const response = await receive(bridge, 'init1');
+  expect(response && response.data && response.data.success, 'initialize succeeds');
+}
+
+// A ping and a cancel packed into the same write as a long request are
+// handled without waiting for it.
+async function testPingAndCancelDoNotWait(bridge) {
+  send(bridge, [
+    request('slow1', 'processMessage', { message: 'slow' }),
+    request('ping1', 'ping'),
+    { method: '$/cancelRequest', params: { requestId: 'slow1' } },
+    request('fast1', 'processMessage', { message: 'fast' })
+  ]);
+  const pong = await receive(bridge, 'ping1');
+  expect(pong && pong.type === 'pong', 'ping behind a long request is answered');
+  const fast = await receive(bridge, 'fast1');
+  expect(fast && fast.data && fast.data.response === 'fast:',
+    'request behind a long request is answered');
+  expect(!bridge.messages.some((message) => message.requestId === 'slow1'),
+    'cancelled request gets no response');
+}
+
+// A block pushed with $/context is available to a request read after it,
+// even while a request read before it is still running.
+async function testContextBeforeRef(bridge) {
+  const set = (contextId, version) => ({
+    method: '$/context',
+    params: { op: 'set', contextId, version, content: `${contextId} v${version}` }
+  });
+  send(bridge, [
+    request('slow2', 'processMessage', { message: 'slow' }),
+    set('doc1', 1),
+    request('ping2', 'ping')
+  ]);
+  await receive(bridge, 'ping2');
+  send(bridge, [
+    request('ref1', 'processMessage', {
+      message: 'ref',
+      contextRefs: [{ id: 'doc1', version: 1 }]
+    })
+  ]);
+  const ref1 = await receive(bridge, 'ref1');
+  expect(ref1 && !ref1.error && ref1.data.response === 'ref:doc1',
+    'context pushed in an earlier read is available');
+
+  send(bridge, [
+    set('doc2', 1),
+    request('ref2', 'processMessage', {
+      message: 'ref',
+      contextRefs: [{ id: 'doc1', version: 1 }, { id: 'doc2', version: 1 }]
+    })
+  ]);
+  const ref2 = await receive(bridge, 'ref2');
+  expect(ref2 && !ref2.error && ref2.data.response === 'ref:doc1,doc2',
+    'context pushed in the same read is available');
+}
+
+async function main() {
+  const scriptPath = path.resolve(process.argv[2] ||
+    path.join(__dirname, '..', 'runner', 'mcp_bridge.js'));
+  const bridge = startBridge(scriptPath);
+  try {
+    await initialize(bridge);
+    await testPingAndCancelDoNotWait(bridge);
+    await testContextBeforeRef(bridge);
+  } finally {
+    stopBridge(bridge);
+  }
+  process.exit(failures ? 1 : 0);
+}
+
+main();
@@ -0,0 +1,122 @@
+// Tests of McpConcurrencyLimiter: admission against the limit, additive
+// increase on fast responses and multiplicative backoff on slow ones and
+// timeouts.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+#include "mcp_concurrency_limiter.h"
+#include "mcp_test.h"
+
+namespace {
+
+using Outcome = McpConcurrencyLimiter::Outcome;
+using Admission = McpConcurrencyLimiter::Admission;
+using std::chrono::microseconds;
+
+bool Near(double actual, double expected) {
+  return std::abs(actual - expected) < 1e-9;
+}
+
+McpConcurrencyLimiter::Options LimiterOptions() {
+  McpConcurrencyLimiter::Options options;
+  options.initial_limit = 4;
+  options.min_limit = 2;
+  options.max_limit = 6;
+  options.latency_tolerance = 2.0;
+  options.backoff_ratio = 0.5;
+  options.queue_limit = 1;
+  return options;
+}
+
+void TestAdmission() {
+  McpConcurrencyLimiter limiter;
+  limiter.Configure(LimiterOptions());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(limiter.Admit("a") == Admission::kAdmitted);
+  }
+  EXPECT_TRUE(limiter.Admit("a") == Admission::kQueue);
+  McpQueuedRequest queued;
+  queued.wire_id = 7;
+  limiter.Enqueue("a", std::move(queued));
+  EXPECT_TRUE(limiter.Admit("a") == Admission::kRejected);
+  // Other servers have limits of their own.
+  EXPECT_TRUE(limiter.Admit("b") == Admission::kAdmitted);
+
+  // A finished request hands its slot to the queue before new arrivals.
+  McpQueuedRequest next;
+  EXPECT_FALSE(limiter.Next("a", &next));
+  limiter.Finish("a", microseconds(100), Outcome::kDropped);
+  EXPECT_TRUE(limiter.Admit("a") == Admission::kRejected);
+  EXPECT_TRUE(limiter.Next("a", &next));
+  EXPECT_EQ(next.wire_id, 7u);
+  EXPECT_FALSE(limiter.Next("a", &next));
+}
+
+void TestIncrease() {
+  McpConcurrencyLimiter limiter;
+  limiter.Configure(LimiterOptions());
+  // Each response within tolerance of the no-load latency adds 1/limit.
+  double expected = 4;
+  for (int i = 0; i < 20; ++i) {
+    limiter.Admit("a");
+    limiter.Finish("a", microseconds(i % 2 == 0 ? 100 : 200), Outcome::kCompleted);
+    expected = std::min(expected + 1.0 / expected, 6.0);
+    EXPECT_TRUE(Near(limiter.limit("a"), expected));
+  }
+  // Capped at max_limit.
+  EXPECT_TRUE(Near(limiter.limit("a"), 6));
+}
+
+void TestBackoff() {
+  McpConcurrencyLimiter limiter;
+  limiter.Configure(LimiterOptions());
+  limiter.Admit("a");
+  limiter.Finish("a", microseconds(100), Outcome::kCompleted);
+  EXPECT_TRUE(Near(limiter.limit("a"), 4.25));
+
+  // Slower than twice the fastest response seen.
+  limiter.Admit("a");
+  limiter.Finish("a", microseconds(201), Outcome::kCompleted);
+  EXPECT_TRUE(Near(limiter.limit("a"), 2.125));
+
+  // A timeout backs off without a latency sample, down to min_limit.
+  limiter.Admit("a");
+  limiter.Finish("a", microseconds(0), Outcome::kTimedOut);
+  EXPECT_TRUE(Near(limiter.limit("a"), 2));
+
+  // Dropped requests leave the limit alone.
+  limiter.Admit("a");
+  limiter.Finish("a", microseconds(100000), Outcome::kDropped);
+  EXPECT_TRUE(Near(limiter.limit("a"), 2));
+}
+
+void TestBaselineIsRemeasured() {
+  McpConcurrencyLimiter limiter;
+  limiter.Configure(LimiterOptions());
+  limiter.Admit("a");
+  limiter.Finish("a", microseconds(10), Outcome::kCompleted);
+  // Once a window of samples has passed, the baseline starts over, so the
+  // limiter follows a server whose work got heavier instead of backing off
+  // for good.
+  for (uint32_t i = 1; i < McpConcurrencyLimiter::kLatencyWindow; ++i) {
+    limiter.Admit("a");
+    limiter.Finish("a", microseconds(1000), Outcome::kCompleted);
+  }
+  EXPECT_TRUE(Near(limiter.limit("a"), 2));
+  limiter.Admit("a");
+  limiter.Finish("a", microseconds(1000), Outcome::kCompleted);
+  EXPECT_TRUE(Near(limiter.limit("a"), 2.5));
+}
+
+}  // namespace
+
+int main() {
+  TestAdmission();
+  TestIncrease();
+  TestBackoff();
+  TestBaselineIsRemeasured();
+  return McpTestResult();
+}
@@ -0,0 +1,184 @@
+// Tests of McpEventQueue: stream token merging, the bound each overflow
+// policy keeps, the plugin's own events that bypass it and response chunks
+// that wait for room under every policy.
+
+#include <flutter/encodable_value.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mcp_event_queue.h"
+#include "mcp_test.h"
+
+namespace {
+
+flutter::EncodableValue Event(const char* name, const std::string& request_id,
+                              const std::string& token = std::string()) {
+  flutter::EncodableMap data{
+    {flutter::EncodableValue("requestId"), flutter::EncodableValue(request_id)}
+  };
+  if (!token.empty()) {
+    data[flutter::EncodableValue("token")] = flutter::EncodableValue(token);
+  }
+  return flutter::EncodableValue(flutter::EncodableMap{
+    {flutter::EncodableValue("type"), flutter::EncodableValue("event")},
+    {flutter::EncodableValue("event"), flutter::EncodableValue(name)},
+    {flutter::EncodableValue("data"), flutter::EncodableValue(std::move(data))}
+  });
+}
+
+// Returns the token of a stream_token event, or an empty string.
+std::string TokenOf(const flutter::EncodableValue& event) {
+  const auto* fields = std::get_if<flutter::EncodableMap>(&event);
+  if (!fields) {
+    return std::string();
+  }
+  auto data = fields->find(flutter::EncodableValue("data"));
+  const auto* data_fields =
+      data != fields->end() ? std::get_if<flutter::EncodableMap>(&data->second) : nullptr;
+  if (!data_fields) {
+    return std::string();
+  }
+  auto token = data_fields->find(flutter::EncodableValue("token"));
+  const auto* text =
+      token != data_fields->end() ? std::get_if<std::string>(&token->second) : nullptr;
+  return text ? *text : std::string();
+}
+
+// Pushes |event| from another thread, which unlike this one may wait, and
+// reports whether it has returned yet.
+class BackgroundPush {
+ public:
+  BackgroundPush(McpEventQueue* queue, flutter::EncodableValue event,
+                 McpEventPriority priority = McpEventPriority::kNormal)
+      : thread_([this, queue, event, priority]() mutable {
+          accepted_ = queue->Push(std::move(event), priority);
+          done_ = true;
+        }) {
+    // Long enough for the push to have returned unless it waits.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  ~BackgroundPush() {
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  bool done() const { return done_; }
+
+  bool Join() {
+    thread_.join();
+    thread_ = std::thread();
+    return accepted_;
+  }
+
+ private:
+  std::atomic<bool> done_{false};
+  bool accepted_ = false;
+  std::thread thread_;
+};
+
+void TestTokensMerge() {
+  McpEventQueue queue;
+  EXPECT_TRUE(queue.Push(Event("stream_token", "a", "he")));
+  EXPECT_TRUE(queue.Push(Event("stream_token", "a", "llo")));
+  EXPECT_TRUE(queue.Push(Event("stream_token", "b", "x")));
+  EXPECT_EQ(queue.size(), 2u);
+  // A later token must not overtake another event of its request.
+  EXPECT_TRUE(queue.Push(Event("stream_end", "a")));
+  EXPECT_TRUE(queue.Push(Event("stream_token", "a", "!")));
+  EXPECT_EQ(queue.size(), 4u);
+
+  std::vector<flutter::EncodableValue> events;
+  queue.Drain(&events);
+  EXPECT_EQ(events.size(), 4u);
+  EXPECT_EQ(TokenOf(events[0]), std::string("hello"));
+  EXPECT_EQ(TokenOf(events[1]), std::string("x"));
+  EXPECT_EQ(TokenOf(events[3]), std::string("!"));
+  EXPECT_EQ(queue.size(), 0u);
+}
+
+void TestMergeIsBounded() {
+  McpEventQueue queue;
+  queue.Configure(2, McpEventOverflowPolicy::kMerge);
+  // The draining thread never waits, so it can fill the queue past its bound.
+  for (size_t i = 0; i < 2 * McpEventQueue::kMergeHeadroom; ++i) {
+    EXPECT_TRUE(queue.Push(Event("progress", std::to_string(i))));
+  }
+  BackgroundPush push(&queue, Event("progress", "last"));
+  EXPECT_FALSE(push.done());
+
+  std::vector<flutter::EncodableValue> events;
+  queue.Drain(&events);
+  EXPECT_TRUE(push.Join());
+  EXPECT_EQ(queue.size(), 1u);
+  EXPECT_EQ(queue.dropped(), 0u);
+}
+
+void TestBlockWaitsAtCapacity() {
+  McpEventQueue queue;
+  queue.Configure(1, McpEventOverflowPolicy::kBlock);
+  EXPECT_TRUE(queue.Push(Event("progress", "1")));
+  BackgroundPush push(&queue, Event("progress", "2"));
+  EXPECT_FALSE(push.done());
+
+  // Closing releases the push and drops its event.
+  queue.Close();
+  EXPECT_FALSE(push.Join());
+  EXPECT_EQ(queue.dropped(), 1u);
+  EXPECT_EQ(queue.size(), 1u);
+  queue.Reopen();
+}
+
+void TestControlEventsBypassPolicy() {
+  McpEventQueue queue;
+  queue.Configure(1, McpEventOverflowPolicy::kDrop);
+  EXPECT_TRUE(queue.Push(Event("progress", "1")));
+  EXPECT_FALSE(queue.Push(Event("progress", "2")));
+  EXPECT_EQ(queue.dropped(), 1u);
+  EXPECT_TRUE(queue.Push(Event("response_complete", "3"), McpEventPriority::kControl));
+  EXPECT_EQ(queue.size(), 2u);
+
+  // Nor do they wait for room under kBlock.
+  queue.Configure(1, McpEventOverflowPolicy::kBlock);
+  BackgroundPush push(&queue, Event("bridge_exited", "4"), McpEventPriority::kControl);
+  EXPECT_TRUE(push.done());
+  EXPECT_TRUE(push.Join());
+  EXPECT_EQ(queue.size(), 3u);
+}
+
+void TestChunksWaitUnderEveryPolicy() {
+  McpEventQueue queue;
+  queue.Configure(1, McpEventOverflowPolicy::kDrop);
+  EXPECT_TRUE(queue.Push(Event("progress", "1")));
+  BackgroundPush push(&queue, Event("response_chunk", "2"), McpEventPriority::kLossless);
+  EXPECT_FALSE(push.done());
+  std::vector<flutter::EncodableValue> events;
+  queue.Drain(&events);
+  EXPECT_TRUE(push.Join());
+  EXPECT_EQ(queue.size(), 1u);
+
+  // Closing releases a waiting chunk without losing it.
+  BackgroundPush closed(&queue, Event("response_chunk", "3"), McpEventPriority::kLossless);
+  EXPECT_FALSE(closed.done());
+  queue.Close();
+  EXPECT_TRUE(closed.Join());
+  EXPECT_EQ(queue.size(), 2u);
+  EXPECT_EQ(queue.dropped(), 0u);
+  queue.Reopen();
+}
+
+}  // namespace
+
+int main() {
+  TestTokensMerge();
+  TestMergeIsBounded();
+  TestBlockWaitsAtCapacity();
+  TestControlEventsBypassPolicy();
+  TestChunksWaitUnderEveryPolicy();
+  return McpTestResult();
+}
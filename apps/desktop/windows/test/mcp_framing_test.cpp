@@ -0,0 +1,121 @@
+// Tests of McpMessageFramer: newline-delimited and length-prefixed messages,
+// mixed in one stream and split across reads at every possible point.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mcp_framing.h"
+#include "mcp_test.h"
+
+namespace {
+
+struct Received {
+  McpFrameType type;
+  uint64_t request_id;
+  std::string payload;
+
+  bool operator==(const Received& other) const {
+    return type == other.type && request_id == other.request_id && payload == other.payload;
+  }
+};
+
+// Feeds |stream| to |framer| in reads of at most |chunk_size| bytes.
+std::vector<Received> Feed(McpMessageFramer* framer, const std::string& stream,
+                           size_t chunk_size) {
+  std::vector<Received> received;
+  auto handler = [&received](const McpFrame& frame) {
+    received.push_back(Received{frame.type, frame.request_id, std::string(frame.payload)});
+  };
+  size_t offset = 0;
+  while (offset < stream.size()) {
+    size_t available;
+    char* buffer = framer->PrepareWrite(1, &available);
+    size_t size = std::min({chunk_size, available, stream.size() - offset});
+    memcpy(buffer, stream.data() + offset, size);
+    framer->Commit(size, handler);
+    offset += size;
+  }
+  return received;
+}
+
+void TestLines() {
+  McpMessageFramer framer(16);
+  std::vector<Received> received =
+      Feed(&framer, "{\"a\":1}\n\n{\"b\":2}\r\n{\"c\":3}", 1024);
+  EXPECT_EQ(received.size(), 2u);
+  if (received.size() == 2) {
+    EXPECT_TRUE(received[0] == (Received{McpFrameType::kJson, 0, "{\"a\":1}"}));
+    EXPECT_TRUE(received[1] == (Received{McpFrameType::kJson, 0, "{\"b\":2}"}));
+  }
+  // The last line waits for its newline.
+  EXPECT_EQ(framer.pending_bytes(), 7u);
+}
+
+void TestMixedStreamAtEverySplit() {
+  std::string big(100000, 'x');
+  std::string stream = "{\"type\":\"ready\"}\n";
+  AppendMcpFrame(McpFrameType::kJson, 0, "{\"type\":\"response\"}", &stream);
+  AppendMcpFrame(McpFrameType::kBinary, 42, std::string("\0\n\xFB", 3), &stream);
+  stream += "{\"late\":true}\r\n";
+  AppendMcpFrame(McpFrameType::kBinary, 43, big, &stream);
+  AppendMcpFrame(McpFrameType::kBinary, 44, "", &stream);
+  stream += "tail\n";
+  std::vector<Received> expected = {
+      {McpFrameType::kJson, 0, "{\"type\":\"ready\"}"},
+      {McpFrameType::kJson, 0, "{\"type\":\"response\"}"},
+      {McpFrameType::kBinary, 42, std::string("\0\n\xFB", 3)},
+      {McpFrameType::kJson, 0, "{\"late\":true}"},
+      {McpFrameType::kBinary, 43, big},
+      {McpFrameType::kBinary, 44, ""},
+      {McpFrameType::kJson, 0, "tail"},
+  };
+
+  for (size_t chunk_size : {size_t{1}, size_t{2}, size_t{7}, size_t{15}, size_t{16},
+                            size_t{17}, size_t{4096}, stream.size()}) {
+    McpMessageFramer framer(64);
+    EXPECT_TRUE(Feed(&framer, stream, chunk_size) == expected);
+    EXPECT_EQ(framer.pending_bytes(), 0u);
+  }
+}
+
+void TestCorruptLengthResynchronizes() {
+  // A header claiming more than kMcpMaxFramePayload is discarded up to the
+  // next newline.
+  std::string stream(kMcpFrameHeaderSize, '\0');
+  stream[0] = static_cast<char>(kMcpFrameMagic);
+  stream[1] = static_cast<char>(McpFrameType::kJson);
+  stream[4] = stream[5] = stream[6] = stream[7] = static_cast<char>(0xFF);
+  stream += "garbage\n{\"ok\":true}\n";
+  McpMessageFramer framer;
+  std::vector<Received> received = Feed(&framer, stream, 5);
+  EXPECT_EQ(received.size(), 1u);
+  if (received.size() == 1) {
+    EXPECT_TRUE(received[0] == (Received{McpFrameType::kJson, 0, "{\"ok\":true}"}));
+  }
+}
+
+void TestPrepareWriteMakesRoomForPartialFrame() {
+  std::string stream;
+  AppendMcpFrame(McpFrameType::kBinary, 1, std::string(5000, 'y'), &stream);
+  McpMessageFramer framer(64);
+  size_t available;
+  char* buffer = framer.PrepareWrite(1, &available);
+  memcpy(buffer, stream.data(), kMcpFrameHeaderSize);
+  framer.Commit(kMcpFrameHeaderSize, [](const McpFrame&) {});
+  // The header says how big the frame is, so the rest fits in one read.
+  framer.PrepareWrite(1, &available);
+  EXPECT_TRUE(available >= stream.size() - kMcpFrameHeaderSize);
+}
+
+}  // namespace
+
+int main() {
+  TestLines();
+  TestMixedStreamAtEverySplit();
+  TestCorruptLengthResynchronizes();
+  TestPrepareWriteMakesRoomForPartialFrame();
+  return McpTestResult();
+}
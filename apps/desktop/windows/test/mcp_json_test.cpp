@@ -0,0 +1,192 @@
+// Tests of mcp_json: the envelope scanner, the decoder and the transcoder,
+// including the JSON number grammar they share.
+
+#include <flutter/encodable_value.h>
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mcp_json.h"
+#include "mcp_test.h"
+
+namespace {
+
+flutter::EncodableValue Decode(const std::string& json) {
+  flutter::EncodableValue value;
+  EXPECT_TRUE(DecodeJsonToEncodableValue(json, &value));
+  return value;
+}
+
+const flutter::EncodableValue* Member(const flutter::EncodableValue& value, const char* key) {
+  const auto* map = std::get_if<flutter::EncodableMap>(&value);
+  if (!map) {
+    return nullptr;
+  }
+  auto it = map->find(flutter::EncodableValue(key));
+  return it != map->end() ? &it->second : nullptr;
+}
+
+void TestScanEnvelope() {
+  McpMessageEnvelope envelope;
+  EXPECT_TRUE(ScanMcpMessageEnvelope(
+      "{\"data\":{\"type\":\"event\",\"id\":9,\"text\":\"\\\"requestId\\\":\\\"x\\\"\"},"
+      "\"type\":\"response\",\"requestId\":\"r1\",\"id\":12,\"processingUs\":340,"
+      "\"error\":{\"code\":\"E\"}}",
+      &envelope));
+  // Keys inside the payload are not routing fields.
+  EXPECT_EQ(envelope.type, "response");
+  EXPECT_TRUE(envelope.has_request_id);
+  EXPECT_EQ(envelope.request_id, "r1");
+  EXPECT_TRUE(envelope.has_id);
+  EXPECT_EQ(envelope.id, 12u);
+  EXPECT_EQ(envelope.processing_us, 340u);
+  EXPECT_TRUE(envelope.has_error);
+  EXPECT_EQ(envelope.error, "{\"code\":\"E\"}");
+
+  McpMessageEnvelope no_error;
+  EXPECT_TRUE(ScanMcpMessageEnvelope("{\"type\":\"pong\",\"id\":-1,\"error\":null}", &no_error));
+  EXPECT_FALSE(no_error.has_id);
+  EXPECT_FALSE(no_error.has_error);
+  EXPECT_FALSE(no_error.has_request_id);
+
+  McpMessageEnvelope rejected;
+  EXPECT_FALSE(ScanMcpMessageEnvelope("[1,2]", &rejected));
+  EXPECT_FALSE(ScanMcpMessageEnvelope("{\"type\":\"response\"", &rejected));
+  EXPECT_FALSE(ScanMcpMessageEnvelope("{\"id\":1-2}", &rejected));
+  EXPECT_FALSE(ScanMcpMessageEnvelope("{\"id\":01}", &rejected));
+}
+
+void TestScanChecksSkippedValues() {
+  McpMessageEnvelope envelope;
+  EXPECT_TRUE(ScanMcpMessageEnvelope(
+      "{\"payload\":[1, {\"a\" : [true,null,\"]}\"]}, [], {}, -0.5e3],\"type\":\"event\"}",
+      &envelope));
+  EXPECT_EQ(envelope.type, "event");
+
+  // Balanced brackets are not enough.
+  for (const char* payload : {"[1,,2]", "[1,]", "[,1]", "[1 2]", "{\"a\"}", "{\"a\":1,}",
+                              "{1:2}", "{\"a\":1 \"b\":2}", "[}", "{]", "[tru]", "[[1]"}) {
+    std::string json = std::string("{\"type\":\"response\",\"id\":5,\"payload\":") + payload +
+                       "}";
+    EXPECT_FALSE(ScanMcpMessageEnvelope(json, &envelope));
+  }
+
+  // Nesting is not limited by the call stack.
+  std::string deep = "{\"payload\":" + std::string(100000, '[') + std::string(100000, ']') + "}";
+  EXPECT_TRUE(ScanMcpMessageEnvelope(deep, &envelope));
+}
+
+void TestDecodeValues() {
+  flutter::EncodableValue value =
+      Decode("{\"s\":\"a\\n\\u00e9\\ud83d\\ude00\",\"t\":true,\"f\":false,\"n\":null,"
+             "\"small\":-2147483648,\"big\":2147483648,\"d\":0.5,\"e\":-1E+2,"
+             "\"list\":[1,[],{}]}");
+  EXPECT_TRUE(*Member(value, "s") == flutter::EncodableValue("a\n\xC3\xA9\xF0\x9F\x98\x80"));
+  EXPECT_TRUE(*Member(value, "t") == flutter::EncodableValue(true));
+  EXPECT_TRUE(*Member(value, "f") == flutter::EncodableValue(false));
+  EXPECT_TRUE(Member(value, "n")->IsNull());
+  EXPECT_TRUE(*Member(value, "small") == flutter::EncodableValue(int32_t{-2147483647 - 1}));
+  EXPECT_TRUE(*Member(value, "big") == flutter::EncodableValue(int64_t{2147483648}));
+  EXPECT_TRUE(*Member(value, "d") == flutter::EncodableValue(0.5));
+  EXPECT_TRUE(*Member(value, "e") == flutter::EncodableValue(-100.0));
+  const auto* list = std::get_if<flutter::EncodableList>(Member(value, "list"));
+  EXPECT_TRUE(list && list->size() == 3);
+}
+
+void TestDecodeNumberGrammar() {
+  const char* invalid[] = {"01",  "-01",  "1.",   ".5",   "-.5",  "1.e3",     "-",
+                           "+1",  "1e",   "1e+",  "1E-",  "1-2",  "--1",      "1.2.3",
+                           "0x10", "1ee2", "[01]", "[1,-]", "NaN", "Infinity"};
+  for (const char* json : invalid) {
+    flutter::EncodableValue value;
+    EXPECT_FALSE(DecodeJsonToEncodableValue(json, &value));
+  }
+  EXPECT_TRUE(Decode("-0") == flutter::EncodableValue(int32_t{0}));
+  EXPECT_TRUE(Decode("9223372036854775807") ==
+              flutter::EncodableValue(int64_t{9223372036854775807}));
+  // Integers beyond int64_t become doubles, as in JavaScript.
+  flutter::EncodableValue value = Decode("123456789012345678901234567890");
+  const double* huge = std::get_if<double>(&value);
+  EXPECT_TRUE(huge && *huge > 1.2e29 && *huge < 1.3e29);
+}
+
+void TestDecodeOutOfRange() {
+  // Like JSON.parse: overflow is a signed infinity, underflow a signed zero.
+  flutter::EncodableValue value = Decode("[1e400,-1e400,1e-400,-1e-400,0.000e-999999999999]");
+  const auto* list = std::get_if<flutter::EncodableList>(&value);
+  EXPECT_TRUE(list && list->size() == 5);
+  if (list && list->size() == 5) {
+    const double expected[] = {INFINITY, -INFINITY, 0.0, -0.0, 0.0};
+    for (size_t i = 0; i < 5; ++i) {
+      const double* number = std::get_if<double>(&(*list)[i]);
+      EXPECT_TRUE(number && *number == expected[i] &&
+                  std::signbit(*number) == std::signbit(expected[i]));
+    }
+  }
+}
+
+void TestDecodeRejectsMalformed() {
+  const char* invalid[] = {"",      "{",     "{\"a\"}", "{\"a\":1,}", "[1,]",    "\"abc",
+                           "\"\\x\"", "tru",   "nul",     "{1:2}",     "[1] [2]", "{\"a\":1}}"};
+  for (const char* json : invalid) {
+    flutter::EncodableValue value;
+    EXPECT_FALSE(DecodeJsonToEncodableValue(json, &value));
+  }
+  std::string deep(600, '[');
+  deep.append(600, ']');
+  flutter::EncodableValue value;
+  EXPECT_FALSE(DecodeJsonToEncodableValue(deep, &value));
+}
+
+void TestTranscode() {
+  std::vector<uint8_t> bytes;
+  EXPECT_TRUE(TranscodeJsonToStandardCodec("[1,\"a\",true,null,{\"k\":2.5}]", 0, &bytes));
+  std::vector<uint8_t> expected = {
+      12, 5,           // list of 5
+      3,  1, 0, 0, 0,  // int32 1
+      7,  1, 'a',      // "a"
+      1,               // true
+      0,               // null
+      13, 1,           // map of 1
+      7,  1, 'k',      // "k"
+      6,               // float64, then padding to an 8-byte boundary
+      0,  0, 0, 0, 0, 0,
+      0,  0, 0, 0, 0, 0, 0x04, 0x40,  // 2.5
+  };
+  EXPECT_TRUE(bytes == expected);
+
+  // The padding depends on where the message starts.
+  EXPECT_TRUE(TranscodeJsonToStandardCodec("2.5", 3, &bytes));
+  EXPECT_TRUE(bytes == (std::vector<uint8_t>{6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x04, 0x40}));
+
+  EXPECT_TRUE(TranscodeJsonToStandardCodec("2147483648", 0, &bytes));
+  EXPECT_TRUE(bytes == (std::vector<uint8_t>{4, 0, 0, 0, 0x80, 0, 0, 0, 0}));
+
+  EXPECT_FALSE(TranscodeJsonToStandardCodec("[1,2", 0, &bytes));
+  EXPECT_FALSE(TranscodeJsonToStandardCodec("[01]", 0, &bytes));
+}
+
+void TestAppendJson() {
+  std::string json;
+  AppendJson(Decode("{\"b\":[1,-2.5,\"q\\\"\\u0001\"],\"a\":null}"), &json);
+  EXPECT_EQ(json, "{\"a\":null,\"b\":[1,-2.5,\"q\\\"\\u0001\"]}");
+  json.clear();
+  AppendJson(flutter::EncodableValue(std::nan("")), &json);
+  EXPECT_EQ(json, "null");
+}
+
+}  // namespace
+
+int main() {
+  TestScanEnvelope();
+  TestScanChecksSkippedValues();
+  TestDecodeValues();
+  TestDecodeNumberGrammar();
+  TestDecodeOutOfRange();
+  TestDecodeRejectsMalformed();
+  TestTranscode();
+  TestAppendJson();
+  return McpTestResult();
+}
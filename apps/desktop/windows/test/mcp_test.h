@@ -0,0 +1,35 @@
+#ifndef TEST_MCP_TEST_H_
+#define TEST_MCP_TEST_H_
+
+// A few macros shared by the MCP unit tests. Each test executable calls its
+// test functions from main and returns McpTestResult(); failed checks print
+// where they are and carry on, so one run reports every failure. Unlike
+// assert, the checks stay on in release builds.
+
+#include <cstdio>
+
+inline int& McpTestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define EXPECT_TRUE(condition)                                                  \
+  do {                                                                          \
+    if (!(condition)) {                                                         \
+      std::fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition); \
+      ++McpTestFailures();                                                      \
+    }                                                                           \
+  } while (0)
+
+#define EXPECT_FALSE(condition) EXPECT_TRUE(!(condition))
+#define EXPECT_EQ(actual, expected) EXPECT_TRUE((actual) == (expected))
+
+inline int McpTestResult() {
+  if (McpTestFailures() > 0) {
+    std::fprintf(stderr, "%d check(s) failed\n", McpTestFailures());
+    return 1;
+  }
+  return 0;
+}
+
+#endif  // TEST_MCP_TEST_H_
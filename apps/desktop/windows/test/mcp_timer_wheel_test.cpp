@@ -0,0 +1,117 @@
+// Tests of McpTimerWheel: expiry across every level's cascade, and Cancel.
+//
+// The wheel reads the clock itself, so the tests bound it instead: the wheel
+// starts no earlier than |start| and each timer is scheduled no later than
+// |scheduled|, which puts every deadline within [delay, delay + slack] of
+// |start|.
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "mcp_test.h"
+#include "mcp_timer_wheel.h"
+
+namespace {
+
+using Clock = McpTimerWheel::Clock;
+using std::chrono::milliseconds;
+
+constexpr milliseconds kTick{1};
+
+// Delays around the edges of the first three levels' spans, 64, 64^2 and
+// 64^3 ticks, and one far out in the fourth.
+const int64_t kDelays[] = {1,    2,    63,   64,   65,     127,    128,    129,
+                           4095, 4096, 4097, 8191, 262143, 262144, 262145, 1000000};
+
+int64_t TicksSince(Clock::time_point start, Clock::time_point now) {
+  return std::chrono::duration_cast<milliseconds>(now - start).count();
+}
+
+void TestExpiresAcrossCascades() {
+  Clock::time_point start = Clock::now();
+  McpTimerWheel wheel(kTick);
+  uint64_t key = 0;
+  for (int64_t delay : kDelays) {
+    wheel.Schedule(key++, milliseconds(delay));
+  }
+  int64_t slack = TicksSince(start, Clock::now()) + 1;
+
+  // Step through time one tick at a time, so every cascade happens.
+  std::vector<int64_t> expired_at(key, -1);
+  std::vector<uint64_t> expired;
+  int64_t end = kDelays[key - 1] + slack;
+  for (int64_t now = 1; now <= end; ++now) {
+    wheel.Advance(start + milliseconds(now), &expired);
+    for (uint64_t expired_key : expired) {
+      EXPECT_EQ(expired_at[expired_key], -1);
+      expired_at[expired_key] = now;
+    }
+    expired.clear();
+  }
+  for (uint64_t i = 0; i < key; ++i) {
+    EXPECT_TRUE(expired_at[i] >= kDelays[i]);
+    EXPECT_TRUE(expired_at[i] <= kDelays[i] + slack);
+  }
+  EXPECT_TRUE(wheel.empty());
+}
+
+void TestAdvanceJumpsOverManyTicks() {
+  Clock::time_point start = Clock::now();
+  McpTimerWheel wheel(kTick);
+  for (uint64_t key = 0; key < 10000; ++key) {
+    wheel.Schedule(key, milliseconds(key * 37 % 300000 + 1));
+  }
+  std::vector<uint64_t> expired;
+  wheel.Advance(start + milliseconds(400000), &expired);
+  EXPECT_EQ(expired.size(), 10000u);
+  EXPECT_TRUE(wheel.empty());
+}
+
+void TestCancel() {
+  Clock::time_point start = Clock::now();
+  McpTimerWheel wheel(kTick);
+  // Many timers share slots, so Cancel has to keep their positions right
+  // as it fills holes.
+  for (uint64_t key = 0; key < 5000; ++key) {
+    wheel.Schedule(key, milliseconds(key % 70 + 1000));
+  }
+  for (uint64_t key = 0; key < 5000; key += 2) {
+    EXPECT_TRUE(wheel.Cancel(key));
+  }
+  EXPECT_FALSE(wheel.Cancel(0));
+  EXPECT_FALSE(wheel.Cancel(123456));
+
+  // The timers were cancelled from level 1; the survivors still cascade.
+  std::vector<uint64_t> expired;
+  wheel.Advance(start + milliseconds(5000), &expired);
+  EXPECT_EQ(expired.size(), 2500u);
+  for (uint64_t key : expired) {
+    EXPECT_EQ(key % 2, 1u);
+  }
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.Cancel(1));
+}
+
+void TestScheduleReplacesTimer() {
+  Clock::time_point start = Clock::now();
+  McpTimerWheel wheel(kTick);
+  wheel.Schedule(7, milliseconds(10));
+  wheel.Schedule(7, milliseconds(100000));
+  std::vector<uint64_t> expired;
+  wheel.Advance(start + milliseconds(50000), &expired);
+  EXPECT_TRUE(expired.empty());
+  EXPECT_FALSE(wheel.empty());
+  EXPECT_TRUE(wheel.Cancel(7));
+  EXPECT_TRUE(wheel.empty());
+}
+
+}  // namespace
+
+int main() {
+  TestExpiresAcrossCascades();
+  TestAdvanceJumpsOverManyTicks();
+  TestCancel();
+  TestScheduleReplacesTimer();
+  return McpTestResult();
+}